@@ -132,6 +132,13 @@ class Application {
      */
     void toggleShadows();
 
+    /**
+     * @brief Change the number of point lights that cast shadows
+     *
+     * @param delta The number of lights to add, negative to remove
+     */
+    void changeShadowedLights(int delta);
+
     /**
      * @brief Toggle bloom
      */
@@ -142,6 +149,18 @@ class Application {
      */
     void toggleDOF();
 
+    /**
+     * @brief Toggle the rendering statistics overlay
+     */
+    void toggleStatistics();
+
+    /**
+     * @brief Renders the statistics of the scene as text
+     * 
+     * @param window  The window to render to
+     */
+    void renderStatistics(GLFWwindow* window);
+
     /**
      * @brief Toggle the selected light
      */
@@ -218,6 +237,7 @@ class Application {
     std::shared_ptr<Scene> m_scene;
 
     std::shared_ptr<FPSCounter> m_fpsCounter;
+    vr::Text m_statsText;
     std::string m_loadedFilename, m_loadedVShader, m_loadedFShader;
     glm::uvec2 m_screenSize;
     glm::f32vec4 m_clearColor;
@@ -226,6 +246,7 @@ class Application {
     bool m_debug = false;
     bool m_bloom = false;
     bool m_dof = false;
+    bool m_showStatistics = false;
     int m_debugTexture = 0;
 
     float m_focus = 0.01f;
@@ -235,6 +256,8 @@ class Application {
 
     GLuint m_fbo, m_pingpongFBO[2], m_ssaoFBO[2];
     std::vector<glm::vec3> m_ssaoKernel;
+    // Uniform handles of the SSAO kernel samples, resolved when the shaders are loaded
+    std::vector<Uniform> m_ssaoSampleUniforms;
     std::shared_ptr<Texture> m_ssaoNoiseTexture, m_ssaoBuffer, m_ssaoBlurBuffer;
     std::shared_ptr<Texture> m_pingpongTextures[2];
     std::shared_ptr<Texture> m_sceneTexture, m_bloomTexture, m_brightTexture, m_blurTexture;
@@ -14,13 +14,25 @@ namespace vr
     {
     }
 
+    /// Returns the axis aligned box enclosing this box transformed by mat
     BoundingBox operator*(const glm::mat4& mat) const
     {
-      BoundingBox box;
+      if (!isValid())
+        return BoundingBox();
 
-      box.m_min = mat * glm::vec4(m_min, 1);
-      box.m_max = mat * glm::vec4(m_max, 1);
-      return box;
+      // Transform the center and project the half extents onto the new axes (Arvo)
+      glm::vec3 center = glm::vec3(mat * glm::vec4((m_max + m_min) * 0.5f, 1));
+      glm::vec3 extent = (m_max - m_min) * 0.5f;
+      glm::mat3 absMat(glm::abs(glm::vec3(mat[0])), glm::abs(glm::vec3(mat[1])), glm::abs(glm::vec3(mat[2])));
+      glm::vec3 newExtent = absMat * extent;
+
+      return BoundingBox(center - newExtent, center + newExtent);
+    }
+
+    /// Returns true if at least one point has been added to the box
+    bool isValid() const
+    {
+      return m_min.x <= m_max.x && m_min.y <= m_max.y && m_min.z <= m_max.z;
     }
 
     void expand(const glm::vec3& v)
@@ -35,12 +47,12 @@ namespace vr
       m_max = glm::max(m_max, other.max());
     }
 
-    glm::vec3 getCenter()
+    glm::vec3 getCenter() const
     {
       return (m_max - m_min) * 0.5f + m_min;
     }
 
-    float getRadius()
+    float getRadius() const
     {
       return glm::length((m_max - m_min)) * 0.5f;
     }
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "vr/BoundingBox.h"
+
+namespace vr {
+
+/**
+ * A view frustum described by six planes pointing inwards. The planes are
+ * extracted from a view-projection matrix (Gribb & Hartmann), so the same class
+ * works for perspective cameras and orthographic light volumes.
+ */
+class Frustum {
+   public:
+    enum Result {
+        OUTSIDE,
+        INTERSECT,
+        INSIDE
+    };
+
+    enum Plane {
+        PLANE_LEFT = 0,
+        PLANE_RIGHT,
+        PLANE_BOTTOM,
+        PLANE_TOP,
+        PLANE_NEAR,
+        PLANE_FAR,
+        PLANE_COUNT
+    };
+
+    /**
+     * @brief Constructs a frustum that contains everything
+     */
+    Frustum() {
+        for (int i = 0; i < PLANE_COUNT; i++)
+            m_planes[i] = glm::vec4(0, 0, 0, 1);
+    }
+
+    /**
+     * @brief Constructs the frustum of a view-projection matrix
+     *
+     * @param viewProjection The projection matrix multiplied with the view matrix
+     */
+    Frustum(const glm::mat4& viewProjection) {
+        // Rows of the matrix, glm matrices are column major
+        glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+        glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+        glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+        glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+        m_planes[PLANE_LEFT] = row3 + row0;
+        m_planes[PLANE_RIGHT] = row3 - row0;
+        m_planes[PLANE_BOTTOM] = row3 + row1;
+        m_planes[PLANE_TOP] = row3 - row1;
+        m_planes[PLANE_NEAR] = row3 + row2;
+        m_planes[PLANE_FAR] = row3 - row2;
+
+        for (int i = 0; i < PLANE_COUNT; i++)
+            m_planes[i] /= glm::length(glm::vec3(m_planes[i]));
+    }
+
+    /**
+     * @brief Classifies an axis aligned box against the frustum
+     *
+     * @param box The box in the same space as the frustum
+     * @return Result OUTSIDE, INTERSECT or INSIDE
+     */
+    Result intersect(const BoundingBox& box) const {
+        if (!box.isValid())
+            return OUTSIDE;
+
+        Result result = INSIDE;
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            glm::vec3 normal = glm::vec3(m_planes[i]);
+
+            // The corner furthest along the plane normal, and the one opposite to it
+            glm::vec3 positive = glm::mix(box.min(), box.max(), glm::vec3(glm::greaterThanEqual(normal, glm::vec3(0))));
+            glm::vec3 negative = glm::mix(box.max(), box.min(), glm::vec3(glm::greaterThanEqual(normal, glm::vec3(0))));
+
+            if (glm::dot(normal, positive) + m_planes[i].w < 0)
+                return OUTSIDE;
+
+            if (glm::dot(normal, negative) + m_planes[i].w < 0)
+                result = INTERSECT;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Classifies a sphere against the frustum
+     *
+     * @param center The center of the sphere
+     * @param radius The radius of the sphere
+     * @return Result OUTSIDE, INTERSECT or INSIDE
+     */
+    Result intersect(const glm::vec3& center, float radius) const {
+        Result result = INSIDE;
+        for (int i = 0; i < PLANE_COUNT; i++) {
+            float distance = glm::dot(glm::vec3(m_planes[i]), center) + m_planes[i].w;
+
+            if (distance < -radius)
+                return OUTSIDE;
+
+            if (distance < radius)
+                result = INTERSECT;
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns one of the planes as (normal, distance), with the normal pointing inwards
+     *
+     * @param plane The plane to return
+     * @return glm::vec4 The plane
+     */
+    const glm::vec4& getPlane(Plane plane) const { return m_planes[plane]; }
+
+   private:
+    glm::vec4 m_planes[PLANE_COUNT];
+};
+
+}  // namespace vr
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "Meshlet.h"
 #include "Node.h"
+#include "vr/State/Buffer.h"
+#include "vr/State/GeometryArena.h"
 #include "vr/Visitors/NodeVisitor.h"
 
 /**
@@ -8,6 +11,30 @@
  */
 
 namespace vr {
+
+class MeshletCuller;
+
+/**
+ * The part of a merged geometry that came from one source geometry, so a hit on the merged
+ * geometry can still be traced back to the mesh it belongs to
+ */
+struct SubMesh {
+    std::string name;
+    // Range of the sub-mesh in the index buffer
+    GLuint firstIndex;
+    GLuint indexCount;
+    // Bounds in the local space of the merged geometry
+    BoundingBox bounds;
+};
+
+/**
+ * Per-instance data of an instanced draw, read by the instance attributes of the shaders
+ */
+struct InstanceData {
+    glm::mat4 world;
+    glm::mat3 normalMatrix;
+};
+
 class Geometry : public Node {
    public:
     /**
@@ -16,7 +43,7 @@ class Geometry : public Node {
      * @param name  The name of the geometry
      * @param useVAO Whether to use VAOs or not
      */
-    Geometry(const std::string& name = "Geometry", bool useVAO = true) : Node(name), m_useVAO(useVAO) {}
+    Geometry(const std::string& name = "Geometry", bool useVAO = true) : Node(name), m_object2world(1.0f), m_initialTransform(1.0f), m_normalMatrix(1.0f), m_useVAO(useVAO) {}
 
     /**
      * @brief Constructs a new Geometry object with the given vertices, normals, texture coordinates and indices
@@ -38,16 +65,19 @@ class Geometry : public Node {
                                                                          m_tangents(tangents),
                                                                          m_bitangents(bitangents),
                                                                          m_indices(indices),
-                                                                         m_useVAO(useVAO) {}
+                                                                         m_object2world(1.0f),
+                                                                         m_initialTransform(1.0f),
+                                                                         m_normalMatrix(1.0f),
+                                                                         m_useVAO(useVAO) { updateLocalBounds(); }
     ~Geometry();
 
     virtual void accept(NodeVisitor& visitor) override;
 
     /**
-     * @brief Initializes the shader uniforms
+     * @brief Checks that a shader reads the attributes of the vertex format at their locations
      *
-     * @param shader The shader to initialize
-     * @return true if the shader was initialized successfully, false otherwise
+     * @param shader The shader to check
+     * @return true if the shader declares every attribute of the vertex format, false otherwise
      */
     bool initShader(const std::shared_ptr<vr::Shader>& shader);
 
@@ -64,7 +94,9 @@ class Geometry : public Node {
     void resetTransform();
 
     /**
-     * @brief Uploads the geometry to the GPU
+     * @brief Uploads the geometry to the GPU, packed into PackedVertex. Indexed geometries drawn with
+     *        vertex array objects are copied into the GeometryArena, the others get a buffer of their own.
+     *        Either way the indices are stored in 16 bits if there are few enough vertices.
      */
     void upload();
 
@@ -83,9 +115,94 @@ class Geometry : public Node {
      * @brief Draws the geometry
      *
      * @param shader The shader to use
-     * @param modelMatrix  The model matrix
+     * @param world The world matrix of the geometry, including its initial transform
+     * @param normalMatrix The inverse transpose of the upper 3x3 part of the world matrix
+     * @param meshlets The culler holding the visible index ranges of the geometry, nullptr to draw all triangles
+     */
+    void draw(std::shared_ptr<vr::Shader> const& shader, const glm::mat4& world, const glm::mat3& normalMatrix,
+              const MeshletCuller* meshlets = nullptr);
+
+    /**
+     * @brief Draws the geometry into a depth map. Only the world matrix is uploaded.
+     *
+     * @param shader The depth shader to use
+     * @param world The world matrix of the geometry, including its initial transform
+     * @param meshlets The culler holding the visible index ranges of the geometry, nullptr to draw all triangles
+     */
+    void drawDepth(std::shared_ptr<vr::Shader> const& shader, const glm::mat4& world, const MeshletCuller* meshlets = nullptr);
+
+    /**
+     * @brief Draws several instances of the geometry with a single draw call. The world and normal
+     *        matrices are read from a buffer of InstanceData, the shader must support instancing.
+     *
+     * @param shader The shader to use
+     * @param instances The buffer holding the instance data
+     * @param offset Offset in bytes of the first instance in the buffer
+     * @param count The number of instances to draw
+     * @param repeat The number of consecutive instances drawn with each entry of the buffer, e.g. once per layer
+     *               of a layered depth map. count * repeat instances are drawn in total.
+     */
+    void drawInstanced(std::shared_ptr<vr::Shader> const& shader, const Buffer& instances, GLintptr offset, GLsizei count,
+                       GLuint repeat = 1);
+
+    /**
+     * @brief Splits the triangles into meshlets that are culled one by one, or drops the meshlets again.
+     *        The geometry must be drawn with indices.
+     *
+     * @param enabled True to build the meshlets
+     */
+    void setMeshlets(bool enabled);
+
+    /// \return the meshlets of the geometry, empty if it is drawn as a whole
+    const std::vector<Meshlet>& getMeshlets() const { return m_meshlets; }
+
+    /**
+     * @brief Sets the sub-meshes of a geometry that was merged from several source geometries
+     *
+     * @param subMeshes The sub-meshes, in index buffer order
+     */
+    void setSubMeshes(const std::vector<SubMesh>& subMeshes) { m_subMeshes = subMeshes; }
+
+    /// \return the sub-meshes of a merged geometry, empty if the geometry was not merged
+    const std::vector<SubMesh>& getSubMeshes() const { return m_subMeshes; }
+
+    /**
+     * @brief Finds the sub-mesh an index of the index buffer belongs to, e.g. the first index of a picked triangle
+     *
+     * @param index Position in the index buffer
+     * @return int The index of the sub-mesh, -1 if the geometry was not merged or the index is out of range
+     */
+    int findSubMesh(GLuint index) const;
+
+    const std::vector<glm::vec4>& getVertices() const { return m_vertices; }
+    const std::vector<glm::vec3>& getNormals() const { return m_normals; }
+    const std::vector<glm::vec2>& getTexCoords() const { return m_texCoords; }
+    const std::vector<glm::vec3>& getTangents() const { return m_tangents; }
+    const std::vector<glm::vec3>& getBitangents() const { return m_bitangents; }
+    const std::vector<GLuint>& getIndices() const { return m_indices; }
+
+    /// \return true if the vertices and indices are stored in the GeometryArena
+    bool inArena() const { return m_arenaRange.block >= 0; }
+
+    /// \return the range of the geometry in the GeometryArena, its block is -1 if it is not in the arena
+    const ArenaRange& getArenaRange() const { return m_arenaRange; }
+
+    /// \return the size in bytes of one index in the index buffer
+    size_t getIndexSize() const { return m_indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint); }
+
+    /**
+     * @brief Gets the initial transform of the geometry, which is applied before any Transform node
+     *
+     * @return glm::mat4 The object to world matrix
      */
-    void draw(std::shared_ptr<vr::Shader> const& shader, const glm::mat4& modelMatrix, bool depthPass = false);
+    const glm::mat4& getObjectMatrix() const { return m_object2world; }
+
+    /**
+     * @brief Gets the inverse transpose of the upper 3x3 part of the initial transform
+     *
+     * @return glm::mat3 The normal matrix of the initial transform
+     */
+    const glm::mat3& getNormalMatrix() const { return m_normalMatrix; }
 
     /**
      * @brief Draws the bounding box of the geometry
@@ -95,14 +212,82 @@ class Geometry : public Node {
     void draw_bbox(std::shared_ptr<vr::Shader> shader);
 
     /**
-     * @brief Calculates the bounding box of the geometry
+     * @brief Calculates the bounding box of the geometry by transforming its local bounds
      *
      * @param t_mat The transformation matrix
      * @return The bounding box
      */
     virtual BoundingBox calculateBoundingBox(glm::mat4 t_mat) override;
 
+    /**
+     * @brief Returns the world space bounding box of the geometry
+     *
+     * @param world The world matrix of the closest transform above the geometry
+     * @return The bounding box
+     */
+    virtual BoundingBox getBounds(const glm::mat4& world) override;
+
+    /**
+     * @brief Returns the bounds of the vertices, before the initial transform is applied
+     *
+     * @return The local bounding box
+     */
+    const BoundingBox& getLocalBounds() const { return m_localBounds; }
+
    private:
+    /**
+     * @brief Binds the vertex data and issues the draw call
+     *
+     * @param shader The shader to use
+     * @param instances Buffer of InstanceData for instanced draws, nullptr for a single draw
+     * @param offset Offset in bytes of the first instance in the buffer
+     * @param count The number of instances to draw
+     * @param repeat The number of instances drawn with each entry of the instance buffer
+     * @param meshlets The culler holding the index ranges to draw, nullptr to draw all triangles
+     */
+    void submit(std::shared_ptr<vr::Shader> const& shader, const Buffer* instances = nullptr, GLintptr offset = 0, GLsizei count = 1,
+                GLuint repeat = 1, const MeshletCuller* meshlets = nullptr);
+
+    /**
+     * @brief Points the instance attributes at a range of a buffer of InstanceData
+     *
+     * @param instances The buffer holding the instance data
+     * @param offset Offset in bytes of the first instance in the buffer
+     * @param divisor The number of instances each entry is used for
+     */
+    void enableInstanceAttributes(const Buffer& instances, GLintptr offset, GLuint divisor);
+
+    /**
+     * @brief Disables the instance attributes again, so single draws read the world matrix uniform
+     */
+    void disableInstanceAttributes();
+
+    /**
+     * @brief Computes the local bounds from the vertices. Only done when the vertices are set.
+     */
+    void updateLocalBounds();
+
+    /**
+     * @brief Points the vertex attributes at the packed vertex buffer, following PACKED_VERTEX_LAYOUT
+     */
+    void bindVertexFormat();
+
+    /**
+     * @brief Packs the vertex arrays into the GPU format
+     *
+     * @param packed Receives one packed vertex per vertex
+     */
+    void packVertices(std::vector<PackedVertex>& packed) const;
+
+    /**
+     * @brief Sets the uniforms that decode the quantized positions, if the shader reads packed vertices
+     *
+     * @param shader The shader to use
+     * @param offset The position a quantized 0 decodes to
+     * @param scale The difference between the positions a quantized 1 and 0 decode to
+     */
+    void setPositionDecode(std::shared_ptr<vr::Shader> const& shader, const glm::vec3& offset, const glm::vec3& scale);
+
     std::vector<glm::vec4> m_vertices;
     std::vector<glm::vec3> m_normals;
     std::vector<glm::vec2> m_texCoords;
@@ -110,19 +295,21 @@ class Geometry : public Node {
     std::vector<glm::vec3> m_bitangents;
 
     std::vector<GLuint> m_indices;
+    std::vector<Meshlet> m_meshlets;
+    std::vector<SubMesh> m_subMeshes;
 
     glm::mat4 m_object2world;
     glm::mat4 m_initialTransform;
-
-    GLint m_attribute_v_coord = -1;
-    GLint m_attribute_v_normal = -1;
-    GLint m_attribute_v_texCoords = -1;
-    GLint m_attribute_v_tangent = -1;
-    GLint m_attribute_v_bitangent = -1;
+    glm::mat3 m_normalMatrix;
+    BoundingBox m_localBounds;
 
     bool m_useVAO;
-    GLuint m_vao;
-    GLuint m_vbo_vertices = 0, m_vbo_normals = 0, m_vbo_texCoords = 0, m_ibo_elements = 0, m_vbo_tangents = 0, m_vbo_bitangents = 0;
+    GLuint m_vao = 0;
+    GLuint m_vbo_vertices = 0, m_ibo_elements = 0;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum m_indexType = GL_UNSIGNED_INT;
+    // The range in the arena, the vertex array object and buffers above are not used when it is set
+    ArenaRange m_arenaRange;
 };
 
 }  // namespace vr
\ No newline at end of file
@@ -15,7 +15,7 @@ class Group : public Node {
      *
      * @param name
      */
-    Group(const std::string& name = "Group", bool excludeFromBoundingBox = false) : m_excludeFromBoundingBox(excludeFromBoundingBox), Node(name) {}
+    Group(const std::string& name = "Group", bool excludeFromBoundingBox = false) : Node(name), m_excludeFromBoundingBox(excludeFromBoundingBox), m_boundsDirty(true) {}
 
     virtual void accept(NodeVisitor& visitor) override;
 
@@ -27,13 +27,43 @@ class Group : public Node {
     void addChild(std::shared_ptr<Node> node);
 
     /**
-     * @brief Calculate the bounding box of the group
+     * @brief Calculate the bounding box of the group by traversing all children.
+     *        The result is also stored as the cached bounds of the group.
      *
      * @param t_mat The transformation matrix
-     * @return BoundingBox The bounding box of the group
+     * @return BoundingBox The bounding box of the group, empty if the group is excluded
      */
     virtual BoundingBox calculateBoundingBox(glm::mat4 t_mat) override;
 
+    /**
+     * @brief Returns the cached bounds of the group, which are already in world space
+     *
+     * @return BoundingBox The cached bounding box, empty if the group is excluded
+     */
+    virtual BoundingBox getBounds(const glm::mat4&) override;
+
+    /**
+     * @brief Recomputes the cached bounds from the bounds of the children, without traversing further down.
+     *        Child groups must already have been refit.
+     *
+     * @param world The world matrix of the closest transform, including this node if it is a transform
+     */
+    void refitBounds(const glm::mat4& world);
+
+    /**
+     * @brief Returns the cached world space bounds of the group, also if the group is excluded
+     *
+     * @return BoundingBox The cached bounding box
+     */
+    const BoundingBox& getCachedBounds() const { return m_bounds; }
+
+    /**
+     * @brief Checks if the cached bounds are out of date because the children changed
+     *
+     * @return bool True if the bounds need to be refit
+     */
+    bool boundsDirty() const { return m_boundsDirty; }
+
     /**
      * @brief Get the children of the group
      *
@@ -51,11 +81,21 @@ class Group : public Node {
     /**
      * @brief set the exclude from bounding box flag
      */
-    void setExclude(bool exclude) { m_excludeFromBoundingBox = exclude; }
+    void setExclude(bool exclude) {
+        m_excludeFromBoundingBox = exclude;
+        m_boundsDirty = true;
+    }
+
+    /**
+     * @brief Checks if the group is excluded from the bounding box of its parent
+     */
+    bool isExcluded() const { return m_excludeFromBoundingBox; }
 
    protected:
     NodeVector m_children;
     bool m_excludeFromBoundingBox;
+    BoundingBox m_bounds;
+    bool m_boundsDirty;
 };
 
 }  // namespace vr
\ No newline at end of file
@@ -15,7 +15,7 @@ class LodNode : public Node {
      *
      * @param name The name of the node
      */
-    LodNode(const std::string& name = "LodNode") : m_maxDistance(-1), Node(name) {}
+    LodNode(const std::string& name = "LodNode") : Node(name), m_maxDistance(-1), m_boundsDirty(true) {}
     virtual void accept(NodeVisitor& visitor) override;
 
     /**
@@ -27,6 +27,20 @@ class LodNode : public Node {
      */
     virtual BoundingBox calculateBoundingBox(glm::mat4 m_mat) override;
 
+    /**
+     * @brief Returns the bounding box cached by the last call to calculateBoundingBox, which is already in world space
+     *
+     * @return BoundingBox The bounding box of the geometry with the highest level of detail
+     */
+    virtual BoundingBox getBounds(const glm::mat4&) override;
+
+    /**
+     * @brief Checks if the cached bounds are out of date because levels were added
+     *
+     * @return bool True if the bounds need to be calculated
+     */
+    bool boundsDirty() const { return m_boundsDirty; }
+
     /**
      * @brief Add a child node to the group
      *
@@ -43,6 +57,21 @@ class LodNode : public Node {
      */
     Group* getChild(const glm::vec3& cameraPosition);
 
+    /**
+     * @brief Get the child node that should be used at the given distance
+     *
+     * @param distance The distance from the camera to the center of the highest level of detail
+     * @return Group The child node that should be used, nullptr if nothing is rendered at that distance
+     */
+    Group* getChild(float distance);
+
+    /**
+     * @brief Get all levels of detail, sorted by distance
+     *
+     * @return std::vector<GroupPair> The distance/group pairs of the node
+     */
+    std::vector<GroupPair>& getChildren();
+
     /**
      * @brief Set the maximum distance. If this is set, intervals will be calculated based on the maximum distance.
      *
@@ -55,6 +84,7 @@ class LodNode : public Node {
         m_children;
     float m_maxDistance;
     BoundingBox bbox;
+    bool m_boundsDirty;
 };
 
 }  // namespace vr
\ No newline at end of file
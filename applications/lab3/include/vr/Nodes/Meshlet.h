@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Limits of a meshlet, small enough that a meshlet covers a small part of a large mesh
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+namespace vr {
+
+/**
+ * A run of consecutive triangles of a geometry, with bounds that allow culling it on its own.
+ * Everything is in the local space of the geometry.
+ */
+struct Meshlet {
+    // Bounding sphere of the vertices
+    glm::vec3 center;
+    float radius;
+    // Axis of a cone containing the triangle normals, and the sine of the angle between the axis and
+    // the widest normal. 1 if the normals are spread too wide for the meshlet to ever face away.
+    glm::vec3 coneAxis;
+    float coneCutoff;
+    // A point on the axis behind the planes of all triangles. Viewers inside the cone around the
+    // axis opening from this point towards -axis see only back faces.
+    glm::vec3 coneApex;
+    // Range of the meshlet in the index buffer
+    GLuint firstIndex;
+    GLuint indexCount;
+};
+
+/**
+ * @brief Splits triangles into meshlets of at most MESHLET_MAX_VERTICES vertices and MESHLET_MAX_TRIANGLES
+ *        triangles. The triangles keep their order, so it should already be optimized for locality.
+ *
+ * @param vertices The positions
+ * @param indices Three indices per triangle
+ * @param meshlets Receives the meshlets, covering all triangles in order
+ */
+void buildMeshlets(const std::vector<glm::vec4>& vertices, const std::vector<GLuint>& indices, std::vector<Meshlet>& meshlets);
+
+}  // namespace vr
@@ -33,6 +33,15 @@ class Node {
      */
     virtual BoundingBox calculateBoundingBox(glm::mat4 t_mat) = 0;
 
+    /**
+     * @brief Returns the world space bounding box of the node without traversing the subtree.
+     *        Groups return the bounds cached by their last refit, other nodes transform their local bounds.
+     *
+     * @param world The world matrix of the closest transform above the node
+     * @return BoundingBox The bounding box of the node
+     */
+    virtual BoundingBox getBounds(const glm::mat4& /* world */) { return BoundingBox(); }
+
     /**
      * @brief Returns the name of the node
      *
@@ -73,7 +82,10 @@ class Node {
      *
      * @param state The state to set
      */
-    void setState(std::shared_ptr<State> state) { m_state = state; }
+    void setState(std::shared_ptr<State> state) {
+        m_state = state;
+        graphChanged();
+    }
 
     /**
      * @brief Gets the state of the node
@@ -82,7 +94,22 @@ class Node {
      */
     std::shared_ptr<State>& getState() { return m_state; }
 
+    /**
+     * @brief Returns a counter that is incremented every time the structure of the scene graph changes,
+     *        i.e. when children are added or a state is replaced. Used to detect stale render lists.
+     *
+     * @return unsigned int The current graph version
+     */
+    static unsigned int graphVersion() { return s_graphVersion; }
+
    protected:
+    /**
+     * @brief Marks the scene graph as structurally changed
+     */
+    static void graphChanged() { s_graphVersion++; }
+
+    static unsigned int s_graphVersion;
+
     UpdateCallbackVector m_updateCallbacks;
     std::string m_name;
     std::shared_ptr<State> m_state;
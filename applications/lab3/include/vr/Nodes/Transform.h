@@ -9,7 +9,7 @@
 namespace vr {
 class Transform : public Group {
    public:
-    Transform(const std::string& name = "Transform") : Group(name) {}
+    Transform(const std::string& name = "Transform") : Group(name), t_matrix(1.0f), m_worldMatrix(1.0f), m_normalMatrix(1.0f), m_worldVersion(0), m_worldParent(nullptr), m_parentWorldVersion(0), isDirty(true) {}
     virtual void accept(NodeVisitor& visitor) override;
 
     /**
@@ -40,10 +40,45 @@ class Transform : public Group {
      */
     void setDirty(bool dirty) { isDirty = dirty; }
 
+    /**
+     * @brief Recomputes the cached world and normal matrices if this transform is dirty,
+     *        or if the parent or its world matrix changed since the last update
+     *
+     * @param parent The closest transform above this node, nullptr if there is none
+     * @return true if the cached matrices were recomputed
+     */
+    bool updateWorldMatrix(const Transform* parent);
+
+    /**
+     * @brief Gets the cached world matrix, i.e. the product of all transforms from the root down to this node
+     *
+     * @return glm::mat4 The world matrix
+     */
+    const glm::mat4& getWorldMatrix() const { return m_worldMatrix; }
+
+    /**
+     * @brief Gets the cached normal matrix, the inverse transpose of the upper 3x3 part of the world matrix
+     *
+     * @return glm::mat3 The normal matrix
+     */
+    const glm::mat3& getNormalMatrix() const { return m_normalMatrix; }
+
+    /**
+     * @brief Returns a counter that is incremented every time the cached world matrix is recomputed
+     *
+     * @return unsigned int The version of the world matrix
+     */
+    unsigned int getWorldVersion() const { return m_worldVersion; }
+
     virtual BoundingBox calculateBoundingBox(glm::mat4 t_mat) override;
 
    private:
     glm::mat4 t_matrix;
+    glm::mat4 m_worldMatrix;
+    glm::mat3 m_normalMatrix;
+    unsigned int m_worldVersion;
+    const Transform* m_worldParent;
+    unsigned int m_parentWorldVersion;
     bool isDirty;
 };
 }  // namespace vr
\ No newline at end of file
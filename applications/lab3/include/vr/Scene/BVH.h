@@ -0,0 +1,133 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "RenderList.h"
+#include "vr/BoundingBox.h"
+#include "vr/Frustum.h"
+
+// Maximum number of items stored in a leaf of the BVH
+#define BVH_MAX_LEAF_ITEMS 4
+// The tree is rebuilt when refitting has grown the surface area of the root by this factor
+#define BVH_REBUILD_FACTOR 2.0f
+
+namespace vr {
+
+/**
+ * A node of the BVH. Inner nodes have two children, leaves a range of items.
+ */
+struct BVHNode {
+    BoundingBox bounds;
+    int parent;
+    int left;
+    int right;
+    // Range of the leaf in the item index array, count is 0 for inner nodes
+    int first;
+    int count;
+    bool dirty;
+};
+
+/**
+ * Statistics from the queries since the last reset
+ */
+struct BVHStats {
+    // Nodes whose bounds were tested
+    unsigned int visited;
+    // Nodes rejected by the test, including their subtrees
+    unsigned int culled;
+};
+
+/**
+ * A bounding volume hierarchy over the items of a render list, indexed by their world space bounds.
+ * The tree is built with median splits when the list is compiled. When transforms change the bounds
+ * of the moved items are updated and only the paths from their leaves to the root are refit.
+ * Query results are indices into the items of the render list.
+ */
+class BVH {
+   public:
+    BVH();
+
+    /**
+     * @brief Builds the tree from the bounds of all items in the list
+     *
+     * @param renderList The compiled render list
+     */
+    void build(const RenderList& renderList);
+
+    /**
+     * @brief Updates the bounds of the items that changed in the last update of the render list
+     *        and refits the tree. The tree is rebuilt if its quality degraded too much.
+     *
+     * @param renderList The render list the tree was built from
+     */
+    void refit(const RenderList& renderList);
+
+    /**
+     * @brief Finds the items overlapping a frustum
+     *
+     * @param frustum The frustum in world space
+     * @param result Indices of the overlapping items are appended to this vector
+     */
+    void query(const Frustum& frustum, std::vector<int>& result);
+
+    /**
+     * @brief Finds the items overlapping a sphere
+     *
+     * @param center The center of the sphere in world space
+     * @param radius The radius of the sphere
+     * @param result Indices of the overlapping items are appended to this vector
+     */
+    void query(const glm::vec3& center, float radius, std::vector<int>& result);
+
+    /**
+     * @brief Finds the items overlapping a box
+     *
+     * @param box The box in world space
+     * @param result Indices of the overlapping items are appended to this vector
+     */
+    void query(const BoundingBox& box, std::vector<int>& result);
+
+    /**
+     * @brief Get the bounds of all items in the tree
+     *
+     * @return BoundingBox The bounds of the root node, empty if the tree is empty
+     */
+    BoundingBox getBounds() const;
+
+    /**
+     * @brief Resets the query statistics
+     */
+    void resetStatistics();
+
+    /**
+     * @brief Get the statistics of the queries since the last reset
+     *
+     * @return BVHStats The number of visited and culled nodes
+     */
+    const BVHStats& getStatistics() const;
+
+    /**
+     * @brief Get the number of nodes in the tree
+     */
+    size_t size() const { return m_nodes.size(); }
+
+   private:
+    int buildNode(int parent, int first, int last);
+    void collect(int node, std::vector<int>& result);
+
+    std::vector<BVHNode> m_nodes;
+    // Item indices, each leaf owns a contiguous range
+    std::vector<int> m_indices;
+    // Bounds of every item, indexed by item
+    std::vector<BoundingBox> m_itemBounds;
+    // Leaf of every item, indexed by item
+    std::vector<int> m_itemLeaf;
+    // Stack reused by the queries
+    std::vector<int> m_stack;
+
+    float m_builtArea;
+    BVHStats m_stats;
+};
+
+}  // namespace vr
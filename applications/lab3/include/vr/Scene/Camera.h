@@ -3,12 +3,26 @@
 // clang-format off
 #include <glm/glm.hpp>
 #include <vr/State/Shader.h>
+#include <vr/Frustum.h>
 #include <GLFW/glfw3.h>
 #include <memory>
 #include <glm/gtc/constants.hpp>
 
 namespace vr
 {
+  /**
+  The camera as it is stored in the CameraBlock uniform block of the shaders, std140 layout
+  */
+  struct CameraData
+  {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec4 position;  // w is 1
+    glm::vec2 nearFar;
+    glm::vec2 screenSize;
+  };
+
   /**
   Class that defines a Camera for OpenGL.
   Handles keyboard events, handles Uniforms for view, projection and model matrix
@@ -61,11 +75,29 @@ namespace vr
     float getFOV() const;
 
     /**
-    Called when uniforms should be processed within the active program
+    Called when uniforms should be processed within the active program.
+    Only needed for shaders that do not read the camera from the CameraBlock uniform block.
     \param program
     */
     void apply(std::shared_ptr<vr::Shader> shader);
 
+    /**
+    Write the camera in the layout of the CameraBlock uniform block, as of the last call to updateMatrices
+    \param data The data to write to
+    */
+    void pack(CameraData& data) const;
+
+    /**
+    Compute the view and projection matrices from the current position, direction and screen size
+    */
+    void updateMatrices();
+
+    /**
+    Get the view frustum of the camera, as of the last call to updateMatrices
+    \return The frustum in world space
+    */
+    Frustum getFrustum() const;
+
     /**
     Set the overall transform of the camera (position, up, direction)
     \param transform
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "BVH.h"
+#include "InstanceBatcher.h"
+#include "Light.h"
+#include "MeshletCuller.h"
+#include "RenderList.h"
+#include "ShadowCache.h"
+#include "vr/Frustum.h"
+#include "vr/State/Shader.h"
+
+// Caster faces (one caster drawn to one cube face) every point shadow path has to render before the fastest one is picked
+#define POINT_SHADOW_BENCHMARK_FACES 2000
+// Frames after which the benchmark ends even if a path has not rendered enough caster faces. Cached point shadow
+// maps of a static scene are not rendered again, so the face count alone may never be reached.
+#define POINT_SHADOW_BENCHMARK_FRAMES 300
+
+/**
+ * Renders the items of the render list to a depth buffer from the perspective of a given light source.
+ * Does not apply any states. Shadow casters are found by querying the BVH with the volume of the light,
+ * and geometries of point lights are only rendered to the requested cube faces they overlap.
+ * Casters sharing geometry (and cube faces) are drawn with instanced draws.
+ *
+ * Point lights can be rendered in three ways, and which one is fastest depends on the driver: a geometry
+ * shader copying every triangle to its faces, one pass per cube face, or one instance per face with the
+ * vertex shader selecting the layer. The first point shadow maps are rendered with each path in turn,
+ * timed on the GPU, and the rest with the path that took the least time per face.
+ */
+
+namespace vr {
+
+class DepthRenderer {
+   public:
+    enum PointShadowMode {
+        POINT_SHADOW_GEOMETRY_SHADER = 0,
+        POINT_SHADOW_PER_FACE = 1,
+        POINT_SHADOW_LAYERED = 2,
+        POINT_SHADOW_MODES = 3
+    };
+
+    DepthRenderer();
+    ~DepthRenderer();
+
+    /// \return a readable name of a point shadow path
+    static const char* modeName(PointShadowMode mode);
+
+    /**
+     * @brief Is called before the casters of a light are rendered.
+     * This is done to set up the render state for the light, i.e bind
+     * the appropriate depth shader and texture.
+     *
+     * @param light The light to set up the render state for
+     * @param depthMapIndex Index of light in its respective depth map array
+     * @param textureUnit The id of the texture to bind to the framebuffer
+     * @param faces The cube faces of a point light or the cascades of a directional light to clear and render,
+     *              the others are left untouched
+     * @param resolution The width and height of the depth maps in the texture
+     */
+    void setupRenderState(const std::shared_ptr<Light> light, int depthMapIndex, unsigned int textureID, int faces = ALL_CUBE_FACES,
+                          unsigned int resolution = DEPTH_MAP_RESOLUTION);
+
+    /**
+     * @brief Renders the shadow casters of the light passed to setupRenderState, once per cascade for directional lights
+     *
+     * @param renderList The compiled render list, updated for this frame
+     * @param bvh A BVH built over the items of the render list
+     */
+    void render(const RenderList& renderList, BVH& bvh);
+
+    /**
+     * @brief Collects the finished timings of the benchmark and picks the point shadow path of this frame,
+     *        called once per frame before the depth maps are rendered. Also resets the statistics.
+     */
+    void beginFrame();
+
+    /**
+     * @brief Resets the caster statistics
+     */
+    void resetStatistics();
+
+    /// \return the path point shadow maps are rendered with
+    PointShadowMode pointShadowMode() const { return m_mode; }
+
+    /// \return true while the point shadow paths are still being timed
+    bool benchmarking() const { return m_benchmarking; }
+
+    /**
+     * @brief Get the measured cost of a point shadow path
+     *
+     * @param mode The path
+     * @return double Nanoseconds per caster face, -1 if the path is not supported or has not been timed yet
+     */
+    double benchmarkResult(PointShadowMode mode) const;
+
+    /**
+     * @brief Get the number of geometries rendered to a depth map since the last reset, counted once per light
+     */
+    unsigned int castersDrawn() const { return m_castersDrawn; }
+
+    /**
+     * @brief Get the number of BVH nodes and geometries rejected since the last reset, counted once per light
+     */
+    unsigned int castersCulled() const { return m_castersCulled; }
+
+    /**
+     * @brief Get the number of caster faces rendered to point shadow maps since the last reset, each caster
+     *        counted once per cube face it was rendered to
+     */
+    unsigned int facesDrawn() const { return m_facesDrawn; }
+
+    /**
+     * @brief Get the number of draw calls issued since the last reset
+     */
+    unsigned int drawCalls() const { return m_drawCalls; }
+
+    /**
+     * @brief Get the number of indirect commands submitted by those draw calls since the last reset
+     */
+    unsigned int indirectCommands() const { return m_indirectCommands; }
+
+    /**
+     * @brief Get the meshlets culled against the light volumes since the last reset
+     */
+    const MeshletStats& meshletStatistics() const { return m_meshletCuller.getStatistics(); }
+
+   private:
+    // A point depth program and the uniforms of the light, those a program does not declare stay invalid
+    struct PointDepthProgram {
+        std::shared_ptr<Shader> shader;
+        Uniform shadowMatrices[6];
+        Uniform shadowMatrix;
+        Uniform farPlane;
+        Uniform lightPos;
+        Uniform depthMapIndex;
+        Uniform faceMask;
+        Uniform faces;
+        Uniform faceCount;
+    };
+
+    // A timer query of one point light, read back once the GPU has finished it
+    struct PendingQuery {
+        GLuint query;
+        PointShadowMode mode;
+        unsigned int casterFaces;
+    };
+
+    /**
+     * @brief Loads a point depth program and resolves its uniforms
+     */
+    void loadPointProgram(PointShadowMode mode, const std::string& vertexPath, const std::string& geometryPath = "");
+
+    /**
+     * @brief Reads the timer queries that are available without waiting, and picks the fastest path once
+     *        every supported path has rendered enough caster faces or the frame limit is reached
+     */
+    void collectBenchmark();
+
+    /**
+     * @brief Culls and draws the casters inside the volume of the active point light or cascade
+     */
+    void renderCasters(const RenderList& renderList, BVH& bvh);
+
+    /**
+     * @brief Draws the casters of the active point light found by renderCasters, with the path of this frame
+     */
+    void renderPointCasters();
+
+    /**
+     * @brief Get the cube faces of the active point light that a box overlaps
+     *
+     * @param box The world space box
+     * @return int One bit per face, in the order of the shadow matrices
+     */
+    int faceMask(const BoundingBox& box) const;
+
+    std::shared_ptr<Light> m_activeLight;
+    GLuint fbo;
+
+    int depthMapIndex;
+    GLuint m_textureID;
+    int m_faces;
+    bool m_pointLight;
+
+    // Volume of the active light, the ortho volume of the current cascade for directional lights and
+    // a sphere and one frustum per cube face for point lights
+    Frustum m_lightFrustum;
+    Frustum m_faceFrusta[6];
+    glm::vec3 m_lightPosition;
+    float m_lightRange;
+
+    // Result of the BVH query, and the point light casters with the faces they overlap, reused between lights
+    std::vector<int> m_casters;
+    std::vector<std::pair<const RenderItem*, int>> m_pointCasters;
+    InstanceBatcher m_batcher;
+    // Culls meshlets against the cascade or cube face being drawn, back faces are kept for the depth maps
+    MeshletCuller m_meshletCuller;
+
+    PointShadowMode m_mode;
+    bool m_benchmarking;
+    bool m_supported[POINT_SHADOW_MODES];
+    GLuint64 m_benchmarkTime[POINT_SHADOW_MODES];
+    unsigned int m_benchmarkFaces[POINT_SHADOW_MODES];
+    unsigned int m_benchmarkFrames;
+    std::vector<GLuint> m_freeQueries;
+    std::vector<PendingQuery> m_pendingQueries;
+
+    unsigned int m_castersDrawn;
+    unsigned int m_castersCulled;
+    unsigned int m_facesDrawn;
+    unsigned int m_drawCalls;
+    unsigned int m_indirectCommands;
+
+    std::shared_ptr<Shader> m_directionalDepthShader;
+    std::shared_ptr<Shader> m_depthShader;
+    Uniform m_lsmUniform;
+
+    PointDepthProgram m_pointPrograms[POINT_SHADOW_MODES];
+};
+
+}  // namespace vr
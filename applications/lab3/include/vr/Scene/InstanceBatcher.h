@@ -0,0 +1,167 @@
+#pragma once
+
+#include <vector>
+
+#include "MeshletCuller.h"
+#include "RenderList.h"
+#include "vr/Nodes/Geometry.h"
+#include "vr/State/Buffer.h"
+
+// Shader storage binding of the DrawBuffer of indirect draws
+#define DRAW_BUFFER_BINDING 4
+
+namespace vr {
+
+/**
+ * Per-draw data of an indirect draw, read from the DrawBuffer at the draw index. The layout is
+ * std430, the columns of the normal matrix are padded to vec4 and each vec3 shares 16 bytes with the int after it.
+ */
+struct DrawData {
+    glm::mat4 world;
+    glm::vec4 normalMatrix[3];
+    glm::vec3 positionOffset;
+    GLint materialIndex;
+    glm::vec3 positionScale;
+    GLint padding;
+};
+
+/**
+ * A command of glMultiDrawElementsIndirect
+ */
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    // The first draw index, draws read their DrawData at baseInstance + gl_InstanceID / repeat
+    GLuint baseInstance;
+};
+
+/**
+ * A run of render items that share geometry, state and key, drawn with one instanced draw call
+ */
+struct InstanceBatch {
+    Geometry* geometry;
+    State* state;
+    int key;
+    // Index of the first instance, in the instance buffer and in the items of the batcher
+    int first;
+    int count;
+};
+
+/**
+ * Groups the render items drawn by a pass into instanced batches. Geometries shared through the
+ * GeometryMap appear once per reference in the render list; every item with the same geometry,
+ * resolved state and key is merged into one batch, and the world and normal matrices of the
+ * items are uploaded to a per-instance buffer.
+ *
+ * Batches of geometries in the GeometryArena drawn with a shader that supports indirect draws are
+ * not drawn right away. Their transforms and material indices are appended to a buffer of DrawData
+ * and their commands are collected until flush, which submits all commands of an arena block with
+ * one glMultiDrawElementsIndirect. Anything that changes state the collected draws depend on, e.g.
+ * textures or uniforms other than the material index, has to flush first.
+ */
+class InstanceBatcher {
+   public:
+    InstanceBatcher();
+
+    /**
+     * @brief Removes the items of the previous pass
+     */
+    void begin();
+
+    /**
+     * @brief Adds an item to the pass
+     *
+     * @param item The item to draw
+     * @param state The state the item is drawn with, nullptr if the pass does not apply states
+     * @param key Extra value items must share to be batched, e.g. the cube faces of a point light
+     */
+    void add(const RenderItem* item, State* state, int key = 0);
+
+    /**
+     * @brief Sorts the items into batches and uploads the instance data
+     */
+    void end();
+
+    /**
+     * @brief Sets the culler that the meshlets of items drawn one by one or indirectly are culled with.
+     *        Instanced draws always draw every meshlet.
+     *
+     * @param culler The culler, set up for the view of the pass, or nullptr to draw geometries whole
+     */
+    void setMeshletCuller(MeshletCuller* culler) { m_culler = culler; }
+
+    /**
+     * @brief Draws a batch, with a single instanced draw if the shader supports it and the batch has
+     *        more than one item, otherwise one draw per item. Only the world matrix is needed by depth passes.
+     *
+     * @param batch The batch to draw
+     * @param shader The shader the state of the batch uses
+     * @param depth True to draw the items into a depth map
+     * @param repeat The number of instances drawn per item, e.g. one per layer of a layered depth map.
+     *               The batch is always drawn instanced if this is more than one.
+     * @param materialIndex The index of the material in the material table, for indirect draws
+     */
+    void draw(const InstanceBatch& batch, const std::shared_ptr<Shader>& shader, bool depth, GLuint repeat = 1,
+              GLint materialIndex = 0);
+
+    /**
+     * @brief Submits the indirect draws collected since the last flush. The shader they were collected
+     *        with has to be in use.
+     */
+    void flush();
+
+    const std::vector<InstanceBatch>& getBatches() const { return m_batches; }
+
+    /// \return the item of an instance, batches own the instances [first, first + count)
+    const RenderItem* getItem(int instance) const { return m_entries[instance].item; }
+
+    /// \return the number of draw calls issued since the last call to begin
+    unsigned int drawCalls() const { return m_drawCalls; }
+
+    /// \return the number of indirect commands submitted since the last call to begin
+    unsigned int indirectCommands() const { return m_indirectCommands; }
+
+    /// \return the number of items added since the last call to begin
+    unsigned int instances() const { return m_entries.size(); }
+
+   private:
+    struct Entry {
+        const RenderItem* item;
+        State* state;
+        int key;
+    };
+
+    /**
+     * An indirect command waiting for flush, and the arena block it draws from
+     */
+    struct PendingCommand {
+        int block;
+        DrawElementsIndirectCommand command;
+    };
+
+    /**
+     * @brief Appends the items of a batch to the indirect draws, flushing first if the shader or repeat changes
+     */
+    void queue(const InstanceBatch& batch, const std::shared_ptr<Shader>& shader, GLuint repeat, GLint materialIndex);
+
+    std::vector<Entry> m_entries;
+    std::vector<InstanceData> m_instances;
+    std::vector<InstanceBatch> m_batches;
+    Buffer m_buffer;
+    MeshletCuller* m_culler;
+    unsigned int m_drawCalls;
+
+    // Indirect draws waiting for flush, and the shader and repeat they were collected with
+    std::vector<DrawData> m_draws;
+    std::vector<PendingCommand> m_pending;
+    std::vector<DrawElementsIndirectCommand> m_commands;
+    std::shared_ptr<Shader> m_pendingShader;
+    GLuint m_pendingRepeat;
+    Buffer m_drawBuffer;
+    Buffer m_commandBuffer;
+    unsigned int m_indirectCommands;
+};
+
+}  // namespace vr
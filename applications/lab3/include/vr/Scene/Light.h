@@ -9,11 +9,51 @@
 
 #include "vr/BoundingBox.h"
 
+// Contribution below which a light is considered to have no effect, one step of an 8 bit channel
+#define LIGHT_CUTOFF (1.0f / 256.0f)
+
 namespace vr {
 
+class Camera;
+
+/**
+ * A light as it is stored in the light buffer of the lighting shader, laid out to match
+ * the LightSource struct of the shader under the std430 rules
+ */
+struct LightData {
+    glm::vec4 position;  // World space, w is 0 for directional lights
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+    // Light space matrices of the cascades of a directional light, and the view depth each cascade ends at
+    glm::mat4 cascadeMatrices[SHADOW_CASCADES];
+    glm::vec4 cascadeSplits;
+    float constant;
+    float linear;
+    float quadratic;
+    float farPlane;
+    int enabled;
+    int shadowMapIndex;
+    // Resolution tier of the shadow map of a point light, -1 if it has none
+    int shadowTier;
+    // Light::ShadowFilter, the struct ends on a multiple of 16 bytes, the alignment of its vec4 members
+    int shadowFilter;
+};
+
 /// Simple class that store light properties and apply them to Uniforms
 class Light {
    public:
+    /**
+     * How the shadow map of the light is filtered when it is sampled
+     */
+    enum ShadowFilter {
+        // Hardware depth comparisons over a rotated Poisson disk
+        SHADOW_FILTER_PCF = 0,
+        // Exponential shadow map, blurred once after rendering and sampled with a single bilinear fetch.
+        // Only supported by directional lights.
+        SHADOW_FILTER_ESM = 1
+    };
+
     /**
      * @brief Construct a new Light
      *
@@ -25,13 +65,27 @@ class Light {
     Light(glm::vec4 position, glm::vec4 ambient, glm::vec4 diffuse, glm::vec4 specular);
 
     /**
-     * @brief Apply the light to the shader
+     * @brief Write the light in the layout of the light buffer
      *
-     * @param shader The shader to apply the light to
-     * @param idx The index of the light in the shader
-     * @param shadowEnabled True if shadow mapping is enabled, false otherwise
+     * @param data The data to write to
+     * @param shadowMapIndex The index of the shadow map of the light in its depth map array
+     * @param shadowTier The resolution tier of the depth map array of a point light
      */
-    void apply(std::shared_ptr<vr::Shader> shader, size_t idx, bool shadowEnabled);
+    void pack(LightData& data, int shadowMapIndex, int shadowTier = 0) const;
+
+    /**
+     * @brief Returns a counter that is incremented every time a property or the transform of the light changes
+     *
+     * @return unsigned int The version of the light
+     */
+    unsigned int version() const { return m_version; }
+
+    /**
+     * @brief Returns a counter that is incremented every time the cascades of a directional light are refitted
+     *
+     * @return unsigned int The version of the cascades
+     */
+    unsigned int cascadeVersion() const { return m_cascadeVersion; }
 
     /**
      * @brief Set the enabled state of the light
@@ -40,6 +94,35 @@ class Light {
      */
     void setEnabled(bool enabled);
 
+    /**
+     * @brief Returns true if the light is enabled
+     */
+    bool isEnabled() const { return enabled; }
+
+    /**
+     * @brief Set how the shadow map of the light is filtered
+     *
+     * @param filter The filter, point lights always use SHADOW_FILTER_PCF
+     */
+    void setShadowFilter(ShadowFilter filter);
+
+    /**
+     * @brief Returns how the shadow map of the light is filtered
+     */
+    ShadowFilter getShadowFilter() const { return m_shadowFilter; }
+
+    /**
+     * @brief Set how much the light is preferred when shadow maps are handed out
+     *
+     * @param priority Scales the importance of the light, 1 by default and 0 to never cast shadows
+     */
+    void setShadowPriority(float priority) { m_shadowPriority = glm::max(priority, 0.0f); }
+
+    /**
+     * @brief Returns how much the light is preferred when shadow maps are handed out
+     */
+    float getShadowPriority() const { return m_shadowPriority; }
+
     /**
      * @brief Set the Transform matrix of the light
      *
@@ -112,11 +195,41 @@ class Light {
      */
     void setAttenuation(float constant, float linear, float quadratic);
 
+    /**
+     * @brief Get the distance at which the attenuated light becomes too dim to have a visible effect.
+     *        Shadows only reach up to POINT_SHADOW_FAR_PLANE, which callers rendering them clamp to.
+     *
+     * @return float The range of the light in world units, infinity if the light never becomes too dim
+     */
+    float getAttenuationRange() const;
+
+    /**
+     * @brief Get the intensity of the brightest color channel of the light, before attenuation
+     */
+    float getIntensity() const;
+
     /**
      * @brief Update the view and projection matrices for shadow mapping
      */
     void updateShadowMatrices();
 
+    /**
+     * @brief Fit the shadow cascades of a directional light to slices of the view frustum. Each cascade
+     *        is bounded by a sphere snapped to whole shadow map texels, so it only changes when the
+     *        camera moves by more than a texel. Does nothing for point lights.
+     *
+     * @param camera The camera, with up to date matrices
+     */
+    void updateCascades(const Camera& camera);
+
+    /**
+     * @brief Returns the light space matrix of a cascade of a directional light
+     *
+     * @param cascade The index of the cascade, the closest one is 0
+     * @return glm::mat4 The projection and view matrix of the cascade
+     */
+    glm::mat4 getCascadeMatrix(int cascade) const { return m_cascadeMatrices[cascade]; }
+
     /**
      * @brief Set shadow mapping parameters
      *
@@ -142,10 +255,16 @@ class Light {
     float getFarPlane() const { return m_farPlane; }
 
     glm::mat4 getProjection() const { return m_projection; }
-    void setProjection(const glm::mat4& projection) { m_projection = projection; }
+    void setProjection(const glm::mat4& projection) {
+        m_projection = projection;
+        m_version++;
+    }
 
     glm::mat4 getView() const { return m_view; }
-    void setView(const glm::mat4& view) { m_view = view; }
+    void setView(const glm::mat4& view) {
+        m_view = view;
+        m_version++;
+    }
 
    private:
     bool enabled;
@@ -159,6 +278,8 @@ class Light {
     float quadratic;
 
     // Shadow mapping
+    ShadowFilter m_shadowFilter;
+    float m_shadowPriority;
     float m_sceneRadius;
     glm::vec3 m_sceneCenter;
     float m_farPlane;
@@ -166,8 +287,12 @@ class Light {
     glm::mat4 m_view;
     // Used for point lights
     std::vector<glm::mat4> m_shadowMatrices;
+    // Used for directional lights
+    glm::mat4 m_cascadeMatrices[SHADOW_CASCADES];
+    float m_cascadeSplits[SHADOW_CASCADES];
 
-    std::string constructPrefix(const std::string& prefix, size_t idx, const std::string& suffix = "");
+    unsigned int m_version;
+    unsigned int m_cascadeVersion;
 
     friend class Scene;
 };
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include "Light.h"
+#include "ShadowAtlas.h"
+#include "vr/State/Buffer.h"
+
+// Binding point of the light buffer, declared with the same binding in the lighting shader
+#define LIGHT_BUFFER_BINDING 0
+
+namespace vr {
+
+/**
+ * The lights of the scene packed into a shader storage buffer, read by the lighting shader as an
+ * array of unbounded size. Only the lights whose properties, transform or shadow map index changed
+ * since the previous update are written to the buffer.
+ */
+class LightBuffer {
+   public:
+    LightBuffer();
+
+    /**
+     * @brief Writes the lights that changed to the buffer. Directional lights get their shadow map
+     *        indices in order, point lights the slot and tier of their shadow map in the atlas.
+     *
+     * @param lights The lights of the scene
+     * @param atlas The shadow atlas holding the shadow maps of the point lights
+     */
+    void update(const LightVector& lights, const ShadowAtlas& atlas);
+
+    /**
+     * @brief Binds the buffer to LIGHT_BUFFER_BINDING. The lighting shader finds the lights through the light clusters.
+     */
+    void apply() const;
+
+    /// \return the number of lights in the buffer
+    unsigned int count() const { return m_data.size(); }
+
+    /// \return the number of directional lights in the buffer
+    unsigned int directionalCount() const { return m_directionalCount; }
+
+    /// \return the number of point lights in the buffer
+    unsigned int pointCount() const { return m_data.size() - m_directionalCount; }
+
+    /// \return the number of lights written by the last update
+    unsigned int lightsUploaded() const { return m_uploaded; }
+
+   private:
+    /**
+     * What a light in the buffer was written from
+     */
+    struct Entry {
+        Light* light;
+        unsigned int version;
+        unsigned int cascadeVersion;
+        int shadowMapIndex;
+        int shadowTier;
+    };
+
+    std::vector<LightData> m_data;
+    std::vector<Entry> m_entries;
+    Buffer m_buffer;
+    unsigned int m_directionalCount;
+    unsigned int m_uploaded;
+};
+
+}  // namespace vr
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Camera.h"
+#include "Light.h"
+#include "vr/BoundingBox.h"
+#include "vr/State/Buffer.h"
+
+// Size of the cluster grid, tiles across the screen and slices in depth
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+
+// Binding points of the cluster buffers, declared with the same bindings in the lighting shader
+#define CLUSTER_BUFFER_BINDING 2
+#define CLUSTER_LIGHT_BUFFER_BINDING 3
+
+namespace vr {
+
+/**
+ * Statistics from the last call to LightClusters::build
+ */
+struct ClusterStats {
+    // Point lights assigned to at least one cluster
+    unsigned int lights;
+    // Total length of the light lists of all clusters
+    unsigned int assignments;
+    // Length of the longest light list of a cluster
+    unsigned int maxPerCluster;
+};
+
+/**
+ * Assigns the point lights to the clusters of a froxel grid covering the view frustum, so the lighting
+ * shader only evaluates the lights whose range reaches the cluster of a pixel. The grid is split into
+ * tiles on screen and into slices that grow exponentially with the depth. Every frame the lights are
+ * tested against the view space bounds of the clusters, and the result is uploaded as an offset and
+ * count per cluster into one list of light indices. Directional lights reach every pixel and are kept
+ * at the start of the list.
+ */
+class LightClusters {
+   public:
+    LightClusters();
+
+    /**
+     * @brief Assigns the lights to the clusters of the camera and uploads the light lists
+     *
+     * @param lights The lights of the scene, in the order of the light buffer
+     * @param camera The camera, with its matrices updated for this frame
+     */
+    void build(const LightVector& lights, const Camera& camera);
+
+    /**
+     * @brief Binds the cluster buffers and sets the uniforms of the grid
+     *
+     * @param shader The lighting shader, which must be in use
+     */
+    void apply(const std::shared_ptr<Shader>& shader) const;
+
+    /// \return the statistics of the last build
+    const ClusterStats& getStatistics() const { return m_stats; }
+
+   private:
+    /**
+     * @brief Computes the view space bounds of the clusters for a projection
+     */
+    void updateClusterBounds(const glm::mat4& projection, float nearPlane, float farPlane);
+
+    /// \return the slice containing a view space depth
+    int sliceOf(float depth) const;
+
+    // Projection the cluster bounds were computed for
+    glm::mat4 m_projection;
+    float m_near;
+    float m_far;
+    std::vector<BoundingBox> m_clusterBounds;
+
+    // Pairs of cluster and light index, sorted into the light lists
+    std::vector<std::pair<uint32_t, uint32_t>> m_pairs;
+    // Offset and count of the light list of each cluster
+    std::vector<glm::uvec2> m_clusters;
+    std::vector<uint32_t> m_lightIndices;
+    unsigned int m_directionalCount;
+
+    Buffer m_clusterBuffer;
+    Buffer m_lightIndexBuffer;
+    ClusterStats m_stats;
+};
+
+}  // namespace vr
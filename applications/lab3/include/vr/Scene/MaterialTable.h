@@ -0,0 +1,90 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "vr/State/Buffer.h"
+#include "vr/State/Material.h"
+#include "vr/State/Shader.h"
+
+// Binding point of the material table, declared with the same binding in the G-buffer shader
+#define MATERIAL_BUFFER_BINDING 1
+
+// Index of the default material, drawn for states without a material
+#define DEFAULT_MATERIAL_INDEX 0
+
+namespace vr {
+
+/**
+ * The materials of the scene written to a shader storage buffer, so a draw only has to pass the
+ * index of its material instead of uploading the material uniforms. Materials are added when the
+ * render list is compiled, and afterwards only materials whose properties change are written again.
+ * Textures can not be stored in the buffer, so the material textures are still bound per material.
+ * The first entry is always a default material, so every draw has a valid index.
+ */
+class MaterialTable {
+   public:
+    MaterialTable();
+
+    /**
+     * @brief Removes all materials except the default material, e.g. when the render list is compiled again and
+     *        materials may have been freed
+     */
+    void clear();
+
+    /**
+     * @brief Adds a material to the table if it is not in it yet
+     *
+     * @param material The material, nullptr is ignored
+     * @return int The index of the material, -1 for nullptr
+     */
+    int add(Material* material);
+
+    /**
+     * @brief Get the index of a material
+     *
+     * @param material The material
+     * @return int The index of the material, -1 if it is not in the table
+     */
+    int indexOf(const Material* material) const;
+
+    /**
+     * @brief Writes the materials added or changed since the last update to the buffer
+     */
+    void update();
+
+    /**
+     * @brief Binds the table to MATERIAL_BUFFER_BINDING and assigns the texture units of the material samplers.
+     *        Called once per program, the shader must be in use.
+     *
+     * @param shader A shader that reads the material table
+     */
+    void apply(const std::shared_ptr<Shader>& shader) const;
+
+    /// \return the number of materials in the table
+    unsigned int count() const { return m_data.size(); }
+
+    /// \return the number of materials written by the last update
+    unsigned int materialsUploaded() const { return m_uploaded; }
+
+   private:
+    /**
+     * What a material in the table was written from
+     */
+    struct Entry {
+        Material* material;
+        unsigned int version;
+    };
+
+    Material m_default;
+    std::unordered_map<const Material*, int> m_indices;
+    std::vector<Entry> m_entries;
+    std::vector<MaterialData> m_data;
+    Buffer m_buffer;
+    // Number of materials the buffer holds, materials beyond it were added since the last update
+    size_t m_bufferCount;
+    unsigned int m_uploaded;
+};
+
+}  // namespace vr
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+// Size of the FIFO post-transform cache that triangles are ordered for and that ACMR and ATVR are measured with
+#define VERTEX_CACHE_SIZE 16
+// Clusters are split for overdraw as long as their ACMR stays within this factor of the unsplit order
+#define OVERDRAW_THRESHOLD 1.05f
+
+namespace vr {
+
+/**
+ * Vertex cache misses of the meshes optimized since the last reset. ACMR is the average number of
+ * misses per triangle, ATVR the average number of times each vertex is transformed, 1 at best.
+ */
+struct MeshOptimizerStats {
+    unsigned int triangles;
+    // Vertices referenced by the indices
+    unsigned int vertices;
+    unsigned int missesBefore;
+    unsigned int missesAfter;
+
+    float acmrBefore() const { return triangles ? float(missesBefore) / triangles : 0.0f; }
+    float acmrAfter() const { return triangles ? float(missesAfter) / triangles : 0.0f; }
+    float atvrBefore() const { return vertices ? float(missesBefore) / vertices : 0.0f; }
+    float atvrAfter() const { return vertices ? float(missesAfter) / vertices : 0.0f; }
+};
+
+/**
+ * Reorders the triangles and vertices of meshes when they are imported, so they are drawn faster:
+ *  1. Triangles are ordered for the post-transform vertex cache with Tipsify (Sander et al. 2007),
+ *     which fans around recently used vertices and jumps elsewhere only at dead ends.
+ *  2. The cache ordered triangles are split into clusters that can be reordered without losing much
+ *     of the cache locality, and the clusters facing outwards from the mesh are drawn first, so
+ *     that they occlude the rest of the mesh from most viewpoints.
+ *  3. Vertices are renumbered in the order the triangles first use them, so the vertex fetch reads
+ *     the vertex buffer mostly sequentially.
+ */
+class MeshOptimizer {
+   public:
+    MeshOptimizer();
+
+    /**
+     * @brief Reorders a triangle mesh in place. Vertex arrays that are empty are left empty.
+     *
+     * @param vertices The positions
+     * @param normals The normals
+     * @param texCoords The texture coordinates
+     * @param tangents The tangents
+     * @param bitangents The bitangents
+     * @param indices Three indices per triangle
+     */
+    void optimize(std::vector<glm::vec4>& vertices, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& texCoords,
+                  std::vector<glm::vec3>& tangents, std::vector<glm::vec3>& bitangents, std::vector<GLuint>& indices);
+
+    /**
+     * @brief Counts the misses of a FIFO vertex cache when drawing the triangles in order
+     *
+     * @param indices Three indices per triangle
+     * @param vertexCount The number of vertices the indices refer to
+     * @return unsigned int The number of vertices transformed
+     */
+    static unsigned int cacheMisses(const std::vector<GLuint>& indices, size_t vertexCount);
+
+    /**
+     * @brief Get the cache misses of the meshes optimized since the last reset
+     */
+    const MeshOptimizerStats& getStatistics() const { return m_stats; }
+
+    /**
+     * @brief Resets the statistics, e.g. before the meshes of the next model are optimized
+     */
+    void resetStatistics();
+
+   private:
+    /**
+     * @brief Orders the triangles for the vertex cache with Tipsify
+     *
+     * @param vertexCount The number of vertices
+     * @param clusters Receives the first triangle of every run that started at a dead end
+     */
+    void optimizeVertexCache(size_t vertexCount, std::vector<size_t>& clusters);
+
+    /**
+     * @brief Splits the clusters further and sorts them so that outward facing clusters come first
+     *
+     * @param vertices The positions
+     * @param clusters The first triangle of every cluster, in increasing order
+     */
+    void optimizeOverdraw(const std::vector<glm::vec4>& vertices, std::vector<size_t>& clusters);
+
+    /**
+     * @brief Moves the entries of a vertex array to the new vertex numbers, dropping unused vertices
+     *
+     * @param data The vertex array, left as it is if it does not have an entry per vertex
+     * @param count The number of vertices in use
+     */
+    template <class T>
+    void remap(std::vector<T>& data, size_t count) const;
+
+    // Triangles of the mesh being optimized, and the reordered triangles
+    std::vector<GLuint> m_indices;
+    std::vector<GLuint> m_result;
+
+    // Triangles using each vertex, the triangles of vertex v are m_adjacency[m_offsets[v]] to m_adjacency[m_offsets[v + 1]]
+    std::vector<size_t> m_offsets;
+    std::vector<size_t> m_adjacency;
+
+    // New index of every old vertex, -1 for vertices no triangle uses
+    std::vector<GLint> m_remap;
+
+    MeshOptimizerStats m_stats;
+};
+
+}  // namespace vr
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "vr/Nodes/Meshlet.h"
+
+namespace vr {
+
+/**
+ * Meshlets tested since the last reset, summed over every view culled with the same culler
+ */
+struct MeshletStats {
+    unsigned int meshlets;
+    unsigned int meshletsCulled;
+    unsigned int triangles;
+    unsigned int trianglesCulled;
+    // Ranges of consecutive visible meshlets, drawn with one glMultiDrawElements per geometry
+    unsigned int ranges;
+
+    float culledFraction() const { return triangles ? float(trianglesCulled) / triangles : 0.0f; }
+};
+
+/**
+ * Culls the meshlets of geometries against the frustum of a view, and optionally the meshlets whose
+ * triangles all face away from the viewer. The tests run in the local space of each geometry, so
+ * they also hold under non-uniform scaling. The visible meshlets are merged into index ranges for
+ * a multi-draw.
+ */
+class MeshletCuller {
+   public:
+    MeshletCuller();
+
+    /**
+     * @brief Sets the view the next geometries are culled for
+     *
+     * @param viewProjection The view-projection matrix of the view
+     * @param eye The position of the viewer in world space
+     * @param cullBackfaces True to cull meshlets facing away from the eye, only valid for perspective views
+     */
+    void begin(const glm::mat4& viewProjection, const glm::vec3& eye, bool cullBackfaces);
+
+    /**
+     * @brief Culls the meshlets of a geometry and collects the index ranges to draw
+     *
+     * @param meshlets The meshlets of the geometry
+     * @param world The world matrix of the geometry
+     * @param indexSize The size in bytes of one index
+     * @param backFacesCulled True if the geometry is drawn with back face culling, meshlets facing away
+     *                        from the eye are only culled if so
+     * @return true if any meshlet is visible
+     */
+    bool cull(const std::vector<Meshlet>& meshlets, const glm::mat4& world, size_t indexSize, bool backFacesCulled);
+
+    /// \return the number of indices of each range, as passed to glMultiDrawElements
+    const std::vector<GLsizei>& counts() const { return m_counts; }
+
+    /// \return the byte offset of each range in the index buffer, as passed to glMultiDrawElements
+    const std::vector<const void*>& offsets() const { return m_offsets; }
+
+    const MeshletStats& getStatistics() const { return m_stats; }
+
+    void resetStatistics();
+
+   private:
+    glm::mat4 m_viewProjection;
+    glm::vec3 m_eye;
+    bool m_cullBackfaces;
+
+    std::vector<GLsizei> m_counts;
+    std::vector<const void*> m_offsets;
+
+    MeshletStats m_stats;
+};
+
+}  // namespace vr
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+#include "Camera.h"
+#include "Light.h"
+#include "vr/BoundingBox.h"
+#include "vr/Frustum.h"
+#include "vr/State/State.h"
+
+namespace vr {
+class Geometry;
+class Transform;
+class Group;
+class LodNode;
+class BVH;
+
+/**
+ * A single draw in the compiled render list
+ */
+struct RenderItem {
+    Geometry* geometry;
+    // State resolved from the root down to the geometry
+    std::shared_ptr<State> state;
+    // Closest Transform above the geometry, nullptr if there is none
+    Transform* transform;
+    // Index of the closest LOD level above the geometry, -1 if there is none
+    int lodLevel;
+    // World version of the transform the cached matrices were computed from
+    unsigned int worldVersion;
+    glm::mat4 world;
+    glm::mat3 normalMatrix;
+    // World space bounds, the local bounds of the geometry transformed by the world matrix
+    BoundingBox bounds;
+    // Set by culling, true if the item should be drawn this frame
+    bool visible;
+};
+
+/**
+ * Statistics from the last call to RenderList::cull
+ */
+struct CullStats {
+    // BVH nodes and items whose bounds were tested
+    unsigned int visited;
+    // BVH nodes and items rejected by the test
+    unsigned int culled;
+    // Geometries left to draw
+    unsigned int drawn;
+};
+
+/**
+ * One level of a LodNode in the compiled render list
+ */
+struct RenderLodLevel {
+    LodNode* node;
+    Group* level;
+    int parent;
+    // Index of the highest level of detail of the same reference to the LodNode
+    int first;
+    // World space bounds of the items of this reference to the level. The level group itself can be
+    // shared by several LodNodes under different transforms, so its cached bounds are not used.
+    BoundingBox bounds;
+    bool active;
+    // True if the level was switched on or off by the last update
+    bool switched;
+};
+
+/**
+ * A flat, compiled representation of the scene graph. The list is built by the CompileVisitor
+ * and only needs to be rebuilt when the structure of the graph changes. Every frame the world
+ * matrices of items whose transform changed and the active levels of detail are refreshed,
+ * after which the draws can be issued by walking the items in order.
+ */
+class RenderList {
+   public:
+    RenderList();
+
+    /**
+     * @brief Removes all items, lod levels, lights and cameras
+     */
+    void clear();
+
+    /**
+     * @brief Checks if the list has to be compiled again
+     *
+     * @return true if the graph changed since the list was compiled or if it was invalidated
+     */
+    bool isDirty() const;
+
+    /**
+     * @brief Forces the list to be compiled again before the next frame
+     */
+    void invalidate();
+
+    /**
+     * @brief Marks the list as up to date with the current scene graph
+     */
+    void setCompiled();
+
+    /**
+     * @brief Adds a level of a LodNode to the list
+     *
+     * @param lodNode The LodNode owning the level
+     * @param level The group of the level
+     * @param parent Index of the enclosing lod level, -1 if there is none
+     * @param first Index of the highest level of detail of the LodNode, -1 if this is the highest level
+     * @return int Index of the added lod level
+     */
+    int addLodLevel(LodNode* lodNode, Group* level, int parent, int first);
+
+    /**
+     * @brief Adds a draw to the list
+     *
+     * @param geometry The geometry to draw
+     * @param state The resolved state to draw the geometry with
+     * @param transform The closest transform, nullptr if there is none
+     * @param lodLevel Index of the closest lod level, -1 if there is none
+     */
+    void addItem(Geometry* geometry, std::shared_ptr<State> state, Transform* transform, int lodLevel);
+
+    /**
+     * @brief Adds a light that follows the world matrix of a transform node
+     *
+     * @param light The light
+     * @param transform The closest transform, nullptr if there is none
+     */
+    void addLight(std::shared_ptr<Light> light, Transform* transform);
+
+    /**
+     * @brief Adds a camera that follows the world matrix of a transform node
+     *
+     * @param camera The camera
+     * @param transform The closest transform, nullptr if there is none
+     */
+    void addCamera(std::shared_ptr<Camera> camera, Transform* transform);
+
+    /**
+     * @brief Refreshes the world matrices of items whose transform changed, light and camera
+     *        transforms and the active levels of detail. Transforms must be up to date.
+     *
+     * @param cameraPosition The position used for selecting levels of detail
+     */
+    void update(const glm::vec3& cameraPosition);
+
+    /**
+     * @brief Get the items whose world matrices and bounds changed in the last update
+     *
+     * @return std::vector<int> Indices of the changed items
+     */
+    const std::vector<int>& getChangedItems() const;
+
+    /**
+     * @brief Get the regions of the scene that changed in the last update, i.e. the bounds of moved items
+     *        before and after the move and the bounds of items whose level of detail was switched
+     *
+     * @return std::vector<BoundingBox> The world space bounds
+     */
+    const std::vector<BoundingBox>& getChangedBounds() const;
+
+    /**
+     * @brief Marks the items that are inside the frustum and part of an active level of detail as visible
+     *
+     * @param frustum The view frustum in world space
+     * @param bvh A BVH built over the items of this list
+     */
+    void cull(const Frustum& frustum, BVH& bvh);
+
+    /**
+     * @brief Get the statistics from the last call to cull
+     *
+     * @return CullStats The number of visited, culled and drawn nodes
+     */
+    const CullStats& getCullStats() const;
+
+    /**
+     * @brief Checks if an item should be drawn with the current levels of detail
+     *
+     * @param item The item to check
+     * @return true if the item is part of an active level of detail, or not part of a LodNode at all
+     */
+    bool isActive(const RenderItem& item) const;
+
+    /**
+     * @brief Get the items of the list
+     *
+     * @return std::vector<RenderItem> The items in scene graph order
+     */
+    const std::vector<RenderItem>& getItems() const;
+
+   private:
+    /**
+     * @brief Recomputes the bounds of every lod level from the bounds of its items
+     */
+    void updateLodBounds();
+
+    /**
+     * @brief Adds the bounds of an item to its lod level and the enclosing levels
+     */
+    void expandLodBounds(const RenderItem& item);
+
+    std::vector<RenderItem> m_items;
+    std::vector<RenderLodLevel> m_lodLevels;
+    std::vector<int> m_changedItems;
+    std::vector<BoundingBox> m_changedBounds;
+    std::vector<int> m_visibleItems;
+    CullStats m_cullStats;
+    std::vector<std::pair<std::shared_ptr<Light>, Transform*>> m_lights;
+    std::vector<std::pair<std::shared_ptr<Camera>, Transform*>> m_cameras;
+
+    unsigned int m_graphVersion;
+    bool m_invalidated;
+};
+
+}  // namespace vr
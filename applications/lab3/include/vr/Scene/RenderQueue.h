@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Camera.h"
+#include "InstanceBatcher.h"
+#include "MaterialTable.h"
+
+// Layout of the 64 bit sort key, from the most to the least significant bits
+#define SORT_KEY_PASS_BITS 2
+#define SORT_KEY_SHADER_BITS 10
+#define SORT_KEY_MATERIAL_BITS 14
+#define SORT_KEY_TEXTURES_BITS 14
+#define SORT_KEY_DEPTH_BITS 24
+
+namespace vr {
+
+/**
+ * A batch in the render queue together with its sort key
+ */
+struct RenderCommand {
+    uint64_t key;
+    const InstanceBatch* batch;
+};
+
+/**
+ * State changes of the last frame. Every count has a matching count of changes saved
+ * compared to applying the full state for every batch.
+ */
+struct RenderQueueStats {
+    unsigned int commands;
+    unsigned int programChanges;
+    unsigned int materialChanges;
+    unsigned int textureChanges;
+    unsigned int cullFaceChanges;
+    unsigned int uniformUploads;
+    // Estimated from the number of uniforms the skipped parts uploaded the last time they were applied
+    unsigned int uniformUploadsSaved;
+};
+
+/**
+ * Draws the batches of a pass ordered by a packed sort key of pass, shader, material, textures and
+ * front to back depth. Since batches sharing state end up next to each other, only the parts of the
+ * state that differ from the previous batch are applied.
+ */
+class RenderQueue {
+   public:
+    enum Pass {
+        PASS_GBUFFER = 0
+    };
+
+    RenderQueue();
+
+    /**
+     * @brief Removes the commands of the previous frame
+     */
+    void begin();
+
+    /**
+     * @brief Adds a batch to the queue
+     *
+     * @param batch The batch, which must stay valid until the queue is drawn
+     * @param depth Distance from the camera to the closest instance of the batch
+     * @param farPlane Distance used to normalize the depth
+     * @param pass The pass the batch belongs to
+     */
+    void add(const InstanceBatch& batch, float depth, float farPlane, Pass pass = PASS_GBUFFER);
+
+    /**
+     * @brief Sorts the commands by their key and draws them, applying only the state that changed.
+     *        Indirect draws are collected until the shader, the cull face or a bound texture changes.
+     *
+     * @param batcher The batcher owning the batches
+     * @param camera The camera, applied every time the shader changes to shaders not using the CameraBlock
+     * @param materials The material table, holding the materials of all batches
+     */
+    void draw(InstanceBatcher& batcher, Camera& camera, const MaterialTable& materials);
+
+    /**
+     * @brief Forgets the ids assigned to shaders, materials and textures, e.g. when the states are rebuilt
+     */
+    void clearIds();
+
+    /**
+     * @brief Get the state change counts of the last draw
+     */
+    const RenderQueueStats& getStatistics() const { return m_stats; }
+
+   private:
+    /**
+     * @brief Get a small id for a pointer, that fits in a field of the sort key
+     *
+     * @param ids The ids assigned so far
+     * @param pointer The pointer to get an id for, nullptr always has id 0
+     * @param bits The width of the field
+     * @return uint64_t The id
+     */
+    uint64_t idOf(std::unordered_map<const void*, uint64_t>& ids, const void* pointer, int bits);
+
+    std::vector<RenderCommand> m_commands;
+    std::unordered_map<const void*, uint64_t> m_shaderIds;
+    std::unordered_map<const void*, uint64_t> m_materialIds;
+    std::unordered_map<const void*, uint64_t> m_textureIds;
+
+    // Number of uniforms uploaded the last time each part of a state was applied
+    unsigned int m_cameraUniforms;
+    unsigned int m_materialUniforms;
+    unsigned int m_textureUniforms;
+
+    RenderQueueStats m_stats;
+};
+
+}  // namespace vr
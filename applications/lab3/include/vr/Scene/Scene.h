@@ -5,13 +5,25 @@
 #include <sstream>
 #include <vector>
 
+#include "BVH.h"
 #include "Camera.h"
+#include "DepthRenderer.h"
+#include "InstanceBatcher.h"
 #include "Light.h"
+#include "LightBuffer.h"
+#include "LightClusters.h"
+#include "MaterialTable.h"
+#include "MeshletCuller.h"
+#include "RenderList.h"
+#include "RenderQueue.h"
+#include "ShadowAtlas.h"
+#include "ShadowCache.h"
+#include "ShadowPrefilter.h"
 #include "vr/Frambuffer/Gbuffer.h"
 #include "vr/Nodes/Node.h"
+#include "vr/State/Buffer.h"
 #include "vr/State/Shader.h"
-#include "vr/Visitors/DepthVisitor.h"
-#include "vr/Visitors/RenderVisitor.h"
+#include "vr/Visitors/CompileVisitor.h"
 #include "vr/Visitors/UpdateVisitor.h"
 
 namespace vr {
@@ -98,7 +110,7 @@ class Scene {
     void render();
 
     /**
-     * Renders the depth maps for all lights in the scene
+     * Renders the depth maps of the lights in the scene whose cached maps are outdated
      *
      * \param sceneChanged True if the scene has changed since the last render
      */
@@ -168,21 +180,60 @@ class Scene {
     void initDepthMaps();
 
     /**
-     * Get the point shadow map
+     * Get the shadow atlas holding the shadow maps of the point lights
      */
-    std::shared_ptr<Texture> getPointShadowMap();
+    std::shared_ptr<ShadowAtlas> getShadowAtlas();
+
+    /**
+     * Get the prefilter holding the exponential shadow maps of directional lights
+     */
+    std::shared_ptr<ShadowPrefilter> getShadowPrefilter();
+
+    /**
+     * Set the memory the point shadow maps may use, applied by initDepthMaps
+     *
+     * \param bytes The budget in bytes
+     */
+    void setShadowMemoryBudget(size_t bytes);
+
+    /**
+     * Set the number of point lights that cast shadows, the most important ones for the current view
+     *
+     * \param count The number of lights
+     */
+    void setMaxShadowedLights(unsigned int count);
+
+    /**
+     * Get the number of point lights that cast shadows
+     */
+    unsigned int getMaxShadowedLights() const;
 
     /**
      * Get the directional shadow map
      */
     std::shared_ptr<Texture> getDirectionalShadowMap();
 
+    /**
+     * Get the buffer the lights are packed into for the lighting shader, updated every frame by render
+     */
+    std::shared_ptr<LightBuffer> getLightBuffer();
+
+    /**
+     * Get the light lists of the clusters of the active camera, built every frame by render
+     */
+    std::shared_ptr<LightClusters> getLightClusters();
+
     /**
      * Checks if shadows are enabled
      *
      */
     bool shadowsEnabled();
 
+    /**
+     * Get rendering statistics from the last frame, one line of text per entry
+     */
+    std::vector<std::string> getStatistics();
+
    private:
     /**
      * Private constructor for the scene class.
@@ -191,9 +242,25 @@ class Scene {
 
     bool m_shadowsEnabled = true;
 
-    std::shared_ptr<RenderVisitor> m_renderVisitor;
+    std::shared_ptr<CompileVisitor> m_compileVisitor;
     std::shared_ptr<UpdateVisitor> m_updateVisitor;
-    std::shared_ptr<DepthVisitor> m_depthVisitor;
+    std::shared_ptr<DepthRenderer> m_depthRenderer;
+    // Decides which shadow maps and cube faces have to be rendered again
+    std::shared_ptr<ShadowCache> m_shadowCache;
+    // The scene graph compiled into a flat list of draws, rebuilt when the graph changes
+    std::shared_ptr<RenderList> m_renderList;
+    // Spatial index over the render list, used for camera and shadow caster culling
+    std::shared_ptr<BVH> m_bvh;
+    std::shared_ptr<InstanceBatcher> m_instanceBatcher;
+    // Culls the meshlets of geometries drawn one by one against the camera
+    std::shared_ptr<MeshletCuller> m_meshletCuller;
+    std::shared_ptr<RenderQueue> m_renderQueue;
+    std::shared_ptr<LightBuffer> m_lightBuffer;
+    std::shared_ptr<LightClusters> m_lightClusters;
+    // Uniform buffer of the CameraBlock, holding the active camera
+    std::shared_ptr<Buffer> m_cameraBuffer;
+    // Properties of all materials in the render list, indexed per draw
+    std::shared_ptr<MaterialTable> m_materialTable;
     // LightNode need to be also stored in the scene as they are needed for rendering depth maps
     LightVector m_lights;
     CameraVector m_cameras;
@@ -202,7 +269,10 @@ class Scene {
 
     // Deferred rendering
     std::shared_ptr<Gbuffer> m_gbuffer;
-    std::shared_ptr<Texture> m_pointShadowMap;
+    // Point shadow maps in tiers of resolution, assigned by importance within a memory budget
+    std::shared_ptr<ShadowAtlas> m_shadowAtlas;
+    // Exponential shadow maps of the directional lights using SHADOW_FILTER_ESM
+    std::shared_ptr<ShadowPrefilter> m_shadowPrefilter;
     std::shared_ptr<Texture> m_directionalShadowMap;
 
     static std::shared_ptr<Scene> instance;
@@ -211,6 +281,8 @@ class Scene {
     std::shared_ptr<Group> m_root;
     std::shared_ptr<Group> m_groundPlane;
     float m_groundRadius = 0.0f;
+    // Graph version the cached bounds were last calculated for
+    unsigned int m_boundsGraphVersion = 0;
 };
 
 }  // namespace vr
\ No newline at end of file
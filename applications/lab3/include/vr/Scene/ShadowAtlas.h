@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "Camera.h"
+#include "Light.h"
+#include "vr/State/Shader.h"
+#include "vr/State/Texture.h"
+
+// Memory the point shadow maps may use when the scene does not set a budget
+#define SHADOW_MEMORY_BUDGET (192 * 1024 * 1024)
+// Point lights granted a shadow map when the scene does not set a limit
+#define SHADOW_MAX_LIGHTS 16
+// A light keeps its tier unless another light is this much more important per tier of difference
+#define SHADOW_TIER_HYSTERESIS 0.1f
+
+namespace vr {
+
+/**
+ * The shadow map of a point light, a slot in the cube map array of a resolution tier
+ */
+struct ShadowAllocation {
+    // -1 if the light has no shadow map
+    int tier;
+    int slot;
+};
+
+/**
+ * The allocation after the last call to ShadowAtlas::update
+ */
+struct ShadowAtlasStats {
+    unsigned int lights[SHADOW_TIER_COUNT];
+    unsigned int capacity[SHADOW_TIER_COUNT];
+    // Enabled lights left without a shadow map, by the limit, their priority or the budget
+    unsigned int unshadowed;
+    unsigned int maxLights;
+    // Lights that moved to another tier or slot, their shadow maps are rendered again
+    unsigned int reallocated;
+    size_t bytesAllocated;
+    size_t budget;
+};
+
+/**
+ * Hands out the shadow maps of the point lights. The maps are taken from one cube map array per
+ * resolution tier, where every tier has half the resolution of the one above. The arrays are
+ * sized once to fit the memory budget, with a slot in the lowest tier for every light if possible.
+ * Every frame the lights are ranked by their projected size on the screen, their distance to the
+ * camera, their intensity and the shadow priority set by the scene. Only the highest ranked lights,
+ * up to a limit that can be changed at any time, get a shadow map, the most important ones in the
+ * highest tiers. Lights keep their slot while they stay in the same tier, so their cached shadow
+ * maps remain valid.
+ */
+class ShadowAtlas {
+   public:
+    ShadowAtlas();
+
+    /**
+     * @brief Set the memory the shadow maps may use, applied the next time the atlas is initialized
+     *
+     * @param bytes The budget in bytes
+     */
+    void setBudget(size_t bytes) { m_budget = bytes; }
+
+    /// \return the memory the shadow maps may use in bytes
+    size_t getBudget() const { return m_budget; }
+
+    /**
+     * @brief Set the number of point lights that get a shadow map, applied in the next update. An atlas
+     *        that is already initialized is allocated again for the new number of lights.
+     *
+     * @param count The number of lights, the others are lit without shadows
+     */
+    void setMaxLights(unsigned int count);
+
+    /// \return the number of point lights that get a shadow map
+    unsigned int getMaxLights() const { return m_maxLights; }
+
+    /**
+     * @brief Allocates the cube map arrays of every tier within the budget, for as many point lights as
+     *        can get a shadow map at once
+     *
+     * @param pointLights The number of point lights in the scene
+     */
+    void init(int pointLights);
+
+    /**
+     * @brief Assigns the point lights to tiers by their importance for the current view
+     *
+     * @param lights The lights of the scene, directional lights are skipped
+     * @param camera The camera the importance is computed for
+     */
+    void update(const LightVector& lights, const Camera& camera);
+
+    /**
+     * @brief Get the shadow map of a light
+     *
+     * @param index Index of the light in the vector passed to update
+     * @return ShadowAllocation The tier and slot, tier -1 if the light has no shadow map
+     */
+    ShadowAllocation getAllocation(size_t index) const;
+
+    /**
+     * @brief Checks if a light moved to another tier or slot in the last update
+     *
+     * @param index Index of the light in the vector passed to update
+     * @return true if the shadow map of the light has to be rendered again
+     */
+    bool reallocated(size_t index) const { return index < m_reallocated.size() && m_reallocated[index]; }
+
+    /// \return the cube map array of a tier
+    std::shared_ptr<Texture> getTexture(int tier) const { return m_textures[tier]; }
+
+    /// \return the resolution of the faces in a tier
+    unsigned int resolution(int tier) const { return POINT_SHADOW_RESOLUTION >> tier; }
+
+    /**
+     * @brief Binds the arrays of all tiers to their slots and sets the samplers of the lighting shader
+     *
+     * @param shader The lighting shader
+     */
+    void apply(std::shared_ptr<Shader> shader) const;
+
+    /**
+     * @brief Get the allocation of the last update
+     */
+    const ShadowAtlasStats& getStatistics() const { return m_stats; }
+
+   private:
+    /// \return the memory of one slot, six faces of 32 bit depth
+    size_t slotBytes(int tier) const;
+
+    size_t m_budget;
+    unsigned int m_maxLights;
+    // Point lights passed to the last init, -1 before the atlas is initialized
+    int m_pointLights;
+    std::shared_ptr<Texture> m_textures[SHADOW_TIER_COUNT];
+    // Slots of each tier, the index of the light using a slot or -1 if it is free
+    std::vector<int> m_slots[SHADOW_TIER_COUNT];
+
+    std::vector<ShadowAllocation> m_allocations;
+    std::vector<bool> m_reallocated;
+    // Tier each light should have this frame, -1 for none
+    std::vector<int> m_desiredTiers;
+    // Importance and index of every point light, sorted most important first
+    std::vector<std::pair<float, int>> m_ranking;
+
+    ShadowAtlasStats m_stats;
+};
+
+}  // namespace vr
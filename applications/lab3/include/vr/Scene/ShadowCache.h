@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+
+#include "Camera.h"
+#include "Light.h"
+#include "RenderList.h"
+
+// Face mask covering all faces of a point light shadow map
+#define ALL_CUBE_FACES 0x3F
+// Mask covering all cascades of a directional light shadow map
+#define ALL_CASCADES ((1 << SHADOW_CASCADES) - 1)
+// Number of outdated cube faces a distant point light refreshes per frame
+#define SHADOW_FACES_PER_FRAME 2
+// Point lights further from the camera than this many times their range are refreshed over several frames
+#define SHADOW_DISTANT_RANGES 2.0f
+
+namespace vr {
+
+/**
+ * Statistics from the last call to ShadowCache::update
+ */
+struct ShadowCacheStats {
+    // Lights with at least one face rendered this frame
+    unsigned int lightsRendered;
+    // Lights whose shadow map was reused as it is
+    unsigned int lightsCached;
+    // Outdated faces of distant point lights left for a later frame
+    unsigned int facesDeferred;
+};
+
+/**
+ * Keeps track of which shadow maps are still valid, so that only the maps of lights that changed,
+ * or that have a moving caster in their volume, are rendered again. Shadow maps are rendered per
+ * cube face for point lights and per cascade for directional lights, whose cascades also follow
+ * the camera; point lights that are far away or outside the view refresh their
+ * outdated faces round-robin, a few per frame. A light that changes itself always has all its
+ * faces rendered right away, since the old faces would not match the new ones.
+ */
+class ShadowCache {
+   public:
+    ShadowCache();
+
+    /**
+     * @brief Marks every shadow map as outdated, e.g. after the render list was compiled or while shadows were off
+     */
+    void invalidate();
+
+    /**
+     * @brief Marks the shadow map of a single light as outdated, e.g. after it moved to another slot
+     *
+     * @param index Index of the light in the vector passed to update
+     */
+    void invalidate(size_t index);
+
+    /**
+     * @brief Decides which shadow maps and cube faces are rendered this frame
+     *
+     * @param lights The lights of the scene, with up to date shadow matrices
+     * @param renderList The render list, updated for this frame
+     * @param camera The camera, used to find distant point lights
+     */
+    void update(const LightVector& lights, const RenderList& renderList, const Camera& camera);
+
+    /**
+     * @brief Get the faces to render for a light this frame
+     *
+     * @param index Index of the light in the vector passed to update
+     * @return int One bit per cube face for point lights, one bit per cascade for directional lights. 0 if the cached map is used.
+     */
+    int facesToRender(size_t index) const { return m_entries[index].render; }
+
+    /**
+     * @brief Get the statistics of the last update
+     */
+    const ShadowCacheStats& getStatistics() const { return m_stats; }
+
+   private:
+    struct Entry {
+        const Light* light;
+        unsigned int version;
+        // Cascades the directional shadow map was rendered with
+        unsigned int cascadeVersion;
+        glm::mat4 cascades[SHADOW_CASCADES];
+        // Outdated faces, and the faces rendered this frame
+        int pending;
+        int render;
+        // Face the round-robin refresh continues from
+        int nextFace;
+    };
+
+    /**
+     * @brief Get the faces of a light's shadow map that a changed region of the scene overlaps
+     *
+     * @param light The light
+     * @param box The world space region
+     * @return int The face mask
+     */
+    int overlappedFaces(const Light& light, const BoundingBox& box) const;
+
+    std::vector<Entry> m_entries;
+    bool m_invalidated;
+    ShadowCacheStats m_stats;
+};
+
+}  // namespace vr
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+
+#include "vr/State/Shader.h"
+#include "vr/State/Texture.h"
+
+// Sharpness of exponential shadow maps, exp(ESM_EXPONENT) must fit in a 32 bit float
+#define ESM_EXPONENT 80.0f
+
+namespace vr {
+
+/**
+ * Turns layers of the directional shadow map array into exponential shadow maps. Every layer is
+ * converted and blurred once after its depth is rendered, in two separable passes, so the lighting
+ * pass can filter the shadow with a single bilinear fetch instead of a kernel of depth comparisons.
+ */
+class ShadowPrefilter {
+   public:
+    ShadowPrefilter();
+    ~ShadowPrefilter();
+
+    /**
+     * @brief Allocates the exponential shadow maps, one per layer of the directional shadow map array
+     *
+     * @param layers The number of layers, 0 if no light uses exponential shadow maps
+     */
+    void init(int layers);
+
+    /**
+     * @brief Filters a layer of the directional shadow map array into the same layer of the exponential shadow maps.
+     *        Leaves the filter framebuffer bound.
+     *
+     * @param depthMaps The directional shadow map array
+     * @param layer The layer to filter
+     */
+    void filter(const Texture& depthMaps, int layer);
+
+    /**
+     * @brief Binds the exponential shadow maps and sets the sampler and exponent of the lighting shader
+     *
+     * @param shader The lighting shader
+     */
+    void apply(std::shared_ptr<Shader> shader) const;
+
+    /// \return the number of layers filtered since the last reset
+    unsigned int layersFiltered() const { return m_layersFiltered; }
+
+    /**
+     * @brief Resets the number of filtered layers, called once per frame
+     */
+    void resetStatistics() { m_layersFiltered = 0; }
+
+   private:
+    std::shared_ptr<Shader> m_shader;
+    Uniform m_sourceUniform;
+    Uniform m_layerUniform;
+    Uniform m_verticalUniform;
+    Uniform m_exponentUniform;
+
+    // The exponential shadow maps, and the horizontally blurred layer between the two passes
+    std::shared_ptr<Texture> m_texture;
+    std::shared_ptr<Texture> m_intermediate;
+
+    GLuint m_fbo;
+    GLuint m_vao;
+    // Reads the depth maps without the depth comparison the lighting shader uses
+    GLuint m_sampler;
+
+    unsigned int m_layersFiltered;
+};
+
+}  // namespace vr
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "vr/Nodes/Geometry.h"
+#include "vr/Nodes/Group.h"
+
+// Vertices of one merged geometry, small enough for 16 bit indices
+#define STATIC_BATCH_MAX_VERTICES 65536
+
+namespace vr {
+
+/**
+ * Counts of the last call to StaticBatcher::batch
+ */
+struct StaticBatchStats {
+    unsigned int geometries;
+    unsigned int batches;
+};
+
+/**
+ * Merges the geometries below a group that never moves into a few large geometries, one or more per
+ * resolved state. The vertices are transformed by the transforms between the group and each geometry,
+ * so the merged geometries sit directly below the group. Nodes that can change at runtime, i.e. nodes
+ * with update callbacks and levels of detail, are kept as they are together with their subtrees.
+ *
+ * The graph below the group is rebuilt rather than modified, since the groups of loaded models are
+ * shared with other references to the same file.
+ */
+class StaticBatcher {
+   public:
+    StaticBatcher();
+
+    /**
+     * @brief Merges the static geometries below a group and replaces the children of the group
+     *
+     * @param group The group whose subtree never moves
+     * @param shader The shader the merged geometries are checked against
+     */
+    void batch(const std::shared_ptr<Group>& group, const std::shared_ptr<Shader>& shader);
+
+    /**
+     * @brief Get the counts of the last call to batch
+     */
+    const StaticBatchStats& getStatistics() const { return m_stats; }
+
+   private:
+    // States that resolve to the same shader, material, textures and flags can share a batch
+    typedef std::tuple<const Shader*, const Material*, std::vector<const Texture*>, std::vector<const Light*>, bool, bool, bool> StateKey;
+
+    /**
+     * A merged geometry being built
+     */
+    struct Batch {
+        std::shared_ptr<State> state;
+        std::vector<glm::vec4> vertices;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> texCoords;
+        std::vector<glm::vec3> tangents;
+        std::vector<glm::vec3> bitangents;
+        std::vector<GLuint> indices;
+        std::vector<SubMesh> subMeshes;
+        bool meshlets;
+    };
+
+    /**
+     * @brief Collects the static geometries of a group into batches
+     *
+     * @param group The group to traverse
+     * @param transform The transform from the group to the batched group
+     * @param state The state resolved from the batched group down to the group, nullptr if there is none
+     * @return NodeVector The children of the group that were not merged, with their subtrees rebuilt
+     */
+    NodeVector collect(Group* group, const glm::mat4& transform, const std::shared_ptr<State>& state);
+
+    /**
+     * @brief Appends a geometry to the batch of its state
+     *
+     * @param geometry The geometry
+     * @param transform The transform from the geometry to the batched group, including its initial transform
+     * @param state The resolved state of the geometry
+     */
+    void add(Geometry* geometry, const glm::mat4& transform, const std::shared_ptr<State>& state);
+
+    /**
+     * @brief Get the key of a resolved state
+     */
+    static StateKey keyOf(const std::shared_ptr<State>& state);
+
+    // Batches in the order they were created, and the open batch of every state
+    std::vector<Batch> m_batches;
+    std::map<StateKey, size_t> m_openBatches;
+
+    StaticBatchStats m_stats;
+};
+
+}  // namespace vr
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+namespace vr {
+
+/**
+ * A GPU buffer object that is filled from the CPU, e.g. with per-instance data.
+ * The storage grows when more data is uploaded than fits, and is orphaned on every
+ * upload so the driver does not have to wait for draws still reading the previous content.
+ */
+class Buffer {
+   public:
+    /**
+     * @brief Constructs a new buffer. No storage is allocated until the first upload.
+     *
+     * @param target The target the buffer is bound to, e.g. GL_ARRAY_BUFFER
+     * @param usage The usage hint passed to glBufferData
+     */
+    Buffer(GLenum target, GLenum usage = GL_DYNAMIC_DRAW);
+    ~Buffer();
+
+    /**
+     * @brief Replaces the content of the buffer
+     *
+     * @param data The data to upload
+     * @param size The size of the data in bytes
+     */
+    void upload(const void* data, size_t size);
+
+    /**
+     * @brief Overwrites part of the content of the buffer without orphaning it
+     *
+     * @param offset The offset in bytes to write at, offset + size may not exceed the size of the last upload
+     * @param data The data to write
+     * @param size The size of the data in bytes
+     */
+    void update(size_t offset, const void* data, size_t size);
+
+    /**
+     * @brief Binds the buffer to its target
+     */
+    void bind() const;
+
+    /**
+     * @brief Unbinds any buffer from the target of this buffer
+     */
+    void unbind() const;
+
+    /**
+     * @brief Binds the buffer to an indexed binding point of its target, e.g. of GL_SHADER_STORAGE_BUFFER
+     *
+     * @param index The binding point, matching the binding declared in the shaders
+     */
+    void bindBase(GLuint index) const;
+
+    GLuint id() const { return m_id; }
+
+    /// \return the size of the last upload in bytes
+    size_t size() const { return m_size; }
+
+   private:
+    // Buffers own GL objects and can not be copied
+    Buffer(const Buffer&);
+    Buffer& operator=(const Buffer&);
+
+    GLuint m_id;
+    GLenum m_target;
+    GLenum m_usage;
+    size_t m_size;
+    size_t m_capacity;
+};
+
+}  // namespace vr
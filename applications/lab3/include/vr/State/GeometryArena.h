@@ -0,0 +1,157 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "Buffer.h"
+#include "VertexFormat.h"
+
+// Size of the buffers of one block of the arena, 20 MB of vertices and 8 MB of 16 bit or 16 MB of 32 bit indices
+#define ARENA_BLOCK_VERTICES (1 << 20)
+#define ARENA_BLOCK_INDICES (1 << 22)
+// Geometries with at most this many vertices are stored in blocks with 16 bit indices
+#define ARENA_SHORT_INDEX_VERTICES 65536
+
+namespace vr {
+
+/**
+ * The part of the arena a geometry was given
+ */
+struct ArenaRange {
+    // The block of the range, -1 if the geometry is not in the arena
+    int block;
+    GLuint firstVertex;
+    GLuint vertexCount;
+    GLuint firstIndex;
+    GLuint indexCount;
+
+    ArenaRange() : block(-1), firstVertex(0), vertexCount(0), firstIndex(0), indexCount(0) {}
+};
+
+/**
+ * Vertex and index storage shared by all geometries. The packed vertices and indices of the
+ * geometries are sub-allocated from a few large blocks, each with its own vertex array object, so
+ * every geometry in a block is drawn without binding anything else and a whole pass over a block
+ * can be submitted with one glMultiDrawElementsIndirect. The indices of a range are relative to its
+ * first vertex, draws pass that as the base vertex. A block holds either 16 or 32 bit indices, so
+ * geometries small enough for 16 bit indices keep them.
+ *
+ * The vertex array objects also read the draw index attribute (DRAW_INDEX_LOCATION) from a buffer
+ * holding 0, 1, 2, ... with a divisor, so the base instance of an indirect command selects the
+ * per-draw data of the command.
+ */
+class GeometryArena {
+   public:
+    /**
+     * @brief Get the arena. It is created on first use, which has to be with a current GL context,
+     *        and lives as long as the context.
+     */
+    static GeometryArena& instance();
+
+    /**
+     * @brief Copies a geometry into the arena
+     *
+     * @param vertices The packed vertices
+     * @param indices The indices, relative to the first vertex. Stored in 16 bits if there are at most
+     *                ARENA_SHORT_INDEX_VERTICES vertices.
+     * @param range Receives the range of the geometry
+     * @return false if the geometry is larger than a block
+     */
+    bool allocate(const std::vector<PackedVertex>& vertices, const std::vector<GLuint>& indices, ArenaRange& range);
+
+    /**
+     * @brief Returns a range to the arena, its space is reused by later allocations
+     *
+     * @param range The range given by allocate, reset to an empty range
+     */
+    void free(ArenaRange& range);
+
+    /**
+     * @brief Binds the vertex array object of a block
+     *
+     * @param block The block of a range
+     */
+    void bind(int block) const;
+
+    /**
+     * @brief Draws parts of a range with one glMultiDrawElementsBaseVertex, the block of the range has to be bound
+     *
+     * @param range The range the parts belong to
+     * @param counts The number of indices of each part
+     * @param offsets The byte offset of each part, relative to the first index of the range
+     */
+    void drawRanges(const ArenaRange& range, const std::vector<GLsizei>& counts, const std::vector<const void*>& offsets);
+
+    /**
+     * @brief Get the index type of a block
+     *
+     * @param block The block of a range
+     * @return GLenum GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+     */
+    GLenum indexType(int block) const { return m_blocks[block].indexType; }
+
+    /**
+     * @brief Grows the draw index buffer, so the draw index attribute can be read for draws [0, count)
+     *
+     * @param count The number of per-draw entries that are referenced
+     */
+    void reserveDrawIndices(size_t count);
+
+    /// \return the number of blocks allocated so far
+    size_t blocks() const { return m_blocks.size(); }
+
+   private:
+    GeometryArena();
+
+    /**
+     * A free run of vertices or indices
+     */
+    struct Span {
+        GLuint first;
+        GLuint count;
+    };
+
+    /**
+     * One vertex buffer, index buffer and vertex array object, and their free runs sorted by position
+     */
+    struct Block {
+        GLuint vao;
+        GLuint vertexBuffer;
+        GLuint indexBuffer;
+        GLenum indexType;
+        std::vector<Span> freeVertices;
+        std::vector<Span> freeIndices;
+    };
+
+    /**
+     * @brief Creates a new empty block
+     *
+     * @param indexType The type of the indices stored in the block
+     */
+    void addBlock(GLenum indexType);
+
+    /**
+     * @brief Takes the first free run that is large enough
+     *
+     * @param spans The free runs
+     * @param count The size needed
+     * @param first Receives the start of the space taken
+     * @return false if no run is large enough
+     */
+    static bool take(std::vector<Span>& spans, GLuint count, GLuint& first);
+
+    /**
+     * @brief Gives back space, merging it with the free runs next to it
+     */
+    static void give(std::vector<Span>& spans, GLuint first, GLuint count);
+
+    std::vector<Block> m_blocks;
+    Buffer m_drawIndices;
+    size_t m_drawIndexCount;
+    // Scratch space of drawRanges, the offsets and base vertices of the parts in the block
+    std::vector<const void*> m_rangeOffsets;
+    std::vector<GLint> m_rangeBaseVertices;
+};
+
+}  // namespace vr
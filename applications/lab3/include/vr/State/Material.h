@@ -12,12 +12,29 @@
 #include "Texture.h"
 namespace vr {
 
+/**
+ * A material as it is stored in the material table of the G-buffer shader, laid out to match
+ * the MaterialParameters struct of the shader under the std430 rules
+ */
+struct MaterialData {
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+    glm::vec4 emission;
+    float shininess;
+    // One bit per texture unit that has a texture
+    int activeTextures;
+    // The struct is padded to a multiple of 16 bytes, the alignment of its vec4 members
+    int padding[2];
+};
+
 /// Simple class for storing material properties
 class Material {
    private:
     glm::vec4 m_ambient, m_diffuse, m_specular, m_emission;
 
     GLfloat m_shininess;
+    unsigned int m_version;
 
     typedef std::vector<std::shared_ptr<vr::Texture> > TextureVector;
     TextureVector m_textures;
@@ -50,6 +67,24 @@ class Material {
      * @param shader The shader to apply the material to
      */
     void apply(std::shared_ptr<vr::Shader> shader);
+
+    /**
+     * @brief Binds the textures of the material, the rest of the material is read from the material table
+     */
+    void bindTextures();
+
+    /// \return true if any texture unit of the material has a texture
+    bool hasTextures() const;
+
+    /**
+     * @brief Write the material in the layout of the material table
+     *
+     * @param data The data to write to
+     */
+    void pack(MaterialData& data) const;
+
+    /// \return a counter that is incremented every time a property or texture of the material changes
+    unsigned int version() const { return m_version; }
 };
 
 typedef std::vector<std::shared_ptr<Material> > MaterialVector;
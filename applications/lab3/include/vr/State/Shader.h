@@ -4,9 +4,62 @@
 
 #include <glm/glm.hpp>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+// Attribute locations of the vertex data of geometries, see VertexFormat.h
+#define VERTEX_POSITION_LOCATION 0
+#define VERTEX_NORMAL_LOCATION 1
+#define VERTEX_TEXCOORD_LOCATION 2
+#define VERTEX_TANGENT_LOCATION 3
+
+// Attribute locations of the per-instance data of instanced draws. A mat4 uses four
+// consecutive locations and a mat3 three, shaders declare them with explicit locations.
+#define INSTANCE_MATRIX_LOCATION 5
+#define INSTANCE_NORMAL_MATRIX_LOCATION 9
+
+// Attribute location of the index into the per-draw data of indirect draws, see GeometryArena.h
+#define DRAW_INDEX_LOCATION 12
+
+// Uniform buffer binding of the CameraBlock uniform block, assigned to every program declaring it
+#define CAMERA_BLOCK_BINDING 0
+
 namespace vr {
+class Shader;
+
+/**
+ * Handle to a uniform location of a program, resolved once so that the uniform can be set every frame
+ * without building its name or looking it up. Like the set functions of Shader, the setters upload to
+ * the program currently in use, which has to be the program the handle was resolved from.
+ */
+class Uniform {
+   public:
+    /// Creates a handle that does not refer to any uniform, setting it does nothing
+    Uniform() : m_location(-1) {}
+
+    /// Resolves the location of a named uniform from the location cache of a shader
+    Uniform(const Shader& shader, const std::string& name);
+
+    /// \return true if the uniform is active in the program
+    bool valid() const { return m_location != -1; }
+
+    /// \return the location of the uniform, -1 if it is not active
+    GLint location() const { return m_location; }
+
+    void setBool(bool value) const;
+    void setInt(int value) const;
+    void setFloat(float value) const;
+    void setVec2(const glm::vec2& value) const;
+    void setVec3(const glm::vec3& value) const;
+    void setVec4(const glm::vec4& value) const;
+    void setMat3(const glm::mat3& mat) const;
+    void setMat4(const glm::mat4& mat) const;
+    void setIntArray(const int* values, int count) const;
+
+   private:
+    GLint m_location;
+};
+
 /// Class that encapsulates the use of shaders in OpenGL.
 class Shader {
    public:
@@ -18,15 +71,45 @@ class Shader {
     /// \return the program id.
     GLint program() const;
 
-    /// Activate the shader
+    /// Activate the shader. Does nothing if the shader is already active.
     void use();
 
+    /// \return the number of times a program was bound since the last call to resetStatistics
+    static unsigned int programBinds() { return s_programBinds; }
+
+    /// \return the number of uniforms set since the last call to resetStatistics
+    static unsigned int uniformUploads() { return s_uniformUploads; }
+
+    /// Reset the program bind and uniform upload counters
+    static void resetStatistics();
+
     /**
     \param attributeName - Name of the attribute.
     \return the identifier associated to the given attribute name. -1 if it fails.
     */
     GLint getAttribute(const std::string& attributeName) const;
 
+    /**
+    \param name - Name of the uniform, elements of arrays are named as in GLSL, e.g. "lights[2].diffuse".
+    \return a handle to the uniform that callers can keep for as long as the shader exists.
+    */
+    Uniform uniform(const std::string& name) const;
+
+    /// \return true if the shader reads the world matrix from the instance attributes when the uniform "instanced" is set
+    bool supportsInstancing() const { return m_instanced; }
+
+    /// \return true if the shader reads the view and projection from the CameraBlock uniform block instead of the uniforms "v" and "p"
+    bool usesCameraBlock() const { return m_cameraBlock; }
+
+    /// \return true if the shader reads materials from the material table by the uniform "materialIndex" instead of the uniform "material"
+    bool usesMaterialTable() const { return m_materialTable; }
+
+    /// \return true if the shader decodes the quantized positions of PackedVertex with the uniforms "positionOffset" and "positionScale"
+    bool usesPackedVertices() const { return m_packedVertices; }
+
+    /// \return true if the shader reads the world matrix and material index from the DrawBuffer by the attribute "draw_index" when the uniform "indirect" is set
+    bool supportsIndirect() const { return m_indirect; }
+
     /// Set a named uniform of type bool
     void setBool(const std::string& name, bool value) const;
 
@@ -66,12 +149,40 @@ class Shader {
     /// Set a named uniform of the type of vector of int
     void setIntVector(const std::string& name, const std::vector<int>& vector);
 
+    /// Set a named uniform of the type of array of int from count values
+    void setIntArray(const std::string& name, const int* values, int count);
+
    private:
+    friend class Uniform;
+
     int createShader(const char* source, GLenum shader_type, const char* description);
 
+    /// Fills the location cache with the active uniforms of the linked program
+    void reflectUniforms();
+
+    /// \return the cached location of a uniform, counted as an upload
+    GLint getLocation(const std::string& name) const;
+
+    /// \return the cached location of a uniform, -1 with a warning the first time if it is not active
+    GLint findLocation(const std::string& name) const;
+
     void checkCompileErrors(GLuint shader, std::string type);
     GLuint m_programID;
 
     bool m_valid;
+    bool m_instanced;
+    bool m_cameraBlock;
+    bool m_materialTable;
+    bool m_packedVertices;
+    bool m_indirect;
+
+    // Locations of the active uniforms by name. Names that are looked up but not active are
+    // added with location -1, so the warning is only printed once.
+    mutable std::unordered_map<std::string, GLint> m_locations;
+
+    // The program bound by the last call to use, so the current program does not have to be queried from GL
+    static GLuint s_currentProgram;
+    static unsigned int s_programBinds;
+    static unsigned int s_uniformUploads;
 };
 }  // namespace vr
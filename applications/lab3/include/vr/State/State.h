@@ -13,11 +13,33 @@ class State {
     State(std::shared_ptr<Shader> shader = nullptr) : m_shader(shader),
                                                       lightingEnabled(-1),
                                                       cullFaceEnabled(-1),
-                                                      shadowEnabled(-1) {}
+                                                      shadowEnabled(-1),
+                                                      m_version(0) {}
     // + operator overload. Combines two states into one. Returns a shared pointer to the new state.
     std::shared_ptr<State> operator+(const State& other) const;
     State& operator+=(const State& other);
 
+    /**
+     * @brief Overwrites this state with the combination of a parent and a child state, where the
+     *        child has precedence. Reuses the storage of this state, so it does not allocate once
+     *        the light and texture vectors have grown to size.
+     *
+     * @param parent The parent state
+     * @param child The child state
+     */
+    void combine(const State& parent, const State& child);
+
+    /// \return a counter that is incremented every time the state is modified or combined
+    unsigned int version() const { return m_version; }
+
+    /**
+     * @brief Returns a counter that is incremented every time any state is modified through a setter.
+     *        States written by combine do not count, they are derived from modified states.
+     *
+     * @return unsigned int The number of modifications
+     */
+    static unsigned int changeCount() { return s_changeCount; }
+
     void setLightingEnabled(bool enabled);
     bool LightingEnabled();
 
@@ -42,9 +64,29 @@ class State {
     void setShadowEnabled(bool enabled);
     bool ShadowEnabled();
 
+    /// Applies the whole state: binds the shader, uploads the material, sets face culling and binds the textures
     void apply();
 
+    /// Enables or disables face culling
+    void applyCullFace();
+
+    /// Uploads the material uniforms to the shader, which must be in use
+    void applyMaterial();
+
+    /// Binds the textures and uploads their uniforms to the shader, which must be in use
+    void applyTextures();
+
+    /// \return true if the state has textures of its own, besides the textures of the material
+    bool hasTextures() const { return !m_textures.empty(); }
+
    private:
+    void changed() {
+        m_version++;
+        s_changeCount++;
+    }
+
+    static unsigned int s_changeCount;
+
     int lightingEnabled;
     int cullFaceEnabled;
     int shadowEnabled;
@@ -53,5 +95,7 @@ class State {
     TextureVector m_textures;
     std::shared_ptr<Material> m_material;
     std::shared_ptr<Shader> m_shader;
+
+    unsigned int m_version;
 };
 }  // namespace vr
\ No newline at end of file
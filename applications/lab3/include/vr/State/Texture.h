@@ -22,7 +22,11 @@ namespace vr {
 #define MAX_MATERIAL_TEXTURES 8
 
 #define DEPTH_MAP_DIRECTIONAL_ARRAY_SLOT 11
+// Point shadow maps use one slot per resolution tier, 12 to 12 + SHADOW_TIER_COUNT - 1
 #define DEPTH_MAP_POINT_ARRAY_SLOT 12
+// Prefiltered exponential shadow maps of directional lights, and the intermediate result of filtering them
+#define DEPTH_MAP_EXPONENTIAL_ARRAY_SLOT 15
+#define SHADOW_FILTER_SLOT 16
 
 #define G_BUFFER_POSITION_SLOT 22
 #define G_BUFFER_ALBEDO_SLOT 23
@@ -40,7 +44,16 @@ namespace vr {
 #define SCREEN_TEXTURE_SLOT 32
 
 #define DEPTH_MAP_RESOLUTION 2048
-#define MAX_LIGHTS 50
+#define POINT_SHADOW_NEAR_PLANE 1.0f
+#define POINT_SHADOW_FAR_PLANE 100.0f
+// Point shadow maps come in tiers of halving resolution, starting at POINT_SHADOW_RESOLUTION
+#define POINT_SHADOW_RESOLUTION 1024
+#define SHADOW_TIER_COUNT 3
+// Directional lights split the view frustum into this many shadow maps, one layer each. At most 4,
+// the split depths are passed to the lighting shader in a vec4
+#define SHADOW_CASCADES 4
+// Blend between logarithmic (1) and uniform (0) cascade splits
+#define CASCADE_SPLIT_LAMBDA 0.75f
 
 class Texture {
    public:
@@ -77,8 +90,20 @@ class Texture {
      * @param height the height of the texture
      * @param numberOfLights the number of lights to create the depth map array for
      * @param isDirectional boolean indicating if the texture is to be used for a directional light or not.
+     * @param tier the resolution tier of a point light array, every tier is bound to its own slot
      */
-    void createDepthMapArray(unsigned int width, unsigned int height, int numberOfLights, bool isDirectional = true);
+    void createDepthMapArray(unsigned int width, unsigned int height, int numberOfLights, bool isDirectional = true, int tier = 0);
+
+    /**
+     * @brief Creates an array of single channel float textures with linear filtering, for shadow maps that are
+     *        filtered before they are sampled
+     *
+     * @param slot the texture slot to use
+     * @param width the width of the texture
+     * @param height the height of the texture
+     * @param layers the number of layers
+     */
+    void createFilteredShadowMapArray(unsigned int slot, unsigned int width, unsigned int height, int layers);
 
     /**
      * @brief Creates a noise texture
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "vr/BoundingBox.h"
+
+namespace vr {
+
+/**
+ * A vertex of a geometry as it is stored on the GPU, 20 bytes instead of the 60 of the separate
+ * float arrays. Positions are quantized to the local bounds of the geometry and decoded by the
+ * vertex shader with the uniforms positionOffset and positionScale. Normals and tangents are unit
+ * vectors stored in octahedral encoding, the bitangent is rebuilt from them in the shader.
+ */
+struct PackedVertex {
+    // Position relative to the local bounds, 0 to 65535 along each axis. w is 65535 if the
+    // bitangent points along cross(normal, tangent) and 0 if it points the other way.
+    GLushort position[4];
+    GLshort normal[2];
+    GLshort tangent[2];
+    // Half floats
+    GLhalf texCoord[2];
+};
+
+/**
+ * An attribute of the vertex format, as passed to glVertexAttribPointer
+ */
+struct VertexAttribute {
+    // Name of the attribute in the shaders, which declare it at the location below
+    const char* name;
+    GLuint location;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    size_t offset;
+};
+
+// The attributes of PackedVertex. Geometries bind exactly these attributes, so changing the format
+// only means changing PackedVertex, this table and the decoding in the shaders.
+static const VertexAttribute PACKED_VERTEX_LAYOUT[] = {
+    {"vertex_position", VERTEX_POSITION_LOCATION, 4, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(PackedVertex, position)},
+    {"vertex_normal", VERTEX_NORMAL_LOCATION, 2, GL_SHORT, GL_TRUE, offsetof(PackedVertex, normal)},
+    {"vertex_texCoord", VERTEX_TEXCOORD_LOCATION, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertex, texCoord)},
+    {"vertex_tangent", VERTEX_TANGENT_LOCATION, 2, GL_SHORT, GL_TRUE, offsetof(PackedVertex, tangent)},
+};
+
+#define PACKED_VERTEX_ATTRIBUTES (sizeof(PACKED_VERTEX_LAYOUT) / sizeof(PACKED_VERTEX_LAYOUT[0]))
+
+/**
+ * @brief Points the attributes of PACKED_VERTEX_LAYOUT at the buffer bound to GL_ARRAY_BUFFER and enables them
+ */
+void setPackedVertexAttributes();
+
+/**
+ * @brief Encodes a unit vector as a point on the octahedron, unfolded to [-1, 1]^2
+ *
+ * @param n The unit vector
+ * @return glm::vec2 The encoded vector
+ */
+glm::vec2 octahedralEncode(const glm::vec3& n);
+
+/**
+ * @brief Packs a vertex into the GPU format
+ *
+ * @param position The position in the local space of the geometry
+ * @param normal The normal, (0, 0, 0) if the geometry has no normals
+ * @param texCoord The texture coordinates
+ * @param tangent The tangent, (0, 0, 0) if the geometry has no tangents
+ * @param bitangent The bitangent, only its direction relative to the normal and tangent is stored
+ * @param bounds The local bounds the position is quantized to
+ * @return PackedVertex The packed vertex
+ */
+PackedVertex packVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texCoord, const glm::vec3& tangent,
+                        const glm::vec3& bitangent, const BoundingBox& bounds);
+
+}  // namespace vr
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <map>
+#include <stack>
+#include <vector>
+
+#include "NodeVisitor.h"
+#include "vr/Scene/RenderList.h"
+
+/**
+ * A visitor that traverses the scene graph, collecting states, transformations and levels of detail.
+ * When a geometry node is visited, a draw with the resolved top state is added to the render list.
+ * The traversal only has to be repeated when the structure of the scene graph changes. Resolved
+ * states are cached between compilations and recombined in place when one of their states is modified.
+ */
+
+namespace vr {
+class CompileVisitor : public NodeVisitor {
+   public:
+    CompileVisitor();
+
+    /**
+     * @brief Compiles the graph below root into a render list
+     *
+     * @param root The root of the scene graph
+     * @param renderList The list to fill, previous content is removed
+     */
+    void compile(Group* root, RenderList& renderList);
+
+    /**
+     * @brief Checks if a state was modified since the resolved states were last updated
+     */
+    bool statesChanged() const;
+
+    /**
+     * @brief Recombines the resolved states whose parent or child state was modified. The render
+     *        list keeps pointing to the same states, so it does not have to be compiled again.
+     */
+    void updateStates();
+
+    void visit(Geometry* geometry) override;
+    void visit(Transform* transform) override;
+    void visit(Group* group) override;
+    void visit(LodNode* lodNode) override;
+    void visit(LightNode* lightNode) override;
+    void visit(CameraNode* cameraNode) override;
+
+   private:
+    void pushState(Node* node);
+    void popState(Node* node);
+    std::shared_ptr<State> combine(const std::shared_ptr<State>& parent, const std::shared_ptr<State>& child);
+
+    typedef std::pair<State*, State*> StatePair;
+
+    /**
+     * A resolved state and the versions of the states it was combined from
+     */
+    struct CombinedState {
+        std::shared_ptr<State> parent;
+        std::shared_ptr<State> child;
+        std::shared_ptr<State> state;
+        unsigned int parentVersion;
+        unsigned int childVersion;
+    };
+
+    RenderList* m_renderList;
+    std::stack<Transform*> m_transformStack;
+    std::stack<int> m_lodStack;
+    // Resolved states in the order they were created, so parents always come before their children
+    std::vector<CombinedState> m_combinedStates;
+    std::map<StatePair, int> m_combinedIndices;
+    // Graph version the cached states belong to and state change count they are up to date with
+    unsigned int m_graphVersion;
+    unsigned int m_stateChangeCount;
+};
+
+}  // namespace vr
@@ -2,14 +2,18 @@
 
 #include "NodeVisitor.h"
 #include "vr/Callbacks/UpdateCallback.h"
+#include "vr/Nodes/Node.h"
 
 /**
  * A visitor that traverses the scene graph, calling the update callbacks of the nodes.
+ * It also propagates world matrices and bounding boxes, recomputing the cached matrices of
+ * Transforms and the cached bounds of Groups only along paths where something changed.
  */
 
 namespace vr {
 class UpdateVisitor : public NodeVisitor {
    public:
+    UpdateVisitor();
     void visit(Geometry* geometry) override;
     void visit(Transform* transform) override;
     void visit(Group* group) override;
@@ -20,6 +24,24 @@ class UpdateVisitor : public NodeVisitor {
     void setSceneChanged(bool changed) { m_sceneChanged = changed; }
 
    private:
+    /**
+     * @brief Visits the children of a group
+     *
+     * @return true if the bounds of any child changed
+     */
+    bool visitChildren(NodeVector& children);
+
+    /**
+     * @brief Returns the world matrix of the closest transform above the visited node
+     */
+    glm::mat4 currentWorld() const;
+
     bool m_sceneChanged;
+    // Set by each visit if the bounds of the visited node changed
+    bool m_boundsChanged;
+    // Closest transform above the visited node, nullptr at the root
+    std::stack<Transform*> m_transformStack;
+    // True if the world matrix of the closest transform was recomputed in this traversal
+    std::stack<bool> m_worldChangedStack;
 };
 }  // namespace vr
\ No newline at end of file
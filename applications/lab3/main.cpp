@@ -60,6 +60,14 @@ void keyboard_callback(GLFWwindow* window, int key, int scancode, int action, in
         if (auto app = g_applicationPtr.lock())
             app->toggleShadows();
 
+    if (key == GLFW_KEY_EQUAL && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        if (auto app = g_applicationPtr.lock())
+            app->changeShadowedLights(1);
+
+    if (key == GLFW_KEY_MINUS && (action == GLFW_PRESS || action == GLFW_REPEAT))
+        if (auto app = g_applicationPtr.lock())
+            app->changeShadowedLights(-1);
+
     // Select lights with 0-9 keys
     if (key >= GLFW_KEY_0 && key <= GLFW_KEY_9 && action == GLFW_PRESS) {
         if (auto app = g_applicationPtr.lock()) {
@@ -108,6 +116,11 @@ void keyboard_callback(GLFWwindow* window, int key, int scancode, int action, in
             app->toggleDOF();
     }
 
+    if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+        if (auto app = g_applicationPtr.lock())
+            app->toggleStatistics();
+    }
+
 }
 
 void window_size_callback(GLFWwindow* window, int width, int height) {
@@ -123,7 +136,7 @@ GLFWwindow* initializeWindows(int width, int height) {
         return nullptr;
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     window = glfwCreateWindow(width, height, "ObjViewer", NULL, NULL);
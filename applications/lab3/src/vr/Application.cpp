@@ -24,6 +24,9 @@ Application::Application(unsigned int width, unsigned height) : m_screenSize(wid
     m_fpsCounter->setFontScale(0.5f);
     m_fpsCounter->setColor(glm::vec4(0.2, 1.0, 1.0, 1.0));
 
+    m_statsText.setScale(0.5f);
+    m_statsText.setColor(glm::vec4(0.2, 1.0, 1.0, 1.0));
+
     m_quad_shader = std::make_shared<Shader>("shaders/quad-shader.vs", "shaders/quad-shader.fs");
 
     initTextureBuffers();
@@ -133,6 +136,11 @@ bool Application::initResources(const std::string& model_filename, const std::st
         return false;
     }
 
+    m_ssaoSampleUniforms.clear();
+    for (size_t i = 0; i < m_ssaoKernel.size(); i++) {
+        m_ssaoSampleUniforms.push_back(m_ssao_shader->uniform("samples[" + std::to_string(i) + "]"));
+    }
+
     m_scene = std::shared_ptr<Scene>(Scene::getInstance());
     m_scene->cleanup();
     if (!m_scene->initShaders(vshader_filename, fshader_filename))
@@ -386,14 +394,10 @@ void Application::renderSSAO() {
     glBindFramebuffer(GL_FRAMEBUFFER, m_ssaoFBO[0]);
     glClear(GL_COLOR_BUFFER_BIT);
     m_ssao_shader->use();
-    for (int i = 0; i < m_ssaoKernel.size(); i++) {
-        m_ssao_shader->setVec3("samples[" + std::to_string(i) + "]", m_ssaoKernel[i]);
+    for (size_t i = 0; i < m_ssaoKernel.size(); i++) {
+        m_ssaoSampleUniforms[i].setVec3(m_ssaoKernel[i]);
     }
-    m_ssao_shader->setMat4("p", getCamera()->getProjection());
-    m_ssao_shader->setMat4("v", getCamera()->getView());
     m_ssao_shader->setInt("kernelSize", m_ssaoKernel.size());
-    m_ssao_shader->setFloat("screenX", m_screenSize.x);
-    m_ssao_shader->setFloat("screenY", m_screenSize.y);
 
     m_scene->getGbufferTexture(GBUFFER_POSITION)->bind();
     m_scene->getGbufferTexture(GBUFFER_NORMAL)->bind();
@@ -425,29 +429,19 @@ void Application::renderToTexture() {
     m_scene_shader->setInt("gNormalAmbient", G_BUFFER_NORMAL_SLOT);
     m_scene_shader->setInt("gAlbedoAmbient", G_BUFFER_ALBEDO_SLOT);
     m_scene_shader->setInt("gAoMetallicRoughness", G_BUFFER_METALLIC_ROUGHNESS);
-    m_scene_shader->setVec3("viewPos", getCamera()->getPosition());
     m_scene_shader->setBool("shadowsEnabled", m_scene->shadowsEnabled());
 
-    LightVector lights = m_scene->getLights();
+    // The lights are read from the light buffer through the light lists of the clusters, both built by the scene
+    std::shared_ptr<LightBuffer> lightBuffer = m_scene->getLightBuffer();
+    lightBuffer->apply();
+    m_scene->getLightClusters()->apply(m_scene_shader);
 
-    int pointLightIndex = 0;
-    int directionalLightIndex = 0;
-
-    for (int i = 0; i < lights.size(); i++) {
-        if (lights[i]->getPosition().w == 0.0) {
-            lights[i]->apply(m_scene_shader, i, m_scene->shadowsEnabled());
-            m_scene->getDirectionalShadowMap()->bind();
-            m_scene_shader->setInt("directionalShadowMaps", m_scene->getDirectionalShadowMap()->slot());
-            m_scene_shader->setInt("lights[" + std::to_string(i) + "].shadowMapIndex", directionalLightIndex);
-            directionalLightIndex++;
-        } else {
-            lights[i]->apply(m_scene_shader, i, m_scene->shadowsEnabled());
-            m_scene->getPointShadowMap()->bind();
-            m_scene_shader->setInt("pointShadowMaps", m_scene->getPointShadowMap()->slot());
-            m_scene_shader->setInt("lights[" + std::to_string(i) + "].shadowMapIndex", pointLightIndex);
-            pointLightIndex++;
-        }
-    }
+    // The shadow samplers always point at their own slots, also when there are no lights of a type
+    if (lightBuffer->directionalCount() > 0)
+        m_scene->getDirectionalShadowMap()->bind();
+    m_scene_shader->setInt("directionalShadowMaps", DEPTH_MAP_DIRECTIONAL_ARRAY_SLOT);
+    m_scene->getShadowPrefilter()->apply(m_scene_shader);
+    m_scene->getShadowAtlas()->apply(m_scene_shader);
 
     drawQuad();
 
@@ -473,6 +467,26 @@ void Application::render(GLFWwindow* window) {
         renderDebug();
 
     m_fpsCounter->render(window);
+
+    if (m_showStatistics)
+        renderStatistics(window);
+}
+
+void Application::renderStatistics(GLFWwindow* window) {
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+
+    // Text has no support for line breaks, so every line is rendered below the fps counter
+    std::vector<std::string> statistics = m_scene->getStatistics();
+    for (size_t i = 0; i < statistics.size(); i++) {
+        m_statsText.setPosition(glm::vec2(0.0, 0.94 - i * 0.03));
+        m_statsText.setText(statistics[i]);
+        m_statsText.render(width, height);
+    }
+}
+
+void Application::toggleStatistics() {
+    m_showStatistics = !m_showStatistics;
 }
 
 void Application::update(GLFWwindow* window) {
@@ -553,6 +567,11 @@ void Application::toggleShadows() {
     m_scene->toggleShadows();
 }
 
+void Application::changeShadowedLights(int delta) {
+    int count = int(m_scene->getMaxShadowedLights()) + delta;
+    m_scene->setMaxShadowedLights(count < 0 ? 0 : count);
+}
+
 void Application::toggleBloom() {
     m_bloom = !m_bloom;
 }
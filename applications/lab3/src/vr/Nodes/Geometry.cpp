@@ -1,12 +1,29 @@
 #include "vr/Nodes/Geometry.h"
 
+#include <vr/Scene/MeshletCuller.h>
+#include <vr/State/VertexFormat.h>
 #include <vr/glErrorUtil.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtx/transform.hpp>
 
 using namespace vr;
 
+// Uniform names are constructed once, the draws only look them up in the location cache of the shader
+namespace {
+const std::string INSTANCED_UNIFORM = "instanced";
+const std::string MODEL_UNIFORM = "m";
+const std::string NORMAL_MATRIX_UNIFORM = "m_3x3_inv_transp";
+const std::string POSITION_OFFSET_UNIFORM = "positionOffset";
+const std::string POSITION_SCALE_UNIFORM = "positionScale";
+}  // namespace
+
 Geometry::~Geometry() {
+    if (inArena())
+        GeometryArena::instance().free(m_arenaRange);
+
     if (m_useVAO && m_vao != 0) {
         glDeleteVertexArrays(1, &m_vao);
         m_vao = 0;
@@ -17,30 +34,10 @@ Geometry::~Geometry() {
         m_vbo_vertices = 0;
     }
 
-    if (m_vbo_normals != 0) {
-        glDeleteBuffers(1, &m_vbo_normals);
-        m_vbo_normals = 0;
-    }
-
-    if (m_vbo_texCoords != 0) {
-        glDeleteBuffers(1, &m_vbo_texCoords);
-        m_vbo_texCoords = 0;
-    }
-
     if (m_ibo_elements != 0) {
         glDeleteBuffers(1, &m_ibo_elements);
         m_ibo_elements = 0;
     }
-
-    if (m_vbo_tangents != 0) {
-        glDeleteBuffers(1, &m_vbo_tangents);
-        m_vbo_tangents = 0;
-    }
-
-    if (m_vbo_bitangents != 0) {
-        glDeleteBuffers(1, &m_vbo_bitangents);
-        m_vbo_bitangents = 0;
-    }
 }
 
 void Geometry::accept(NodeVisitor& visitor) {
@@ -50,38 +47,32 @@ void Geometry::accept(NodeVisitor& visitor) {
 bool Geometry::initShader(const std::shared_ptr<vr::Shader>& shader) {
     shader->use();
 
-    const char* attributeName;
-    attributeName = "vertex_position";
-    m_attribute_v_coord = shader->getAttribute(attributeName);
-    if (m_attribute_v_coord == -1)
-        return false;
-
-    attributeName = "vertex_normal";
-    m_attribute_v_normal = shader->getAttribute(attributeName);
-    if (m_attribute_v_normal == -1)
-        return false;
-
-    attributeName = "vertex_texCoord";
-    m_attribute_v_texCoords = shader->getAttribute(attributeName);
-    if (m_attribute_v_texCoords == -1)
-        return false;
-
-    attributeName = "vertex_tangent";
-    m_attribute_v_tangent = shader->getAttribute(attributeName);
-    if (m_attribute_v_tangent == -1)
-        return false;
-
-    attributeName = "vertex_bitangent";
-    m_attribute_v_bitangent = shader->getAttribute(attributeName);
-    if (m_attribute_v_bitangent == -1)
-        return false;
+    // The attribute pointers are set up once for the fixed locations, not for the shader at hand
+    for (size_t i = 0; i < PACKED_VERTEX_ATTRIBUTES; i++) {
+        const VertexAttribute& attribute = PACKED_VERTEX_LAYOUT[i];
+        if (shader->getAttribute(attribute.name) != GLint(attribute.location))
+            return false;
+    }
 
     return true;
 }
 
 void Geometry::upload() {
+    if (inArena())
+        GeometryArena::instance().free(m_arenaRange);
+
+    // Geometries without normals are drawn as bounding boxes and never read their buffers
+    if (m_useVAO && !m_vertices.empty() && !m_normals.empty() && !m_indices.empty()) {
+        std::vector<PackedVertex> packed;
+        packVertices(packed);
+        if (GeometryArena::instance().allocate(packed, m_indices, m_arenaRange)) {
+            m_indexType = GeometryArena::instance().indexType(m_arenaRange.block);
+            return;
+        }
+    }
+
     if (m_useVAO) {
-        // Create a Vertex Array Object that will handle all VBO:s of this Mesh
+        // Create a Vertex Array Object that will handle the buffers of this Mesh
         glGenVertexArrays(1, &m_vao);
         CHECK_GL_ERROR_LINE_FILE();
         glBindVertexArray(m_vao);
@@ -89,141 +80,95 @@ void Geometry::upload() {
     }
 
     if (m_vertices.size() > 0) {
+        std::vector<PackedVertex> packed;
+        packVertices(packed);
+
         glGenBuffers(1, &this->m_vbo_vertices);
         glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_vertices);
-        glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(m_vertices[0]),
-                     m_vertices.data(), GL_STATIC_DRAW);
-        CHECK_GL_ERROR_LINE_FILE();
-    }
-
-    if (this->m_normals.size() > 0) {
-        glGenBuffers(1, &this->m_vbo_normals);
-        glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_normals);
-        glBufferData(GL_ARRAY_BUFFER, this->m_normals.size() * sizeof(this->m_normals[0]),
-                     this->m_normals.data(), GL_STATIC_DRAW);
-        CHECK_GL_ERROR_LINE_FILE();
-    }
-
-    if (this->m_texCoords.size() > 0) {
-        glGenBuffers(1, &this->m_vbo_texCoords);
-        glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_texCoords);
-        glBufferData(GL_ARRAY_BUFFER, this->m_texCoords.size() * sizeof(this->m_texCoords[0]),
-                     this->m_texCoords.data(), GL_STATIC_DRAW);
-        CHECK_GL_ERROR_LINE_FILE();
-    }
-
-    if (this->m_tangents.size() > 0) {
-        glGenBuffers(1, &this->m_vbo_tangents);
-        glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_tangents);
-        glBufferData(GL_ARRAY_BUFFER, this->m_tangents.size() * sizeof(this->m_tangents[0]),
-                     this->m_tangents.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
         CHECK_GL_ERROR_LINE_FILE();
-    }
-
-    if (this->m_bitangents.size() > 0) {
-        glGenBuffers(1, &this->m_vbo_bitangents);
-        glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_bitangents);
-        glBufferData(GL_ARRAY_BUFFER, this->m_bitangents.size() * sizeof(this->m_bitangents[0]),
-                     this->m_bitangents.data(), GL_STATIC_DRAW);
-        CHECK_GL_ERROR_LINE_FILE();
-    }
-
-    if (m_useVAO) {
-        if (this->m_vbo_vertices != 0) {
-            glEnableVertexAttribArray(m_attribute_v_coord);
-            glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_vertices);
-            glVertexAttribPointer(
-                m_attribute_v_coord,  // attribute
-                4,                    // number of elements per vertex, here (x,y,z,w)
-                GL_FLOAT,             // the type of each element
-                GL_FALSE,             // take our values as-is
-                0,                    // no extra data between each position
-                0                     // offset of first element
-            );
-            glDisableVertexAttribArray(m_attribute_v_coord);
-        }
 
-        if (this->m_vbo_normals != 0) {
-            glEnableVertexAttribArray(m_attribute_v_normal);
-            glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_normals);
-            glVertexAttribPointer(
-                m_attribute_v_normal,  // attribute
-                3,                     // number of elements per vertex, here (x,y,z)
-                GL_FLOAT,              // the type of each element
-                GL_FALSE,              // take our values as-is
-                0,                     // no extra data between each position
-                0                      // offset of first element
-            );
-            glDisableVertexAttribArray(m_attribute_v_normal);
-        }
-
-        if (this->m_vbo_texCoords != 0) {
-            glEnableVertexAttribArray(m_attribute_v_texCoords);
-            glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_texCoords);
-            glVertexAttribPointer(
-                m_attribute_v_texCoords,  // attribute
-                2,                        // number of elements per vertex, here (x,y)
-                GL_FLOAT,                 // the type of each element
-                GL_FALSE,                 // take our values as-is
-                0,                        // no extra data between each position
-                0                         // offset of first element
-            );
-            glDisableVertexAttribArray(m_attribute_v_texCoords);
-        }
-
-        if (this->m_vbo_tangents != 0) {
-            glEnableVertexAttribArray(m_attribute_v_tangent);
-            glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_tangents);
-            glVertexAttribPointer(
-                m_attribute_v_tangent,  // attribute
-                3,                      // number of elements per vertex, here (x,y,z)
-                GL_FLOAT,               // the type of each element
-                GL_FALSE,               // take our values as-is
-                0,                      // no extra data between each position
-                0                       // offset of first element
-            );
-            glDisableVertexAttribArray(m_attribute_v_tangent);
-        }
-
-        if (this->m_vbo_bitangents != 0) {
-            glEnableVertexAttribArray(m_attribute_v_bitangent);
-            glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_bitangents);
-            glVertexAttribPointer(
-                m_attribute_v_bitangent,  // attribute
-                3,                        // number of elements per vertex, here (x,y,z)
-                GL_FLOAT,                 // the type of each element
-                GL_FALSE,                 // take our values as-is
-                0,                        // no extra data between each position
-                0                         // offset of first element
-            );
-            glDisableVertexAttribArray(m_attribute_v_bitangent);
-        }
+        // The attributes stay enabled in the vertex array object
+        if (m_useVAO)
+            bindVertexFormat();
     }
 
     if (this->m_indices.size() > 0) {
         glGenBuffers(1, &this->m_ibo_elements);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->m_ibo_elements);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->m_indices.size() * sizeof(this->m_indices[0]),
-                     this->m_indices.data(), GL_STATIC_DRAW);
+
+        if (m_vertices.size() <= 65536) {
+            std::vector<GLushort> shortIndices(m_indices.begin(), m_indices.end());
+            m_indexType = GL_UNSIGNED_SHORT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+        } else {
+            m_indexType = GL_UNSIGNED_INT;
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->m_indices.size() * sizeof(this->m_indices[0]),
+                         this->m_indices.data(), GL_STATIC_DRAW);
+        }
     }
 
     CHECK_GL_ERROR_LINE_FILE();
 
     if (m_useVAO) {
         // Now release VAO
-        glEnableVertexAttribArray(0);  // Disable our Vertex Array Object
-        glBindVertexArray(0);          // Disable our Vertex Buffer Object
+        glBindVertexArray(0);
         CHECK_GL_ERROR_LINE_FILE();
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
 }
 
+void Geometry::packVertices(std::vector<PackedVertex>& packed) const {
+    packed.resize(m_vertices.size());
+    for (size_t i = 0; i < m_vertices.size(); i++) {
+        glm::vec3 normal = i < m_normals.size() ? m_normals[i] : glm::vec3(0.0f);
+        glm::vec2 texCoord = i < m_texCoords.size() ? m_texCoords[i] : glm::vec2(0.0f);
+        glm::vec3 tangent = i < m_tangents.size() ? m_tangents[i] : glm::vec3(0.0f);
+        glm::vec3 bitangent = i < m_bitangents.size() ? m_bitangents[i] : glm::vec3(0.0f);
+        packed[i] = packVertex(glm::vec3(m_vertices[i]), normal, texCoord, tangent, bitangent, m_localBounds);
+    }
+}
+
+void Geometry::bindVertexFormat() {
+    glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_vertices);
+    setPackedVertexAttributes();
+    CHECK_GL_ERROR_LINE_FILE();
+}
+
+void Geometry::setPositionDecode(std::shared_ptr<vr::Shader> const& shader, const glm::vec3& offset, const glm::vec3& scale) {
+    if (!shader->usesPackedVertices())
+        return;
+
+    shader->setVec3(POSITION_OFFSET_UNIFORM, offset);
+    shader->setVec3(POSITION_SCALE_UNIFORM, scale);
+}
+
+void Geometry::setMeshlets(bool enabled) {
+    if (enabled && m_indices.size() >= 3 && m_indices.size() % 3 == 0)
+        buildMeshlets(m_vertices, m_indices, m_meshlets);
+    else
+        m_meshlets.clear();
+}
+
+int Geometry::findSubMesh(GLuint index) const {
+    // The first sub-mesh that ends after the index
+    auto it = std::upper_bound(m_subMeshes.begin(), m_subMeshes.end(), index, [](GLuint value, const SubMesh& subMesh) {
+        return value < subMesh.firstIndex + subMesh.indexCount;
+    });
+
+    if (it == m_subMeshes.end() || index < it->firstIndex)
+        return -1;
+    return int(it - m_subMeshes.begin());
+}
+
 void Geometry::setInitialTransform(const glm::mat4& modelMatrix) {
     m_object2world = m_initialTransform = modelMatrix;
+    m_normalMatrix = glm::inverseTranspose(glm::mat3(m_object2world));
 }
 
 void Geometry::resetTransform() {
     m_object2world = m_initialTransform;
+    m_normalMatrix = glm::inverseTranspose(glm::mat3(m_object2world));
 }
 
 void Geometry::buildGeometry(std::vector<glm::vec4> vertices, std::vector<glm::vec3> normals,
@@ -232,112 +177,133 @@ void Geometry::buildGeometry(std::vector<glm::vec4> vertices, std::vector<glm::v
     m_normals = normals;
     m_texCoords = texCoords;
     m_indices = indices;
+    m_meshlets.clear();
+    updateLocalBounds();
 }
 
-void Geometry::draw(std::shared_ptr<vr::Shader> const& shader, const glm::mat4& modelMatrix, bool depthPass) {
-    if (m_useVAO) {
-        glBindVertexArray(m_vao);
-        CHECK_GL_ERROR_LINE_FILE();
+void Geometry::updateLocalBounds() {
+    m_localBounds = BoundingBox();
+    for (auto& v : m_vertices) {
+        m_localBounds.expand(glm::vec3(v));
     }
+}
 
-    if (m_normals.size() == 0) {
-        draw_bbox(shader);
-        return;
+void Geometry::draw(std::shared_ptr<vr::Shader> const& shader, const glm::mat4& world, const glm::mat3& normalMatrix,
+                    const MeshletCuller* meshlets) {
+    if (shader->supportsInstancing())
+        shader->setBool(INSTANCED_UNIFORM, false);
+
+    shader->setMat4(MODEL_UNIFORM, world);
+    /*
+    Normal vectors are transformed with the transpose of inverse of upper left
+    3x3 model matrix (ex-gl_NormalMatrix), which is cached by the caller
+    */
+    shader->setMat3(NORMAL_MATRIX_UNIFORM, normalMatrix);
+
+    submit(shader, nullptr, 0, 1, 1, meshlets);
+}
+
+void Geometry::drawDepth(std::shared_ptr<vr::Shader> const& shader, const glm::mat4& world, const MeshletCuller* meshlets) {
+    if (shader->supportsInstancing())
+        shader->setBool(INSTANCED_UNIFORM, false);
+
+    shader->setMat4(MODEL_UNIFORM, world);
+
+    submit(shader, nullptr, 0, 1, 1, meshlets);
+}
+
+void Geometry::drawInstanced(std::shared_ptr<vr::Shader> const& shader, const Buffer& instances, GLintptr offset, GLsizei count,
+                             GLuint repeat) {
+    shader->setBool(INSTANCED_UNIFORM, true);
+
+    submit(shader, &instances, offset, count, repeat);
+}
+
+void Geometry::enableInstanceAttributes(const Buffer& instances, GLintptr offset, GLuint divisor) {
+    instances.bind();
+
+    // Matrices are passed as one attribute per column, advanced once every divisor instances
+    for (GLuint i = 0; i < 4; i++) {
+        GLuint location = INSTANCE_MATRIX_LOCATION + i;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (const void*)(offset + offsetof(InstanceData, world) + i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, divisor);
     }
 
-    if (!m_useVAO) {
-        if (this->m_vbo_vertices != 0) {
-            glEnableVertexAttribArray(m_attribute_v_coord);
-            glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_vertices);
-            glVertexAttribPointer(
-                m_attribute_v_coord,  // attribute
-                4,                    // number of elements per vertex, here (x,y,z,w)
-                GL_FLOAT,             // the type of each element
-                GL_FALSE,             // take our values as-is
-                0,                    // no extra data between each position
-                0                     // offset of first element
-            );
-        }
+    for (GLuint i = 0; i < 3; i++) {
+        GLuint location = INSTANCE_NORMAL_MATRIX_LOCATION + i;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (const void*)(offset + offsetof(InstanceData, normalMatrix) + i * sizeof(glm::vec3)));
+        glVertexAttribDivisor(location, divisor);
+    }
+    CHECK_GL_ERROR_LINE_FILE();
+}
 
-        if (this->m_vbo_normals != 0) {
-            glEnableVertexAttribArray(m_attribute_v_normal);
-            glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_normals);
-            glVertexAttribPointer(
-                m_attribute_v_normal,  // attribute
-                3,                     // number of elements per vertex, here (x,y,z)
-                GL_FLOAT,              // the type of each element
-                GL_FALSE,              // take our values as-is
-                0,                     // no extra data between each position
-                0                      // offset of first element
-            );
-        }
-        if (this->m_vbo_texCoords != 0) {
-            glEnableVertexAttribArray(m_attribute_v_texCoords);
-            glBindBuffer(GL_ARRAY_BUFFER, this->m_vbo_texCoords);
-            glVertexAttribPointer(
-                m_attribute_v_texCoords,  // attribute
-                2,                        // number of elements per vertex, here (x,y,z)
-                GL_FLOAT,                 // the type of each element
-                GL_FALSE,                 // take our values as-is
-                0,                        // no extra data between each position
-                0                         // offset of first element
-            );
-        }
-    } else {
-        glEnableVertexAttribArray(m_attribute_v_coord);
-        CHECK_GL_ERROR_LINE_FILE();
-        glEnableVertexAttribArray(m_attribute_v_normal);
-        CHECK_GL_ERROR_LINE_FILE();
-        if (m_vbo_texCoords != 0)
-            glEnableVertexAttribArray(m_attribute_v_texCoords);
+void Geometry::disableInstanceAttributes() {
+    for (GLuint i = 0; i < 4; i++)
+        glDisableVertexAttribArray(INSTANCE_MATRIX_LOCATION + i);
 
-        if (m_vbo_tangents != 0)
-            glEnableVertexAttribArray(m_attribute_v_tangent);
+    for (GLuint i = 0; i < 3; i++)
+        glDisableVertexAttribArray(INSTANCE_NORMAL_MATRIX_LOCATION + i);
+}
 
-        if (m_vbo_bitangents != 0)
-            glEnableVertexAttribArray(m_attribute_v_bitangent);
+void Geometry::submit(std::shared_ptr<vr::Shader> const& shader, const Buffer* instances, GLintptr offset, GLsizei count,
+                      GLuint repeat, const MeshletCuller* meshlets) {
+    if (inArena()) {
+        GeometryArena::instance().bind(m_arenaRange.block);
+    } else if (m_useVAO) {
+        glBindVertexArray(m_vao);
         CHECK_GL_ERROR_LINE_FILE();
     }
 
-    /* Apply object's transformation matrix */
-    glm::mat4 obj2World = modelMatrix * m_object2world;
+    if (m_normals.size() == 0) {
+        draw_bbox(shader);
+        return;
+    }
 
-    shader->setMat4("m", obj2World);
-    /*
-    Transform normal vectors with transpose of inverse of upper left
-    3x3 model matrix (ex-gl_NormalMatrix):
-    */
+    if (!m_useVAO && this->m_vbo_vertices != 0)
+        bindVertexFormat();
 
-    if (!depthPass) {
-        glm::mat3 m_3x3_inv_transp = glm::transpose(glm::inverse(glm::mat3(obj2World)));
-        shader->setMat3("m_3x3_inv_transp", m_3x3_inv_transp);
-    }
+    setPositionDecode(shader, m_localBounds.min(), m_localBounds.max() - m_localBounds.min());
+
+    if (instances)
+        enableInstanceAttributes(*instances, offset, repeat);
 
     /* Push each element in buffer_vertices to the vertex shader */
-    if (this->m_ibo_elements != 0) {
+    if (this->m_ibo_elements != 0 || inArena()) {
         if (!m_useVAO)
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->m_ibo_elements);
         GLuint size = GLuint(this->m_indices.size());
-        glDrawElements(GL_TRIANGLES, size, GL_UNSIGNED_INT, 0);
+        // Geometries with buffers of their own start at 0, like an empty arena range
+        const void* first = (const void*)(size_t(m_arenaRange.firstIndex) * getIndexSize());
+        GLint baseVertex = GLint(m_arenaRange.firstVertex);
+        if (instances) {
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, size, m_indexType, first, count * repeat, baseVertex);
+        } else if (meshlets && inArena()) {
+            // The ranges of the culler are relative to the first index of the geometry
+            GeometryArena::instance().drawRanges(m_arenaRange, meshlets->counts(), meshlets->offsets());
+        } else if (meshlets) {
+            glMultiDrawElements(GL_TRIANGLES, meshlets->counts().data(), m_indexType, meshlets->offsets().data(),
+                                GLsizei(meshlets->counts().size()));
+        } else {
+            glDrawElementsBaseVertex(GL_TRIANGLES, size, m_indexType, first, baseVertex);
+        }
         CHECK_GL_ERROR_LINE_FILE();
+    } else if (instances) {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, (GLsizei)this->m_vertices.size(), count * repeat);
     } else {
         glDrawArrays(GL_TRIANGLES, 0, (GLsizei)this->m_vertices.size());
     }
 
-    if (this->m_vbo_normals != 0)
-        glDisableVertexAttribArray(m_attribute_v_normal);
-
-    if (this->m_vbo_vertices != 0)
-        glDisableVertexAttribArray(m_attribute_v_coord);
-
-    if (this->m_vbo_texCoords != 0)
-        glDisableVertexAttribArray(m_attribute_v_texCoords);
+    if (instances)
+        disableInstanceAttributes();
 
-    if (this->m_vbo_tangents != 0)
-        glDisableVertexAttribArray(m_attribute_v_tangent);
-
-    if (this->m_vbo_bitangents != 0)
-        glDisableVertexAttribArray(m_attribute_v_bitangent);
+    if (!m_useVAO) {
+        for (size_t i = 0; i < PACKED_VERTEX_ATTRIBUTES; i++)
+            glDisableVertexAttribArray(PACKED_VERTEX_LAYOUT[i].location);
+    }
 
     if (m_useVAO)
         glBindVertexArray(0);
@@ -423,19 +389,22 @@ void Geometry::draw_bbox(std::shared_ptr<vr::Shader> shader) {
 
     /* Apply object's transformation matrix */
     glm::mat4 m = this->m_object2world * transform;
-    shader->setMat4("m", m);
+    shader->setMat4(MODEL_UNIFORM, m);
 
     CHECK_GL_ERROR_LINE_FILE();
 
+    // The box corners are plain floats, decoded as they are
+    setPositionDecode(shader, glm::vec3(0.0f), glm::vec3(1.0f));
+
     glBindBuffer(GL_ARRAY_BUFFER, vbo_vertices);
-    glEnableVertexAttribArray(m_attribute_v_coord);
+    glEnableVertexAttribArray(VERTEX_POSITION_LOCATION);
     glVertexAttribPointer(
-        m_attribute_v_coord,  // attribute
-        4,                    // number of elements per vertex, here (x,y,z,w)
-        GL_FLOAT,             // the type of each element
-        GL_FALSE,             // take our values as-is
-        0,                    // no extra data between each position
-        0                     // offset of first element
+        VERTEX_POSITION_LOCATION,  // attribute
+        4,                         // number of elements per vertex, here (x,y,z,w)
+        GL_FLOAT,                  // the type of each element
+        GL_FALSE,                  // take our values as-is
+        0,                         // no extra data between each position
+        0                          // offset of first element
     );
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo_elements);
@@ -444,7 +413,7 @@ void Geometry::draw_bbox(std::shared_ptr<vr::Shader> shader) {
     glDrawElements(GL_LINES, 8, GL_UNSIGNED_SHORT, (GLvoid*)(8 * sizeof(GLushort)));
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-    glDisableVertexAttribArray(m_attribute_v_coord);
+    glDisableVertexAttribArray(VERTEX_POSITION_LOCATION);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     glDeleteBuffers(1, &vbo_vertices);
@@ -453,10 +422,9 @@ void Geometry::draw_bbox(std::shared_ptr<vr::Shader> shader) {
 }
 
 BoundingBox Geometry::calculateBoundingBox(glm::mat4 t_mat) {
-    BoundingBox box;
-    for (auto v : m_vertices) {
-        glm::vec3 vTransformed = t_mat * m_object2world * v;
-        box.expand(vTransformed);
-    }
-    return box;
+    return m_localBounds * (t_mat * m_object2world);
+}
+
+BoundingBox Geometry::getBounds(const glm::mat4& world) {
+    return m_localBounds * (world * m_object2world);
 }
\ No newline at end of file
@@ -8,6 +8,8 @@ void Group::accept(NodeVisitor& visitor) {
 
 void Group::addChild(std::shared_ptr<Node> node) {
     m_children.push_back(node);
+    m_boundsDirty = true;
+    graphChanged();
 }
 
 NodeVector& Group::getChildren() {
@@ -16,16 +18,40 @@ NodeVector& Group::getChildren() {
 
 void Group::setChildren(NodeVector& children) {
     m_children = children;
+    m_boundsDirty = true;
+    graphChanged();
 }
 
 BoundingBox Group::calculateBoundingBox(glm::mat4 t_mat) {
     BoundingBox bbox;
 
-    if (m_excludeFromBoundingBox)
-        return bbox;
-
-    for (auto child : m_children) {
+    for (auto& child : m_children) {
         bbox.expand(child->calculateBoundingBox(t_mat));
     }
+
+    m_bounds = bbox;
+    m_boundsDirty = false;
+
+    if (m_excludeFromBoundingBox)
+        return BoundingBox();
+
     return bbox;
 }
+
+BoundingBox Group::getBounds(const glm::mat4&) {
+    if (m_excludeFromBoundingBox)
+        return BoundingBox();
+
+    return m_bounds;
+}
+
+void Group::refitBounds(const glm::mat4& world) {
+    BoundingBox bbox;
+
+    for (auto& child : m_children) {
+        bbox.expand(child->getBounds(world));
+    }
+
+    m_bounds = bbox;
+    m_boundsDirty = false;
+}
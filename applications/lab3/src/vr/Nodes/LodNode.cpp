@@ -13,11 +13,19 @@ void LodNode::addChild(float distance, std::shared_ptr<Group> node) {
     m_children.push_back(std::make_pair(distance, node));
     // Keep the children sorted by distance, smallest first
     std::sort(m_children.begin(), m_children.end(), [](const GroupPair& a, const GroupPair& b) { return a.first < b.first; });
+    m_boundsDirty = true;
+    graphChanged();
+}
+
+std::vector<GroupPair>& LodNode::getChildren() {
+    return m_children;
 }
 
 Group* LodNode::getChild(const glm::vec3& cameraPosition) {
-    float distance = glm::distance(cameraPosition, bbox.getCenter());
+    return getChild(glm::distance(cameraPosition, bbox.getCenter()));
+}
 
+Group* LodNode::getChild(float distance) {
     for (auto& child : m_children) {
         if (distance < child.first) {
             return child.second.get();
@@ -40,6 +48,14 @@ void LodNode::setMaxDistance(float maxDistance) {
 
 BoundingBox LodNode::calculateBoundingBox(glm::mat4 m_mat) {
     // Calculate the bounding box for the child with the smallest distance
+    if (m_children.empty())
+        return BoundingBox();
+
     bbox = m_children.front().second->calculateBoundingBox(m_mat);
+    m_boundsDirty = false;
+    return bbox;
+}
+
+BoundingBox LodNode::getBounds(const glm::mat4&) {
     return bbox;
 }
\ No newline at end of file
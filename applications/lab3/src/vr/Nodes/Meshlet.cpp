@@ -0,0 +1,101 @@
+#include <vr/Nodes/Meshlet.h>
+
+#include "vr/BoundingBox.h"
+
+using namespace vr;
+
+namespace {
+
+/**
+ * Computes the bounding sphere and normal cone of the triangles [first, first + count) of a meshlet
+ */
+Meshlet finishMeshlet(const std::vector<glm::vec4>& vertices, const std::vector<GLuint>& indices, GLuint first, GLuint count) {
+    Meshlet meshlet;
+    meshlet.firstIndex = first;
+    meshlet.indexCount = count;
+
+    BoundingBox box;
+    for (GLuint i = first; i < first + count; i++)
+        box.expand(glm::vec3(vertices[indices[i]]));
+
+    meshlet.center = box.getCenter();
+    meshlet.radius = 0.0f;
+    for (GLuint i = first; i < first + count; i++)
+        meshlet.radius = glm::max(meshlet.radius, glm::distance(meshlet.center, glm::vec3(vertices[indices[i]])));
+
+    // The axis is the average of the unit normals, degenerate triangles face nowhere and are skipped
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> corners;
+    glm::vec3 axis(0.0f);
+    for (GLuint i = first; i < first + count; i += 3) {
+        glm::vec3 a = glm::vec3(vertices[indices[i]]);
+        glm::vec3 b = glm::vec3(vertices[indices[i + 1]]);
+        glm::vec3 c = glm::vec3(vertices[indices[i + 2]]);
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        if (glm::length(normal) < 1e-12f)
+            continue;
+
+        normals.push_back(glm::normalize(normal));
+        corners.push_back(a);
+        axis += normals.back();
+    }
+
+    meshlet.coneAxis = glm::vec3(0, 0, 1);
+    meshlet.coneCutoff = 1.0f;
+    meshlet.coneApex = meshlet.center;
+    if (glm::length(axis) < 1e-6f)
+        return meshlet;
+
+    meshlet.coneAxis = glm::normalize(axis);
+    float minDot = 1.0f;
+    for (auto& normal : normals)
+        minDot = glm::min(minDot, glm::dot(meshlet.coneAxis, normal));
+
+    // With normals more than 90 degrees from the axis, some triangle faces every viewer
+    if (minDot <= 0.0f)
+        return meshlet;
+
+    meshlet.coneCutoff = glm::sqrt(1.0f - minDot * minDot);
+
+    // Move the apex back along the axis until it is behind every triangle plane
+    float offset = 0.0f;
+    for (size_t i = 0; i < normals.size(); i++)
+        offset = glm::max(offset, glm::dot(meshlet.center - corners[i], normals[i]) / glm::dot(meshlet.coneAxis, normals[i]));
+    meshlet.coneApex = meshlet.center - meshlet.coneAxis * offset;
+    return meshlet;
+}
+
+}  // namespace
+
+void vr::buildMeshlets(const std::vector<glm::vec4>& vertices, const std::vector<GLuint>& indices, std::vector<Meshlet>& meshlets) {
+    meshlets.clear();
+
+    // The meshlet each vertex was last added to, so shared vertices are only counted once
+    std::vector<int> owner(vertices.size(), -1);
+    GLuint first = 0;
+    int vertexCount = 0;
+
+    for (GLuint i = 0; i + 2 < indices.size(); i += 3) {
+        int id = int(meshlets.size());
+        int added = 0;
+        for (int j = 0; j < 3; j++)
+            added += owner[indices[i + j]] != id;
+
+        if (vertexCount + added > MESHLET_MAX_VERTICES || (i - first) / 3 == MESHLET_MAX_TRIANGLES) {
+            meshlets.push_back(finishMeshlet(vertices, indices, first, i - first));
+            first = i;
+            vertexCount = 0;
+            id++;
+        }
+
+        for (int j = 0; j < 3; j++) {
+            if (owner[indices[i + j]] != id) {
+                owner[indices[i + j]] = id;
+                vertexCount++;
+            }
+        }
+    }
+
+    if (first + 2 < indices.size())
+        meshlets.push_back(finishMeshlet(vertices, indices, first, GLuint(indices.size()) - first));
+}
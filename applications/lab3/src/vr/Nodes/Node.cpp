@@ -0,0 +1,5 @@
+#include <vr/Nodes/Node.h>
+
+using namespace vr;
+
+unsigned int Node::s_graphVersion = 0;
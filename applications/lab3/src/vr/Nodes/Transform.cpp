@@ -1,5 +1,7 @@
 #include <vr/Nodes/Transform.h>
 
+#include <glm/gtc/matrix_inverse.hpp>
+
 using namespace vr;
 
 void Transform::accept(NodeVisitor& visitor) {
@@ -15,11 +17,31 @@ glm::mat4 Transform::getMatrix() {
     return t_matrix;
 }
 
+bool Transform::updateWorldMatrix(const Transform* parent) {
+    unsigned int parentVersion = parent ? parent->getWorldVersion() : 0;
+    if (!isDirty && m_worldVersion != 0 && parent == m_worldParent && parentVersion == m_parentWorldVersion)
+        return false;
+
+    m_worldMatrix = parent ? parent->getWorldMatrix() * t_matrix : t_matrix;
+    m_normalMatrix = glm::inverseTranspose(glm::mat3(m_worldMatrix));
+    m_worldParent = parent;
+    m_parentWorldVersion = parentVersion;
+    m_worldVersion++;
+    return true;
+}
+
 BoundingBox Transform::calculateBoundingBox(glm::mat4 t_mat) {
     // Apply the transform to the bounding box
     BoundingBox bbox;
-    for (auto child : m_children) {
+    for (auto& child : m_children) {
         bbox.expand(child->calculateBoundingBox(t_mat * t_matrix));
     }
+
+    m_bounds = bbox;
+    m_boundsDirty = false;
+
+    if (m_excludeFromBoundingBox)
+        return BoundingBox();
+
     return bbox;
 }
@@ -0,0 +1,258 @@
+#include <vr/Scene/BVH.h>
+
+#include <algorithm>
+
+using namespace vr;
+
+namespace {
+
+float surfaceArea(const BoundingBox& box) {
+    if (!box.isValid())
+        return 0.0f;
+
+    glm::vec3 size = box.max() - box.min();
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+glm::vec3 centroid(const BoundingBox& box) {
+    return box.isValid() ? box.getCenter() : glm::vec3(0.0f);
+}
+
+bool overlaps(const BoundingBox& a, const BoundingBox& b) {
+    return a.isValid() && b.isValid() &&
+           glm::all(glm::lessThanEqual(a.min(), b.max())) && glm::all(glm::lessThanEqual(b.min(), a.max()));
+}
+
+bool overlaps(const BoundingBox& box, const glm::vec3& center, float radius) {
+    if (!box.isValid())
+        return false;
+
+    glm::vec3 delta = glm::clamp(center, box.min(), box.max()) - center;
+    return glm::dot(delta, delta) <= radius * radius;
+}
+
+}  // namespace
+
+BVH::BVH() : m_builtArea(0) {
+    resetStatistics();
+}
+
+void BVH::build(const RenderList& renderList) {
+    const std::vector<RenderItem>& items = renderList.getItems();
+
+    m_nodes.clear();
+    m_indices.resize(items.size());
+    m_itemBounds.resize(items.size());
+    m_itemLeaf.resize(items.size());
+
+    for (size_t i = 0; i < items.size(); i++) {
+        m_indices[i] = i;
+        m_itemBounds[i] = items[i].bounds;
+    }
+
+    if (!items.empty())
+        buildNode(-1, 0, items.size());
+
+    m_builtArea = surfaceArea(getBounds());
+}
+
+int BVH::buildNode(int parent, int first, int last) {
+    int index = m_nodes.size();
+    m_nodes.push_back(BVHNode());
+
+    BoundingBox bounds, centroids;
+    for (int i = first; i < last; i++) {
+        bounds.expand(m_itemBounds[m_indices[i]]);
+        centroids.expand(centroid(m_itemBounds[m_indices[i]]));
+    }
+
+    BVHNode node;
+    node.bounds = bounds;
+    node.parent = parent;
+    node.left = -1;
+    node.right = -1;
+    node.first = first;
+    node.count = last - first;
+    node.dirty = false;
+
+    if (node.count > BVH_MAX_LEAF_ITEMS) {
+        // Split at the median centroid along the longest axis of the centroid bounds
+        glm::vec3 extent = centroids.max() - centroids.min();
+        int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        int middle = (first + last) / 2;
+
+        std::nth_element(m_indices.begin() + first, m_indices.begin() + middle, m_indices.begin() + last,
+                         [this, axis](int a, int b) { return centroid(m_itemBounds[a])[axis] < centroid(m_itemBounds[b])[axis]; });
+
+        node.count = 0;
+        node.left = buildNode(index, first, middle);
+        node.right = buildNode(index, middle, last);
+    } else {
+        for (int i = first; i < last; i++)
+            m_itemLeaf[m_indices[i]] = index;
+    }
+
+    m_nodes[index] = node;
+    return index;
+}
+
+void BVH::refit(const RenderList& renderList) {
+    const std::vector<RenderItem>& items = renderList.getItems();
+    const std::vector<int>& changed = renderList.getChangedItems();
+    if (changed.empty() || m_nodes.empty())
+        return;
+
+    for (int item : changed) {
+        m_itemBounds[item] = items[item].bounds;
+        m_nodes[m_itemLeaf[item]].dirty = true;
+    }
+
+    // Children are always stored after their parent, so a reverse pass refits bottom up
+    for (int i = m_nodes.size() - 1; i >= 0; i--) {
+        BVHNode& node = m_nodes[i];
+        if (!node.dirty)
+            continue;
+
+        BoundingBox bounds;
+        if (node.count > 0) {
+            for (int j = node.first; j < node.first + node.count; j++)
+                bounds.expand(m_itemBounds[m_indices[j]]);
+        } else {
+            bounds.expand(m_nodes[node.left].bounds);
+            bounds.expand(m_nodes[node.right].bounds);
+        }
+
+        node.bounds = bounds;
+        node.dirty = false;
+        if (node.parent >= 0)
+            m_nodes[node.parent].dirty = true;
+    }
+
+    // Refitting keeps the topology, which gets poor when items moved far from where they were built
+    if (surfaceArea(getBounds()) > m_builtArea * BVH_REBUILD_FACTOR)
+        build(renderList);
+}
+
+void BVH::collect(int node, std::vector<int>& result) {
+    const BVHNode& n = m_nodes[node];
+    if (n.count > 0) {
+        result.insert(result.end(), m_indices.begin() + n.first, m_indices.begin() + n.first + n.count);
+    } else {
+        collect(n.left, result);
+        collect(n.right, result);
+    }
+}
+
+void BVH::query(const Frustum& frustum, std::vector<int>& result) {
+    if (m_nodes.empty())
+        return;
+
+    m_stack.clear();
+    m_stack.push_back(0);
+    while (!m_stack.empty()) {
+        int index = m_stack.back();
+        const BVHNode& node = m_nodes[index];
+        m_stack.pop_back();
+
+        m_stats.visited++;
+        Frustum::Result test = frustum.intersect(node.bounds);
+        if (test == Frustum::OUTSIDE) {
+            m_stats.culled++;
+            continue;
+        }
+
+        // Everything below a node that is fully inside is accepted without further tests
+        if (test == Frustum::INSIDE) {
+            collect(index, result);
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                m_stats.visited++;
+                if (frustum.intersect(m_itemBounds[m_indices[i]]) != Frustum::OUTSIDE)
+                    result.push_back(m_indices[i]);
+                else
+                    m_stats.culled++;
+            }
+        } else {
+            m_stack.push_back(node.left);
+            m_stack.push_back(node.right);
+        }
+    }
+}
+
+void BVH::query(const glm::vec3& center, float radius, std::vector<int>& result) {
+    if (m_nodes.empty())
+        return;
+
+    m_stack.clear();
+    m_stack.push_back(0);
+    while (!m_stack.empty()) {
+        const BVHNode& node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+
+        m_stats.visited++;
+        if (!overlaps(node.bounds, center, radius)) {
+            m_stats.culled++;
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                m_stats.visited++;
+                if (overlaps(m_itemBounds[m_indices[i]], center, radius))
+                    result.push_back(m_indices[i]);
+                else
+                    m_stats.culled++;
+            }
+        } else {
+            m_stack.push_back(node.left);
+            m_stack.push_back(node.right);
+        }
+    }
+}
+
+void BVH::query(const BoundingBox& box, std::vector<int>& result) {
+    if (m_nodes.empty())
+        return;
+
+    m_stack.clear();
+    m_stack.push_back(0);
+    while (!m_stack.empty()) {
+        const BVHNode& node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+
+        m_stats.visited++;
+        if (!overlaps(node.bounds, box)) {
+            m_stats.culled++;
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                m_stats.visited++;
+                if (overlaps(m_itemBounds[m_indices[i]], box))
+                    result.push_back(m_indices[i]);
+                else
+                    m_stats.culled++;
+            }
+        } else {
+            m_stack.push_back(node.left);
+            m_stack.push_back(node.right);
+        }
+    }
+}
+
+BoundingBox BVH::getBounds() const {
+    return m_nodes.empty() ? BoundingBox() : m_nodes.front().bounds;
+}
+
+void BVH::resetStatistics() {
+    m_stats.visited = 0;
+    m_stats.culled = 0;
+}
+
+const BVHStats& BVH::getStatistics() const {
+    return m_stats;
+}
@@ -200,7 +200,7 @@ void Camera::setNearFar(const glm::vec2& nearFar) {
     m_nearFar = nearFar;
 }
 
-void Camera::apply(std::shared_ptr<vr::Shader> shader) {
+void Camera::updateMatrices() {
     // Makes camera look in the right direction from the right position
     m_view = glm::lookAt(m_position, m_position + m_direction, m_up);
 
@@ -208,6 +208,14 @@ void Camera::apply(std::shared_ptr<vr::Shader> shader) {
 
     // Adds perspective to the scene
     m_projection = glm::perspective(glm::radians(m_fov), aspect, m_nearFar[0], m_nearFar[1]);
+}
+
+Frustum Camera::getFrustum() const {
+    return Frustum(m_projection * m_view);
+}
+
+void Camera::apply(std::shared_ptr<vr::Shader> shader) {
+    updateMatrices();
 
     shader->setMat4("v", m_view);
     shader->setMat4("p", m_projection);
@@ -215,6 +223,15 @@ void Camera::apply(std::shared_ptr<vr::Shader> shader) {
     // shader->setMat4("v_inv", v_inv); // Not used right now
 }
 
+void Camera::pack(CameraData& data) const {
+    data.view = m_view;
+    data.projection = m_projection;
+    data.viewProjection = m_projection * m_view;
+    data.position = glm::vec4(m_position, 1.0f);
+    data.nearFar = m_nearFar;
+    data.screenSize = glm::vec2(m_screenSize);
+}
+
 void Camera::setFOV(float fov) {
     m_fov = fov;
 }
@@ -0,0 +1,384 @@
+#include <vr/Nodes/Geometry.h>
+#include <vr/Scene/DepthRenderer.h>
+
+#include <iostream>
+
+using namespace vr;
+
+DepthRenderer::DepthRenderer()
+    : depthMapIndex(0), m_textureID(0), m_faces(ALL_CUBE_FACES), m_pointLight(false), m_lightRange(0),
+      m_mode(POINT_SHADOW_GEOMETRY_SHADER), m_benchmarking(true), m_benchmarkFrames(0) {
+    resetStatistics();
+    m_directionalDepthShader = std::make_shared<Shader>("shaders/depth-shader.vs", "shaders/depth-shader.fs");
+    m_lsmUniform = m_directionalDepthShader->uniform("lsm");
+    glGenFramebuffers(1, &fbo);
+
+    loadPointProgram(POINT_SHADOW_GEOMETRY_SHADER, "shaders/point-depth-shader.vs", "shaders/point-depth-shader.gs");
+    loadPointProgram(POINT_SHADOW_PER_FACE, "shaders/point-depth-face-shader.vs");
+    // Writing gl_Layer from a vertex shader is an extension to OpenGL 4.3
+    if (GLAD_GL_ARB_shader_viewport_layer_array || GLAD_GL_AMD_vertex_shader_layer)
+        loadPointProgram(POINT_SHADOW_LAYERED, "shaders/point-depth-layered-shader.vs");
+
+    for (int i = 0; i < POINT_SHADOW_MODES; i++) {
+        m_supported[i] = m_pointPrograms[i].shader && m_pointPrograms[i].shader->valid();
+        m_benchmarkTime[i] = 0;
+        m_benchmarkFaces[i] = 0;
+    }
+
+    // Without timer queries there is nothing to compare, the geometry shader path is kept
+    if (!GLAD_GL_ARB_timer_query)
+        m_benchmarking = false;
+}
+
+DepthRenderer::~DepthRenderer() {
+    for (auto& pending : m_pendingQueries)
+        m_freeQueries.push_back(pending.query);
+    if (!m_freeQueries.empty())
+        glDeleteQueries(GLsizei(m_freeQueries.size()), m_freeQueries.data());
+
+    glDeleteFramebuffers(1, &fbo);
+    m_activeLight = nullptr;
+}
+
+const char* DepthRenderer::modeName(PointShadowMode mode) {
+    switch (mode) {
+        case POINT_SHADOW_GEOMETRY_SHADER:
+            return "geometry shader";
+        case POINT_SHADOW_PER_FACE:
+            return "per face";
+        case POINT_SHADOW_LAYERED:
+            return "layered instancing";
+        default:
+            return "unknown";
+    }
+}
+
+void DepthRenderer::loadPointProgram(PointShadowMode mode, const std::string& vertexPath, const std::string& geometryPath) {
+    PointDepthProgram& program = m_pointPrograms[mode];
+    program.shader = std::make_shared<Shader>(vertexPath, "shaders/point-depth-shader.fs", geometryPath);
+
+    for (int i = 0; i < 6; i++)
+        program.shadowMatrices[i] = program.shader->uniform("shadowMatrices[" + std::to_string(i) + "]");
+    program.shadowMatrix = program.shader->uniform("shadowMatrix");
+    program.farPlane = program.shader->uniform("farPlane");
+    program.lightPos = program.shader->uniform("lightPos");
+    program.depthMapIndex = program.shader->uniform("depthMapIndex");
+    program.faceMask = program.shader->uniform("faceMask");
+    program.faces = program.shader->uniform("faces");
+    program.faceCount = program.shader->uniform("faceCount");
+}
+
+void DepthRenderer::beginFrame() {
+    resetStatistics();
+    if (!m_benchmarking)
+        return;
+
+    collectBenchmark();
+    if (!m_benchmarking)
+        return;
+
+    // The paths take turns frame by frame, so a scene that changes over time is measured alike by all of them
+    for (int i = 1; i <= POINT_SHADOW_MODES; i++) {
+        PointShadowMode mode = PointShadowMode((m_mode + i) % POINT_SHADOW_MODES);
+        if (m_supported[mode] && m_benchmarkFaces[mode] < POINT_SHADOW_BENCHMARK_FACES) {
+            m_mode = mode;
+            break;
+        }
+    }
+}
+
+void DepthRenderer::collectBenchmark() {
+    // Queries finish in the order they were issued, the first one that is not available ends the search
+    size_t done = 0;
+    for (; done < m_pendingQueries.size(); done++) {
+        const PendingQuery& pending = m_pendingQueries[done];
+        GLint available = 0;
+        glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsed);
+        m_benchmarkTime[pending.mode] += elapsed;
+        m_benchmarkFaces[pending.mode] += pending.casterFaces;
+        m_freeQueries.push_back(pending.query);
+    }
+    m_pendingQueries.erase(m_pendingQueries.begin(), m_pendingQueries.begin() + done);
+
+    // Past the frame limit the paths are compared on what they have rendered so far
+    bool timedOut = ++m_benchmarkFrames >= POINT_SHADOW_BENCHMARK_FRAMES;
+    int fastest = -1;
+    for (int i = 0; i < POINT_SHADOW_MODES; i++) {
+        if (!m_supported[i] || m_benchmarkFaces[i] == 0)
+            continue;
+        if (fastest < 0 || benchmarkResult(PointShadowMode(i)) < benchmarkResult(PointShadowMode(fastest)))
+            fastest = i;
+    }
+    for (int i = 0; i < POINT_SHADOW_MODES && !timedOut; i++) {
+        if (m_supported[i] && m_benchmarkFaces[i] < POINT_SHADOW_BENCHMARK_FACES)
+            return;
+    }
+
+    m_benchmarking = false;
+    if (fastest < 0) {
+        m_mode = POINT_SHADOW_GEOMETRY_SHADER;
+        std::cout << "Point shadow maps are rendered with the " << modeName(m_mode)
+                  << " path, no point shadow faces were rendered while benchmarking" << std::endl;
+        return;
+    }
+    m_mode = PointShadowMode(fastest);
+
+    bool first = true;
+    std::cout << "Point shadow maps are rendered with the " << modeName(m_mode) << " path (";
+    for (int i = 0; i < POINT_SHADOW_MODES; i++) {
+        if (!m_supported[i])
+            continue;
+        std::cout << (first ? "" : ", ") << modeName(PointShadowMode(i)) << " ";
+        if (m_benchmarkFaces[i] == 0)
+            std::cout << "not timed";
+        else
+            std::cout << int(benchmarkResult(PointShadowMode(i))) << " ns";
+        first = false;
+    }
+    std::cout << " per caster face)" << std::endl;
+}
+
+double DepthRenderer::benchmarkResult(PointShadowMode mode) const {
+    if (!m_supported[mode] || m_benchmarkFaces[mode] == 0)
+        return -1;
+    return double(m_benchmarkTime[mode]) / m_benchmarkFaces[mode];
+}
+
+void DepthRenderer::setupRenderState(const std::shared_ptr<Light> light, int depthMapIndex, unsigned int textureID, int faces,
+                                     unsigned int resolution) {
+    m_activeLight = light;
+    m_faces = faces;
+
+    glViewport(0, 0, resolution, resolution);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    if (m_activeLight->getPosition().w == 0) {
+        m_depthShader = m_directionalDepthShader;
+        this->depthMapIndex = depthMapIndex;
+        m_textureID = textureID;
+
+        // The layers of the cascades are attached and cleared one at a time while rendering
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textureID, 0, depthMapIndex * SHADOW_CASCADES);
+    } else {
+        m_depthShader = m_pointPrograms[m_mode].shader;
+        this->depthMapIndex = depthMapIndex;
+        m_textureID = textureID;
+
+        // Only the faces that are rendered again are cleared, the others keep their cached depth
+        for (int i = 0; i < 6; i++) {
+            if (faces & (1 << i)) {
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textureID, 0, depthMapIndex * 6 + i);
+                glClear(GL_DEPTH_BUFFER_BIT);
+            }
+        }
+
+        // The layered paths select the layer in a shader, so the whole array is attached while drawing.
+        // Drawing one face at a time attaches each face again before its pass.
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, textureID, 0);
+    }
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Depth renderer framebuffer is not complete" << std::endl;
+        exit(1);
+    }
+
+    // The uniforms of the light are the same for every geometry, so they are only set once
+    m_depthShader->use();
+    m_pointLight = m_activeLight->getPosition().w != 0;
+    if (m_pointLight) {
+        const PointDepthProgram& program = m_pointPrograms[m_mode];
+        for (size_t i = 0; i < 6; i++) {
+            program.shadowMatrices[i].setMat4(m_activeLight->getShadowMatrix(i));
+            m_faceFrusta[i] = Frustum(m_activeLight->getShadowMatrix(i));
+        }
+        m_lightPosition = glm::vec3(m_activeLight->getTransform() * m_activeLight->getPosition());
+        // Nothing beyond the far plane is rendered to the shadow map anyway
+        m_lightRange = glm::min(m_activeLight->getAttenuationRange(), POINT_SHADOW_FAR_PLANE);
+
+        program.farPlane.setFloat(m_activeLight->getFarPlane());
+        program.lightPos.setVec3(m_lightPosition);
+        program.depthMapIndex.setInt(this->depthMapIndex);
+    }
+}
+
+void DepthRenderer::resetStatistics() {
+    m_castersDrawn = 0;
+    m_castersCulled = 0;
+    m_facesDrawn = 0;
+    m_drawCalls = 0;
+    m_indirectCommands = 0;
+    m_meshletCuller.resetStatistics();
+}
+
+int DepthRenderer::faceMask(const BoundingBox& box) const {
+    int mask = 0;
+    for (int i = 0; i < 6; i++) {
+        if (m_faceFrusta[i].intersect(box) != Frustum::OUTSIDE)
+            mask |= 1 << i;
+    }
+    return mask;
+}
+
+void DepthRenderer::render(const RenderList& renderList, BVH& bvh) {
+    if (m_pointLight) {
+        GLuint query = 0;
+        if (m_benchmarking) {
+            if (m_freeQueries.empty()) {
+                glGenQueries(1, &query);
+            } else {
+                query = m_freeQueries.back();
+                m_freeQueries.pop_back();
+            }
+            glBeginQuery(GL_TIME_ELAPSED, query);
+        }
+
+        unsigned int faces = m_facesDrawn;
+        renderCasters(renderList, bvh);
+
+        if (m_benchmarking) {
+            glEndQuery(GL_TIME_ELAPSED);
+            PendingQuery pending = {query, m_mode, m_facesDrawn - faces};
+            m_pendingQueries.push_back(pending);
+        }
+        return;
+    }
+
+    // Every cascade culls its own casters, the closest cascades cover only a small part of the scene
+    for (int i = 0; i < SHADOW_CASCADES; i++) {
+        if ((m_faces & (1 << i)) == 0)
+            continue;
+
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_textureID, 0, depthMapIndex * SHADOW_CASCADES + i);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        glm::mat4 lightSpaceMatrix = m_activeLight->getCascadeMatrix(i);
+        m_lsmUniform.setMat4(lightSpaceMatrix);
+        m_lightFrustum = Frustum(lightSpaceMatrix);
+        m_meshletCuller.begin(lightSpaceMatrix, glm::vec3(0.0f), false);
+        m_batcher.setMeshletCuller(&m_meshletCuller);
+        renderCasters(renderList, bvh);
+    }
+}
+
+void DepthRenderer::renderCasters(const RenderList& renderList, BVH& bvh) {
+    const std::vector<RenderItem>& items = renderList.getItems();
+    const BVHStats stats = bvh.getStatistics();
+
+    // A caster further away than the range of a point light only shadows receivers that are not lit anyway
+    m_casters.clear();
+    if (m_pointLight)
+        bvh.query(m_lightPosition, m_lightRange, m_casters);
+    else
+        bvh.query(m_lightFrustum, m_casters);
+
+    m_castersCulled += bvh.getStatistics().culled - stats.culled;
+
+    if (m_pointLight)
+        m_pointCasters.clear();
+    else
+        m_batcher.begin();
+
+    for (int index : m_casters) {
+        const RenderItem& item = items[index];
+        if (!renderList.isActive(item))
+            continue;
+
+        int mask = 0;
+        if (m_pointLight) {
+            mask = faceMask(item.bounds) & m_faces;
+            if (mask == 0) {
+                m_castersCulled++;
+                continue;
+            }
+
+            for (int i = 0; i < 6; i++)
+                m_facesDrawn += (mask >> i) & 1;
+        }
+
+        m_castersDrawn++;
+        if (m_pointLight)
+            m_pointCasters.push_back(std::make_pair(&item, mask));
+        else
+            m_batcher.add(&item, nullptr);
+    }
+
+    if (m_pointLight) {
+        renderPointCasters();
+        return;
+    }
+
+    m_batcher.end();
+    for (auto& batch : m_batcher.getBatches())
+        m_batcher.draw(batch, m_depthShader, true);
+    m_batcher.flush();
+    m_drawCalls += m_batcher.drawCalls();
+    m_indirectCommands += m_batcher.indirectCommands();
+}
+
+void DepthRenderer::renderPointCasters() {
+    const PointDepthProgram& program = m_pointPrograms[m_mode];
+
+    // The other paths draw several faces at once, so meshlets can only be culled one face at a time
+    m_batcher.setMeshletCuller(m_mode == POINT_SHADOW_PER_FACE ? &m_meshletCuller : nullptr);
+
+    if (m_mode == POINT_SHADOW_PER_FACE) {
+        // Every face is a plain depth pass over the casters that overlap it
+        for (int face = 0; face < 6; face++) {
+            if ((m_faces & (1 << face)) == 0)
+                continue;
+
+            m_batcher.begin();
+            for (auto& caster : m_pointCasters) {
+                if (caster.second & (1 << face))
+                    m_batcher.add(caster.first, nullptr);
+            }
+            if (m_batcher.instances() == 0)
+                continue;
+            m_batcher.end();
+
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_textureID, 0, depthMapIndex * 6 + face);
+            program.shadowMatrix.setMat4(m_activeLight->getShadowMatrix(face));
+            m_meshletCuller.begin(m_activeLight->getShadowMatrix(face), m_lightPosition, false);
+            for (auto& batch : m_batcher.getBatches())
+                m_batcher.draw(batch, m_depthShader, true);
+            m_batcher.flush();
+            m_drawCalls += m_batcher.drawCalls();
+            m_indirectCommands += m_batcher.indirectCommands();
+        }
+        return;
+    }
+
+    // Casters are only batched with casters covering the same faces. The faces are uniforms, so the
+    // indirect draws of every batch are submitted before the next batch sets its faces.
+    m_batcher.begin();
+    for (auto& caster : m_pointCasters)
+        m_batcher.add(caster.first, nullptr, caster.second);
+    m_batcher.end();
+
+    for (auto& batch : m_batcher.getBatches()) {
+        if (m_mode == POINT_SHADOW_LAYERED) {
+            // One instance per face in the mask, the vertex shader looks up its face by the instance id
+            int faces[6];
+            int faceCount = 0;
+            for (int i = 0; i < 6; i++) {
+                if (batch.key & (1 << i))
+                    faces[faceCount++] = i;
+            }
+            program.faces.setIntArray(faces, faceCount);
+            program.faceCount.setInt(faceCount);
+            m_batcher.draw(batch, m_depthShader, true, faceCount);
+            m_batcher.flush();
+        } else {
+            // The geometry shader only emits the triangles to the faces in the mask
+            program.faceMask.setInt(batch.key);
+            m_batcher.draw(batch, m_depthShader, true);
+            m_batcher.flush();
+        }
+    }
+    m_drawCalls += m_batcher.drawCalls();
+    m_indirectCommands += m_batcher.indirectCommands();
+}
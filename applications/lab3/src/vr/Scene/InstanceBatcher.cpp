@@ -0,0 +1,194 @@
+#include <vr/Scene/InstanceBatcher.h>
+#include <vr/glErrorUtil.h>
+
+#include <algorithm>
+
+using namespace vr;
+
+namespace {
+const std::string INDIRECT_UNIFORM = "indirect";
+}  // namespace
+
+InstanceBatcher::InstanceBatcher() : m_buffer(GL_ARRAY_BUFFER, GL_STREAM_DRAW), m_culler(nullptr), m_drawCalls(0), m_pendingRepeat(1),
+                                     m_drawBuffer(GL_SHADER_STORAGE_BUFFER, GL_STREAM_DRAW),
+                                     m_commandBuffer(GL_DRAW_INDIRECT_BUFFER, GL_STREAM_DRAW), m_indirectCommands(0) {
+}
+
+void InstanceBatcher::begin() {
+    m_entries.clear();
+    m_batches.clear();
+    m_drawCalls = 0;
+    m_indirectCommands = 0;
+}
+
+void InstanceBatcher::add(const RenderItem* item, State* state, int key) {
+    Entry entry;
+    entry.item = item;
+    entry.state = state;
+    entry.key = key;
+    m_entries.push_back(entry);
+}
+
+void InstanceBatcher::end() {
+    std::sort(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) {
+        if (a.item->geometry != b.item->geometry)
+            return a.item->geometry < b.item->geometry;
+        if (a.state != b.state)
+            return a.state < b.state;
+        return a.key < b.key;
+    });
+
+    m_instances.resize(m_entries.size());
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        const Entry& entry = m_entries[i];
+        m_instances[i].world = entry.item->world;
+        m_instances[i].normalMatrix = entry.item->normalMatrix;
+
+        if (m_batches.empty() || m_batches.back().geometry != entry.item->geometry ||
+            m_batches.back().state != entry.state || m_batches.back().key != entry.key) {
+            InstanceBatch batch;
+            batch.geometry = entry.item->geometry;
+            batch.state = entry.state;
+            batch.key = entry.key;
+            batch.first = i;
+            batch.count = 0;
+            m_batches.push_back(batch);
+        }
+        m_batches.back().count++;
+    }
+
+    if (!m_instances.empty())
+        m_buffer.upload(m_instances.data(), m_instances.size() * sizeof(InstanceData));
+}
+
+void InstanceBatcher::draw(const InstanceBatch& batch, const std::shared_ptr<Shader>& shader, bool depth, GLuint repeat,
+                           GLint materialIndex) {
+    if (batch.geometry->inArena() && shader->supportsIndirect()) {
+        queue(batch, shader, repeat, materialIndex);
+        return;
+    }
+
+    if ((batch.count > 1 || repeat > 1) && shader->supportsInstancing()) {
+        batch.geometry->drawInstanced(shader, m_buffer, batch.first * sizeof(InstanceData), batch.count, repeat);
+        m_drawCalls++;
+        return;
+    }
+
+    for (int i = batch.first; i < batch.first + batch.count; i++) {
+        const RenderItem* item = m_entries[i].item;
+
+        // Items whose meshlets are all culled are not drawn at all
+        const MeshletCuller* meshlets = nullptr;
+        if (m_culler && !item->geometry->getMeshlets().empty()) {
+            bool backFacesCulled = batch.state && batch.state->CullFaceEnabled();
+            if (!m_culler->cull(item->geometry->getMeshlets(), item->world, item->geometry->getIndexSize(), backFacesCulled))
+                continue;
+            meshlets = m_culler;
+        }
+
+        if (depth)
+            item->geometry->drawDepth(shader, item->world, meshlets);
+        else
+            item->geometry->draw(shader, item->world, item->normalMatrix, meshlets);
+        m_drawCalls++;
+    }
+}
+
+void InstanceBatcher::queue(const InstanceBatch& batch, const std::shared_ptr<Shader>& shader, GLuint repeat, GLint materialIndex) {
+    // The program and the divisor of the draw index are set once per submission
+    if (!m_pending.empty() && (shader != m_pendingShader || repeat != m_pendingRepeat))
+        flush();
+    m_pendingShader = shader;
+    m_pendingRepeat = repeat;
+
+    Geometry* geometry = batch.geometry;
+    const ArenaRange& range = geometry->getArenaRange();
+    const BoundingBox& bounds = geometry->getLocalBounds();
+
+    DrawData data;
+    data.positionOffset = bounds.min();
+    data.positionScale = bounds.max() - bounds.min();
+    data.materialIndex = materialIndex;
+    data.padding = 0;
+
+    PendingCommand pending;
+    pending.block = range.block;
+    pending.command.count = range.indexCount;
+    pending.command.instanceCount = batch.count * repeat;
+    pending.command.firstIndex = range.firstIndex;
+    pending.command.baseVertex = GLint(range.firstVertex);
+    pending.command.baseInstance = GLuint(m_draws.size());
+
+    // Commands are cheap, so every item culls its own meshlets and gets a command per visible range
+    bool cullMeshlets = m_culler && repeat == 1 && !geometry->getMeshlets().empty();
+    bool backFacesCulled = batch.state && batch.state->CullFaceEnabled();
+    if (!cullMeshlets)
+        m_pending.push_back(pending);
+
+    for (int i = batch.first; i < batch.first + batch.count; i++) {
+        const RenderItem* item = m_entries[i].item;
+
+        if (cullMeshlets) {
+            if (!m_culler->cull(geometry->getMeshlets(), item->world, geometry->getIndexSize(), backFacesCulled))
+                continue;
+
+            pending.command.instanceCount = 1;
+            pending.command.baseInstance = GLuint(m_draws.size());
+            for (size_t j = 0; j < m_culler->counts().size(); j++) {
+                pending.command.count = GLuint(m_culler->counts()[j]);
+                pending.command.firstIndex = range.firstIndex + GLuint(size_t(m_culler->offsets()[j]) / geometry->getIndexSize());
+                m_pending.push_back(pending);
+            }
+        }
+
+        data.world = item->world;
+        for (int j = 0; j < 3; j++)
+            data.normalMatrix[j] = glm::vec4(item->normalMatrix[j], 0.0f);
+        m_draws.push_back(data);
+    }
+}
+
+void InstanceBatcher::flush() {
+    if (m_pending.empty()) {
+        m_draws.clear();
+        return;
+    }
+
+    // Commands of the same block are submitted together, the draw data they refer to stays where it is
+    std::stable_sort(m_pending.begin(), m_pending.end(), [](const PendingCommand& a, const PendingCommand& b) { return a.block < b.block; });
+    m_commands.resize(m_pending.size());
+    for (size_t i = 0; i < m_pending.size(); i++)
+        m_commands[i] = m_pending[i].command;
+
+    m_drawBuffer.upload(m_draws.data(), m_draws.size() * sizeof(DrawData));
+    m_drawBuffer.bindBase(DRAW_BUFFER_BINDING);
+    m_commandBuffer.upload(m_commands.data(), m_commands.size() * sizeof(DrawElementsIndirectCommand));
+
+    GeometryArena& arena = GeometryArena::instance();
+    arena.reserveDrawIndices(m_draws.size());
+    m_pendingShader->setBool(INDIRECT_UNIFORM, true);
+
+    size_t first = 0;
+    while (first < m_pending.size()) {
+        size_t last = first;
+        while (last < m_pending.size() && m_pending[last].block == m_pending[first].block)
+            last++;
+
+        arena.bind(m_pending[first].block);
+        glVertexAttribDivisor(DRAW_INDEX_LOCATION, m_pendingRepeat);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, arena.indexType(m_pending[first].block), (const void*)(first * sizeof(DrawElementsIndirectCommand)),
+                                    GLsizei(last - first), 0);
+        m_drawCalls++;
+        first = last;
+    }
+    CHECK_GL_ERROR_LINE_FILE();
+
+    glBindVertexArray(0);
+    m_commandBuffer.unbind();
+    m_pendingShader->setBool(INDIRECT_UNIFORM, false);
+
+    m_indirectCommands += m_pending.size();
+    m_pending.clear();
+    m_draws.clear();
+    m_pendingShader = nullptr;
+}
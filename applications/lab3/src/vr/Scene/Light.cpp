@@ -1,14 +1,16 @@
+#include <vr/Scene/Camera.h>
 #include <vr/Scene/Light.h>
 #include <vr/glErrorUtil.h>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <limits>
 #include <sstream>
 
 using namespace vr;
 
-Light::Light(glm::vec4 position, glm::vec4 ambient, glm::vec4 diffuse, glm::vec4 specular) : enabled(true) {
+Light::Light(glm::vec4 position, glm::vec4 ambient, glm::vec4 diffuse, glm::vec4 specular) : enabled(true), m_shadowFilter(SHADOW_FILTER_PCF), m_shadowPriority(1.0f), m_version(0), m_cascadeVersion(0) {
     this->position = position;
     this->ambient = ambient;
     this->diffuse = diffuse;
@@ -18,6 +20,17 @@ Light::Light(glm::vec4 position, glm::vec4 ambient, glm::vec4 diffuse, glm::vec4
     this->constant = 1.0f;
     this->linear = 0.22f;
     this->quadratic = 0.20f;
+
+    m_sceneRadius = 0.0f;
+    m_sceneCenter = glm::vec3(0.0f);
+    m_farPlane = 0.0f;
+    m_projection = glm::mat4(1.0f);
+    m_view = glm::mat4(1.0f);
+
+    for (int i = 0; i < SHADOW_CASCADES; i++) {
+        m_cascadeMatrices[i] = glm::mat4(1.0f);
+        m_cascadeSplits[i] = 0.0f;
+    }
 }
 
 void Light::init(BoundingBox sceneBounds, float groundRadius) {
@@ -40,7 +53,7 @@ void Light::updateShadowMatrices() {
         m_projection = proj;
     } else {
         float aspect = (float)DEPTH_MAP_RESOLUTION / (float)DEPTH_MAP_RESOLUTION;
-        glm::mat4 proj = glm::perspective(glm::radians(90.0f), aspect, 1.0f, 100.0f);
+        glm::mat4 proj = glm::perspective(glm::radians(90.0f), aspect, POINT_SHADOW_NEAR_PLANE, POINT_SHADOW_FAR_PLANE);
         m_shadowMatrices.clear();
         m_shadowMatrices.push_back(proj * glm::lookAt(glm::vec3(world_position), glm::vec3(world_position) + glm::vec3(1.0, 0.0, 0.0), glm::vec3(0.0, -1.0, 0.0)));
         m_shadowMatrices.push_back(proj * glm::lookAt(glm::vec3(world_position), glm::vec3(world_position) + glm::vec3(-1.0, 0.0, 0.0), glm::vec3(0.0, -1.0, 0.0)));
@@ -51,17 +64,115 @@ void Light::updateShadowMatrices() {
 
         m_projection = proj;
     }
+    m_version++;
+}
+
+void Light::updateCascades(const Camera& camera) {
+    if (position.w != 0)
+        return;
+
+    glm::vec3 lightDir = glm::normalize(glm::vec3(m_model * position));
+    glm::vec3 up = glm::abs(lightDir.y) < 0.999 ? glm::vec3(0.0, 1.0, 0.0) : glm::vec3(1.0, 0.0, 0.0);
+    // Only rotates, so a translation of the camera moves the cascades in whole texels
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), -lightDir, up);
+
+    // Nothing beyond the far side of the scene receives a shadow
+    float reach = glm::max(m_sceneRadius, m_farPlane);
+    float nearPlane = camera.getNear();
+    float farPlane = glm::clamp(glm::distance(camera.getPosition(), m_sceneCenter) + reach, nearPlane * 2.0f, camera.getFar());
+
+    // Corners of the view frustum at the camera near and far planes, in world space
+    glm::mat4 inverseViewProjection = glm::inverse(camera.getProjection() * camera.getView());
+    glm::vec3 nearCorners[4];
+    glm::vec3 farCorners[4];
+    for (int i = 0; i < 4; i++) {
+        glm::vec2 ndc(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f);
+        glm::vec4 nearCorner = inverseViewProjection * glm::vec4(ndc, -1.0f, 1.0f);
+        glm::vec4 farCorner = inverseViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+        nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+        farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+    }
+
+    // The casters between the light and a cascade are inside the depth range of the scene
+    float sceneDepth = (lightView * glm::vec4(m_sceneCenter, 1.0f)).z;
+
+    bool changed = false;
+    float sliceNear = nearPlane;
+    for (int i = 0; i < SHADOW_CASCADES; i++) {
+        // Practical split scheme, a blend of logarithmic and uniform splits
+        float p = float(i + 1) / SHADOW_CASCADES;
+        float logSplit = nearPlane * glm::pow(farPlane / nearPlane, p);
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+        float sliceFar = CASCADE_SPLIT_LAMBDA * logSplit + (1.0f - CASCADE_SPLIT_LAMBDA) * uniformSplit;
+
+        // Points at view depth d lie at (d - near) / (far - near) along the rays through the corners
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int c = 0; c < 4; c++) {
+            float range = camera.getFar() - nearPlane;
+            corners[c] = glm::mix(nearCorners[c], farCorners[c], (sliceNear - nearPlane) / range);
+            corners[c + 4] = glm::mix(nearCorners[c], farCorners[c], (sliceFar - nearPlane) / range);
+            center += corners[c] + corners[c + 4];
+        }
+        center /= 8.0f;
+
+        // A bounding sphere keeps the size of the cascade constant when the camera rotates
+        float radius = 0.0f;
+        for (int c = 0; c < 8; c++)
+            radius = glm::max(radius, glm::distance(center, corners[c]));
+        radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+        // Snap the center to whole texels to avoid shimmering edges when the camera moves
+        float texelSize = 2.0f * radius / DEPTH_MAP_RESOLUTION;
+        glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+        lightCenter.x = glm::floor(lightCenter.x / texelSize) * texelSize;
+        lightCenter.y = glm::floor(lightCenter.y / texelSize) * texelSize;
+
+        // The view looks down -z, so the near and far planes are the negated depths
+        float maxDepth = glm::max(sceneDepth + reach, lightCenter.z + radius);
+        float minDepth = glm::min(sceneDepth - reach, lightCenter.z - radius);
+        glm::mat4 projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius,
+                                          lightCenter.y + radius, -maxDepth, -minDepth);
+
+        glm::mat4 matrix = projection * lightView;
+        if (matrix != m_cascadeMatrices[i] || sliceFar != m_cascadeSplits[i]) {
+            m_cascadeMatrices[i] = matrix;
+            m_cascadeSplits[i] = sliceFar;
+            changed = true;
+        }
+        sliceNear = sliceFar;
+    }
+
+    if (changed)
+        m_cascadeVersion++;
 }
 
 void Light::setShadowParams(float sceneRadius, glm::vec3 sceneCenter, float farPlane) {
+    farPlane = farPlane == 0.0f ? 2 * sceneRadius : farPlane;
+
+    // Unchanged parameters keep the version, so the cached shadow map stays valid
+    if (sceneRadius == m_sceneRadius && sceneCenter == m_sceneCenter && farPlane == m_farPlane)
+        return;
+
     m_sceneRadius = sceneRadius;
     m_sceneCenter = sceneCenter;
-    m_farPlane = farPlane == 0.0f ? 2 * m_sceneRadius : farPlane;
+    m_farPlane = farPlane;
     updateShadowMatrices();
 }
 
 void Light::setEnabled(bool enabled) {
     this->enabled = enabled;
+    m_version++;
+}
+
+void Light::setShadowFilter(ShadowFilter filter) {
+    if (filter == SHADOW_FILTER_ESM && position.w != 0) {
+        std::cerr << "Exponential shadow maps are only supported for directional lights, using PCF" << std::endl;
+        filter = SHADOW_FILTER_PCF;
+    }
+
+    m_shadowFilter = filter;
+    m_version++;
 }
 
 void Light::setPosition(glm::vec4 position) {
@@ -78,50 +189,67 @@ void Light::setTransform(glm::mat4 model) {
 
 void Light::setAmbient(glm::vec4 ambient) {
     this->ambient = ambient;
+    m_version++;
 }
 
 void Light::setDiffuse(glm::vec4 diffuse) {
     this->diffuse = diffuse;
+    m_version++;
 }
 
 void Light::setSpecular(glm::vec4 specular) {
     this->specular = specular;
+    m_version++;
 }
 
 void Light::setAttenuation(float constant, float linear, float quadratic) {
     this->constant = constant;
     this->linear = linear;
     this->quadratic = quadratic;
+    m_version++;
 }
 
-void Light::toggleEnabled() {
-    enabled = !enabled;
+float Light::getIntensity() const {
+    // The lighting shader doubles the diffuse term
+    return glm::max(2.0f * glm::max(diffuse.r, glm::max(diffuse.g, diffuse.b)), glm::max(specular.r, glm::max(specular.g, specular.b)));
 }
 
-void Light::apply(std::shared_ptr<vr::Shader> shader, size_t idx, bool shadowsEnabled) {
-    std::string prefix = constructPrefix("lights", idx, ".");
-    glm::vec4 world_position = m_model * position;
+float Light::getAttenuationRange() const {
+    float intensity = getIntensity();
 
-    std::string uniform_name = prefix + "enabled";
-    shader->setInt(uniform_name, enabled);
-    shader->setVec4(prefix + "ambient", this->ambient);
-    shader->setVec4(prefix + "diffuse", this->diffuse);
-    shader->setVec4(prefix + "specular", this->specular);
-    shader->setVec4(prefix + "position", world_position);
+    // Solve intensity / (1 + constant + linear * d + quadratic * d^2) = LIGHT_CUTOFF for d
+    float c = 1.0f + constant - intensity / LIGHT_CUTOFF;
+    if (c >= 0.0f)
+        return 0.0f;
+    if (quadratic > 0.0f)
+        return (-linear + glm::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+    if (linear > 0.0f)
+        return -c / linear;
 
-    if (shadowsEnabled) {
-        shader->setMat4(prefix + "lightSpaceMatrix", m_projection * m_view);
-    }
+    // Without distance attenuation the light is as bright everywhere
+    return std::numeric_limits<float>::infinity();
+}
 
-    if (position.w != 0) {
-        shader->setFloat(prefix + "constant", this->constant);
-        shader->setFloat(prefix + "linear", this->linear);
-        shader->setFloat(prefix + "quadratic", this->quadratic);
-        shader->setFloat(prefix + "farPlane", this->m_farPlane);
-    }
-    CHECK_GL_ERROR_LINE_FILE();
+void Light::toggleEnabled() {
+    enabled = !enabled;
+    m_version++;
 }
 
-std::string Light::constructPrefix(const std::string& prefix, size_t idx, const std::string& suffix) {
-    return prefix + "[" + std::to_string(idx) + "]" + suffix;
+void Light::pack(LightData& data, int shadowMapIndex, int shadowTier) const {
+    data.position = m_model * position;
+    data.ambient = ambient;
+    data.diffuse = diffuse;
+    data.specular = specular;
+    for (int i = 0; i < SHADOW_CASCADES; i++) {
+        data.cascadeMatrices[i] = m_cascadeMatrices[i];
+        data.cascadeSplits[i] = m_cascadeSplits[i];
+    }
+    data.constant = constant;
+    data.linear = linear;
+    data.quadratic = quadratic;
+    data.farPlane = m_farPlane;
+    data.enabled = enabled;
+    data.shadowMapIndex = shadowMapIndex;
+    data.shadowTier = shadowTier;
+    data.shadowFilter = m_shadowFilter;
 }
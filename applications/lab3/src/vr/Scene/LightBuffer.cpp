@@ -0,0 +1,64 @@
+#include <vr/Scene/LightBuffer.h>
+
+#include <algorithm>
+
+using namespace vr;
+
+LightBuffer::LightBuffer() : m_buffer(GL_SHADER_STORAGE_BUFFER), m_directionalCount(0), m_uploaded(0) {
+}
+
+void LightBuffer::update(const LightVector& lights, const ShadowAtlas& atlas) {
+    // Adding or removing lights changes the size of the buffer, so all lights are uploaded again
+    bool resized = lights.size() != m_data.size();
+    if (resized) {
+        m_data.resize(lights.size());
+        m_entries.resize(lights.size());
+    }
+
+    int directionalLightIndex = 0;
+    size_t firstChanged = lights.size();
+    size_t lastChanged = 0;
+    m_uploaded = 0;
+
+    for (size_t i = 0; i < lights.size(); i++) {
+        Light* light = lights[i].get();
+        int shadowMapIndex = 0;
+        int shadowTier = 0;
+        if (light->getPosition().w == 0) {
+            shadowMapIndex = directionalLightIndex++;
+        } else {
+            ShadowAllocation allocation = atlas.getAllocation(i);
+            shadowMapIndex = allocation.slot;
+            shadowTier = allocation.tier;
+        }
+
+        Entry& entry = m_entries[i];
+        if (!resized && entry.light == light && entry.version == light->version() &&
+            entry.cascadeVersion == light->cascadeVersion() && entry.shadowMapIndex == shadowMapIndex &&
+            entry.shadowTier == shadowTier)
+            continue;
+
+        light->pack(m_data[i], shadowMapIndex, shadowTier);
+        entry.light = light;
+        entry.version = light->version();
+        entry.cascadeVersion = light->cascadeVersion();
+        entry.shadowMapIndex = shadowMapIndex;
+        entry.shadowTier = shadowTier;
+
+        firstChanged = std::min(firstChanged, i);
+        lastChanged = i;
+        m_uploaded++;
+    }
+    m_directionalCount = directionalLightIndex;
+
+    if (resized) {
+        m_buffer.upload(m_data.data(), m_data.size() * sizeof(LightData));
+    } else if (m_uploaded > 0) {
+        // One write covering the changed lights, usually only one light moves at a time
+        m_buffer.update(firstChanged * sizeof(LightData), &m_data[firstChanged], (lastChanged - firstChanged + 1) * sizeof(LightData));
+    }
+}
+
+void LightBuffer::apply() const {
+    m_buffer.bindBase(LIGHT_BUFFER_BINDING);
+}
@@ -0,0 +1,159 @@
+#include <vr/Scene/LightClusters.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace vr;
+
+LightClusters::LightClusters()
+    : m_projection(0.0f), m_near(0), m_far(0), m_directionalCount(0), m_clusterBuffer(GL_SHADER_STORAGE_BUFFER), m_lightIndexBuffer(GL_SHADER_STORAGE_BUFFER) {
+    m_stats = ClusterStats();
+    m_clusters.resize(CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z);
+}
+
+int LightClusters::sliceOf(float depth) const {
+    // Slices grow exponentially, so clusters far away are not much longer than they are wide
+    int slice = int(glm::log(depth / m_near) / glm::log(m_far / m_near) * CLUSTER_GRID_Z);
+    return glm::clamp(slice, 0, CLUSTER_GRID_Z - 1);
+}
+
+void LightClusters::updateClusterBounds(const glm::mat4& projection, float nearPlane, float farPlane) {
+    m_projection = projection;
+    m_near = nearPlane;
+    m_far = farPlane;
+
+    glm::mat4 inverseProjection = glm::inverse(projection);
+    m_clusterBounds.resize(m_clusters.size());
+
+    for (int z = 0; z < CLUSTER_GRID_Z; z++) {
+        float sliceNear = m_near * glm::pow(m_far / m_near, float(z) / CLUSTER_GRID_Z);
+        float sliceFar = m_near * glm::pow(m_far / m_near, float(z + 1) / CLUSTER_GRID_Z);
+
+        for (int y = 0; y < CLUSTER_GRID_Y; y++) {
+            for (int x = 0; x < CLUSTER_GRID_X; x++) {
+                BoundingBox bounds;
+                for (int corner = 0; corner < 4; corner++) {
+                    glm::vec2 ndc(float(x + (corner & 1)) / CLUSTER_GRID_X * 2.0f - 1.0f,
+                                  float(y + (corner >> 1)) / CLUSTER_GRID_Y * 2.0f - 1.0f);
+
+                    // Point of the tile corner on the near plane, the corner ray passes through it
+                    glm::vec4 point = inverseProjection * glm::vec4(ndc, -1.0f, 1.0f);
+                    glm::vec3 ray = glm::vec3(point) / point.w;
+
+                    bounds.expand(ray * (sliceNear / -ray.z));
+                    bounds.expand(ray * (sliceFar / -ray.z));
+                }
+                m_clusterBounds[x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z)] = bounds;
+            }
+        }
+    }
+}
+
+void LightClusters::build(const LightVector& lights, const Camera& camera) {
+    glm::mat4 projection = camera.getProjection();
+    if (projection != m_projection || camera.getNear() != m_near || camera.getFar() != m_far)
+        updateClusterBounds(projection, camera.getNear(), camera.getFar());
+
+    glm::mat4 view = camera.getView();
+    m_stats = ClusterStats();
+    m_pairs.clear();
+    m_lightIndices.clear();
+
+    for (uint32_t i = 0; i < lights.size(); i++) {
+        const std::shared_ptr<Light>& light = lights[i];
+        if (!light->isEnabled())
+            continue;
+
+        // Directional lights reach every cluster
+        if (light->getPosition().w == 0) {
+            m_lightIndices.push_back(i);
+            continue;
+        }
+
+        // A light that never fades out is evaluated in every cluster, like a directional light is
+        float range = light->getAttenuationRange();
+        if (std::isinf(range)) {
+            for (uint32_t cluster = 0; cluster < m_clusters.size(); cluster++)
+                m_pairs.push_back(std::make_pair(cluster, i));
+            m_stats.lights++;
+            continue;
+        }
+
+        glm::vec3 center = glm::vec3(view * light->getTransform() * light->getPosition());
+        float depthNear = -center.z - range;
+        float depthFar = -center.z + range;
+        if (range <= 0.0f || depthFar < m_near || depthNear > m_far)
+            continue;
+
+        // Clusters covered by the screen space bounds of the sphere, all tiles if it reaches the near plane
+        int minX = 0, maxX = CLUSTER_GRID_X - 1;
+        int minY = 0, maxY = CLUSTER_GRID_Y - 1;
+        if (depthNear > m_near) {
+            glm::vec2 ndcMin(1.0f), ndcMax(-1.0f);
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec3 offset((corner & 1) ? range : -range, (corner & 2) ? range : -range, (corner & 4) ? range : -range);
+                glm::vec4 clip = projection * glm::vec4(center + offset, 1.0f);
+                glm::vec2 ndc = glm::vec2(clip) / clip.w;
+                ndcMin = glm::min(ndcMin, ndc);
+                ndcMax = glm::max(ndcMax, ndc);
+            }
+            minX = glm::clamp(int((ndcMin.x * 0.5f + 0.5f) * CLUSTER_GRID_X), 0, CLUSTER_GRID_X - 1);
+            maxX = glm::clamp(int((ndcMax.x * 0.5f + 0.5f) * CLUSTER_GRID_X), 0, CLUSTER_GRID_X - 1);
+            minY = glm::clamp(int((ndcMin.y * 0.5f + 0.5f) * CLUSTER_GRID_Y), 0, CLUSTER_GRID_Y - 1);
+            maxY = glm::clamp(int((ndcMax.y * 0.5f + 0.5f) * CLUSTER_GRID_Y), 0, CLUSTER_GRID_Y - 1);
+        }
+        int minZ = sliceOf(glm::max(depthNear, m_near));
+        int maxZ = sliceOf(glm::min(depthFar, m_far));
+
+        bool assigned = false;
+        for (int z = minZ; z <= maxZ; z++) {
+            for (int y = minY; y <= maxY; y++) {
+                for (int x = minX; x <= maxX; x++) {
+                    uint32_t cluster = x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z);
+                    const BoundingBox& bounds = m_clusterBounds[cluster];
+
+                    // Sphere against the view space bounds of the cluster
+                    glm::vec3 closest = glm::clamp(center, bounds.min(), bounds.max());
+                    glm::vec3 delta = center - closest;
+                    if (glm::dot(delta, delta) > range * range)
+                        continue;
+
+                    m_pairs.push_back(std::make_pair(cluster, i));
+                    assigned = true;
+                }
+            }
+        }
+        m_stats.lights += assigned;
+    }
+    m_directionalCount = m_lightIndices.size();
+
+    // Pairs are sorted by cluster, so the lights of a cluster end up next to each other in the list
+    std::sort(m_pairs.begin(), m_pairs.end());
+
+    size_t pair = 0;
+    for (uint32_t cluster = 0; cluster < m_clusters.size(); cluster++) {
+        uint32_t offset = m_lightIndices.size();
+        while (pair < m_pairs.size() && m_pairs[pair].first == cluster) {
+            m_lightIndices.push_back(m_pairs[pair].second);
+            pair++;
+        }
+        m_clusters[cluster] = glm::uvec2(offset, m_lightIndices.size() - offset);
+        m_stats.maxPerCluster = std::max(m_stats.maxPerCluster, m_clusters[cluster].y);
+    }
+    m_stats.assignments = m_pairs.size();
+
+    // An empty buffer can not be bound, the list always holds at least one entry
+    if (m_lightIndices.empty())
+        m_lightIndices.push_back(0);
+
+    m_clusterBuffer.upload(m_clusters.data(), m_clusters.size() * sizeof(glm::uvec2));
+    m_lightIndexBuffer.upload(m_lightIndices.data(), m_lightIndices.size() * sizeof(uint32_t));
+}
+
+void LightClusters::apply(const std::shared_ptr<Shader>& shader) const {
+    m_clusterBuffer.bindBase(CLUSTER_BUFFER_BINDING);
+    m_lightIndexBuffer.bindBase(CLUSTER_LIGHT_BUFFER_BINDING);
+
+    shader->setInt("numDirectionalLights", m_directionalCount);
+    shader->setVec3("clusterGrid", glm::vec3(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z));
+}
@@ -11,7 +11,9 @@
 #include <vr/Nodes/LodNode.h>
 #include <vr/Nodes/Transform.h>
 #include <vr/Scene/Loader.h>
+#include <vr/Scene/MeshOptimizer.h>
 #include <vr/Scene/Scene.h>
+#include <vr/Scene/StaticBatcher.h>
 #include <vr/State/Material.h>
 #include <vr/State/Shader.h>
 #include <vr/State/Texture.h>
@@ -241,7 +243,7 @@ glm::mat4 assimpToGlmMatrix(const aiMatrix4x4& ai_matrix) {
     return glm_matrix;
 }
 
-void parseNodes(aiNode* root_node, MaterialVector& materials, std::stack<glm::mat4>& transformStack, std::shared_ptr<Group>& node, const aiScene* aiScene, const std::shared_ptr<Shader>& shader) {
+void parseNodes(aiNode* root_node, MaterialVector& materials, std::stack<glm::mat4>& transformStack, std::shared_ptr<Group>& node, const aiScene* aiScene, const std::shared_ptr<Shader>& shader, MeshOptimizer& optimizer) {
     glm::mat4 transform = assimpToGlmMatrix(root_node->mTransformation);
 
     glm::mat4 m = transformStack.top() * transform;
@@ -299,6 +301,11 @@ void parseNodes(aiNode* root_node, MaterialVector& materials, std::stack<glm::ma
                 elements.push_back(face.mIndices[k]);
             }
         }
+
+        // Faces come in file order, reorder them for the vertex cache, overdraw and vertex fetch
+        if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+            optimizer.optimize(vertices, normals, texCoords, tangents, bitangents, elements);
+
         std::shared_ptr<Geometry> loadedMesh(new Geometry(vertices, normals, texCoords, tangents, bitangents, elements, mesh->mName.C_Str()));
         loadedMesh->setInitialTransform(transformStack.top());
         loadedMesh->initShader(shader);
@@ -313,7 +320,7 @@ void parseNodes(aiNode* root_node, MaterialVector& materials, std::stack<glm::ma
     }
 
     for (uint32_t i = 0; i < root_node->mNumChildren; i++) {
-        parseNodes(root_node->mChildren[i], materials, transformStack, node, aiScene, shader);
+        parseNodes(root_node->mChildren[i], materials, transformStack, node, aiScene, shader, optimizer);
     }
     transformStack.pop();
 }
@@ -344,7 +351,14 @@ bool vr::load3DModelFile(const std::string& filename, std::shared_ptr<Group>& no
                                                        aiProcess_SortByPType);
         aiNode* root_node = aiScene->mRootNode;
         ExtractMaterials(aiScene, materials, filename);
-        parseNodes(root_node, materials, transformStack, node, aiScene, shader);
+
+        MeshOptimizer optimizer;
+        parseNodes(root_node, materials, transformStack, node, aiScene, shader, optimizer);
+
+        const MeshOptimizerStats& stats = optimizer.getStatistics();
+        if (stats.triangles > 0)
+            std::cout << filename << ": " << stats.triangles << " triangles, ACMR " << stats.acmrBefore() << " -> " << stats.acmrAfter()
+                      << ", ATVR " << stats.atvrBefore() << " -> " << stats.atvrAfter() << std::endl;
         if (geometryMap != nullptr)
             geometryMap->insert(std::make_pair(filepath, node));
     }
@@ -644,11 +658,10 @@ LodNode parseLodNode(std::vector<std::string> xmlpath, rapidxml::xml_node<>* lod
         if (filepath.empty())
             throw std::runtime_error("Node (" + name + ") No filepath specified for Geometry: " + pathToString(xmlpath));
 
-        // Check if we have a geometry with the filepath already in the map
+        // Files already in the map share their geometries, but every level gets a group of its own, like other
+        // references to the file, since a group caches the bounds of one place in the scene
         std::shared_ptr<Group> geometryGroup = std::make_shared<Group>(filepath);
-        if (geometryMap.find(filepath) != geometryMap.end()) {
-            lodNode.addChild(distance, geometryMap[filepath]);
-        } else if (load3DModelFile(filepath, geometryGroup, shader, &geometryMap)) {
+        if (load3DModelFile(filepath, geometryGroup, shader, &geometryMap)) {
             lodNode.addChild(distance, geometryGroup);
         } else {
             throw std::runtime_error("Node (" + name + ") Invalid file in: " + pathToString(xmlpath));
@@ -760,6 +773,15 @@ void parseSceneNode(std::vector<std::string> xmlpath, rapidxml::xml_node<>* node
                 groupNode->setState(state);
             node->addChild(groupNode);
 
+            // Groups that never move can have their geometries merged into a few large draws
+            std::string isStatic = getAttribute(child, "static");
+            if (!isStatic.empty() && readValue<bool>(isStatic)) {
+                StaticBatcher batcher;
+                batcher.batch(groupNode, newShader);
+                std::cout << "Static group " << groupNode->getName() << ": " << batcher.getStatistics().geometries
+                          << " geometries merged into " << batcher.getStatistics().batches << " batches" << std::endl;
+            }
+
             rapidxml::xml_node<>* callbacksNode = child->first_node("Callbacks");
             if (callbacksNode) {
                 xmlpath.push_back(callbacksNode->name());
@@ -829,6 +851,16 @@ void parseSceneNode(std::vector<std::string> xmlpath, rapidxml::xml_node<>* node
                 throw std::runtime_error("Node (" + name + ") Invalid file in: " + pathToString(xmlpath));
             }
 
+            // Large meshes can be culled in parts, the meshlets are shared by every use of the file
+            std::string meshlets = getAttribute(child, "meshlets");
+            if (!meshlets.empty() && readValue<bool>(meshlets)) {
+                for (auto& geometryNode : geometryGroup->getChildren()) {
+                    std::shared_ptr<Geometry> geometry = std::dynamic_pointer_cast<Geometry>(geometryNode);
+                    if (geometry && geometry->getMeshlets().empty())
+                        geometry->setMeshlets(true);
+                }
+            }
+
             rapidxml::xml_node<>* callbacksNode = child->first_node("Callbacks");
             if (callbacksNode) {
                 xmlpath.push_back(callbacksNode->name());
@@ -888,6 +920,18 @@ void parseSceneNode(std::vector<std::string> xmlpath, rapidxml::xml_node<>* node
                 light->setAttenuation(readValue<float>(constant), readValue<float>(linear), readValue<float>(quadratic));
             }
 
+            // "pcf" (default) or "esm", the prefiltered exponential shadow map of directional lights
+            std::string shadowFilter = getAttribute(child, "shadowFilter");
+            if (shadowFilter == "esm")
+                light->setShadowFilter(Light::SHADOW_FILTER_ESM);
+            else if (!shadowFilter.empty() && shadowFilter != "pcf")
+                throw std::runtime_error("Node (" + name + ") Invalid shadowFilter in: " + pathToString(xmlpath));
+
+            // Preference of the light when the shadow maps are handed out, 0 for a light that never casts shadows
+            std::string shadowPriority = getAttribute(child, "shadowPriority");
+            if (!shadowPriority.empty())
+                light->setShadowPriority(readValue<float>(shadowPriority));
+
             light->setEnabled(enabled_val);
             lights.push_back(light);
 
@@ -1009,6 +1053,16 @@ bool vr::loadSceneFile(const std::string& sceneFile, std::shared_ptr<Scene>& sce
             scene->setGroundPlane(groundPlaneNode);
         }
 
+        // Memory in MB the point shadow maps may use
+        std::string shadowMemoryBudget = getAttribute(root_node, "shadowMemoryBudget");
+        if (!shadowMemoryBudget.empty())
+            scene->setShadowMemoryBudget(size_t(readValue<float>(shadowMemoryBudget) * 1024 * 1024));
+
+        // Number of point lights casting shadows
+        std::string shadowedLights = getAttribute(root_node, "shadowedLights");
+        if (!shadowedLights.empty())
+            scene->setMaxShadowedLights(readValue<unsigned int>(shadowedLights));
+
         GeometryMap geometryMap;
         LightVector lights;
         CameraVector cameras;
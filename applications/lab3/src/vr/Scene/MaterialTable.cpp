@@ -0,0 +1,80 @@
+#include <vr/Scene/MaterialTable.h>
+
+#include <algorithm>
+
+using namespace vr;
+
+MaterialTable::MaterialTable() : m_buffer(GL_SHADER_STORAGE_BUFFER), m_bufferCount(0), m_uploaded(0) {
+    add(&m_default);
+}
+
+void MaterialTable::clear() {
+    m_indices.clear();
+    m_entries.clear();
+    m_data.clear();
+    m_bufferCount = 0;
+    add(&m_default);
+}
+
+int MaterialTable::add(Material* material) {
+    if (material == nullptr)
+        return -1;
+
+    auto it = m_indices.find(material);
+    if (it != m_indices.end())
+        return it->second;
+
+    int index = m_entries.size();
+    m_indices[material] = index;
+
+    Entry entry;
+    entry.material = material;
+    entry.version = material->version();
+    m_entries.push_back(entry);
+
+    m_data.push_back(MaterialData());
+    material->pack(m_data.back());
+    return index;
+}
+
+int MaterialTable::indexOf(const Material* material) const {
+    auto it = m_indices.find(material);
+    return it != m_indices.end() ? it->second : -1;
+}
+
+void MaterialTable::update() {
+    m_uploaded = 0;
+
+    size_t firstChanged = m_entries.size();
+    size_t lastChanged = 0;
+    for (size_t i = 0; i < m_bufferCount; i++) {
+        Entry& entry = m_entries[i];
+        if (entry.version == entry.material->version())
+            continue;
+
+        entry.material->pack(m_data[i]);
+        entry.version = entry.material->version();
+
+        firstChanged = std::min(firstChanged, i);
+        lastChanged = i;
+        m_uploaded++;
+    }
+
+    // New materials change the size of the buffer, so the whole table is uploaded again
+    if (m_data.size() != m_bufferCount) {
+        m_uploaded += m_data.size() - m_bufferCount;
+        m_buffer.upload(m_data.data(), m_data.size() * sizeof(MaterialData));
+        m_bufferCount = m_data.size();
+    } else if (m_uploaded > 0) {
+        m_buffer.update(firstChanged * sizeof(MaterialData), &m_data[firstChanged], (lastChanged - firstChanged + 1) * sizeof(MaterialData));
+    }
+}
+
+void MaterialTable::apply(const std::shared_ptr<Shader>& shader) const {
+    m_buffer.bindBase(MATERIAL_BUFFER_BINDING);
+
+    int slots[MAX_MATERIAL_TEXTURES];
+    for (int i = 0; i < MAX_MATERIAL_TEXTURES; i++)
+        slots[i] = MATERIAL_TEXTURES_BASE_SLOT + i;
+    shader->setIntArray("materialTextures", slots, MAX_MATERIAL_TEXTURES);
+}
@@ -0,0 +1,274 @@
+#include <vr/Scene/MeshOptimizer.h>
+
+#include <algorithm>
+
+using namespace vr;
+
+namespace {
+
+/**
+ * A FIFO vertex cache. Vertices enter the cache with a timestamp when they miss, and leave it
+ * VERTEX_CACHE_SIZE misses later; advancing the time by the cache size empties the cache.
+ */
+class VertexCache {
+   public:
+    VertexCache(size_t vertexCount) : m_stamps(vertexCount, 0), m_time(VERTEX_CACHE_SIZE + 1) {}
+
+    /// \return true if the vertex missed the cache and was added to it
+    bool access(GLuint vertex) {
+        if (m_time - m_stamps[vertex] <= VERTEX_CACHE_SIZE)
+            return false;
+        m_stamps[vertex] = m_time++;
+        return true;
+    }
+
+    /// \return the number of misses of a triangle
+    unsigned int triangle(const GLuint* indices) { return access(indices[0]) + access(indices[1]) + access(indices[2]); }
+
+    /// \return the time since a vertex entered the cache, more than VERTEX_CACHE_SIZE if it is not in the cache
+    unsigned int age(GLuint vertex) const { return m_time - m_stamps[vertex]; }
+
+    void clear() { m_time += VERTEX_CACHE_SIZE + 1; }
+
+   private:
+    std::vector<unsigned int> m_stamps;
+    unsigned int m_time;
+};
+
+}  // namespace
+
+MeshOptimizer::MeshOptimizer() {
+    resetStatistics();
+}
+
+void MeshOptimizer::resetStatistics() {
+    m_stats = MeshOptimizerStats();
+}
+
+unsigned int MeshOptimizer::cacheMisses(const std::vector<GLuint>& indices, size_t vertexCount) {
+    VertexCache cache(vertexCount);
+    unsigned int misses = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        misses += cache.triangle(&indices[i]);
+    return misses;
+}
+
+void MeshOptimizer::optimize(std::vector<glm::vec4>& vertices, std::vector<glm::vec3>& normals, std::vector<glm::vec2>& texCoords,
+                             std::vector<glm::vec3>& tangents, std::vector<glm::vec3>& bitangents, std::vector<GLuint>& indices) {
+    // Lines and points are drawn as they are
+    if (indices.size() < 3 || indices.size() % 3 != 0)
+        return;
+
+    size_t vertexCount = vertices.size();
+    unsigned int missesBefore = cacheMisses(indices, vertexCount);
+
+    m_indices = indices;
+    std::vector<size_t> clusters;
+    optimizeVertexCache(vertexCount, clusters);
+    optimizeOverdraw(vertices, clusters);
+
+    m_remap.assign(vertexCount, -1);
+    GLint used = 0;
+    for (GLuint& index : m_indices) {
+        if (m_remap[index] < 0)
+            m_remap[index] = used++;
+        index = GLuint(m_remap[index]);
+    }
+
+    remap(vertices, used);
+    remap(normals, used);
+    remap(texCoords, used);
+    remap(tangents, used);
+    remap(bitangents, used);
+    indices.swap(m_indices);
+
+    m_stats.triangles += indices.size() / 3;
+    m_stats.vertices += used;
+    m_stats.missesBefore += missesBefore;
+    m_stats.missesAfter += cacheMisses(indices, used);
+}
+
+template <class T>
+void MeshOptimizer::remap(std::vector<T>& data, size_t count) const {
+    if (data.size() != m_remap.size())
+        return;
+
+    std::vector<T> remapped(count);
+    for (size_t i = 0; i < data.size(); i++) {
+        if (m_remap[i] >= 0)
+            remapped[m_remap[i]] = data[i];
+    }
+    data.swap(remapped);
+}
+
+void MeshOptimizer::optimizeVertexCache(size_t vertexCount, std::vector<size_t>& clusters) {
+    size_t triangleCount = m_indices.size() / 3;
+
+    m_offsets.assign(vertexCount + 1, 0);
+    for (GLuint index : m_indices)
+        m_offsets[index + 1]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        m_offsets[v + 1] += m_offsets[v];
+
+    m_adjacency.resize(m_indices.size());
+    std::vector<size_t> next(m_offsets.begin(), m_offsets.end() - 1);
+    for (size_t i = 0; i < m_indices.size(); i++)
+        m_adjacency[next[m_indices[i]]++] = i / 3;
+
+    // Triangles of each vertex that have not been emitted yet
+    std::vector<unsigned int> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        live[v] = m_offsets[v + 1] - m_offsets[v];
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<GLuint> deadEnd;
+    std::vector<GLuint> candidates;
+    VertexCache cache(vertexCount);
+    size_t cursor = 0;
+
+    m_result.clear();
+    clusters.clear();
+
+    while (cursor < vertexCount && live[cursor] == 0)
+        cursor++;
+    GLint fan = cursor < vertexCount ? GLint(cursor) : -1;
+    if (fan >= 0)
+        clusters.push_back(0);
+
+    while (fan >= 0) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (size_t k = m_offsets[fan]; k < m_offsets[fan + 1]; k++) {
+            size_t triangle = m_adjacency[k];
+            if (emitted[triangle])
+                continue;
+
+            for (int j = 0; j < 3; j++) {
+                GLuint v = m_indices[triangle * 3 + j];
+                m_result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                cache.access(v);
+            }
+            emitted[triangle] = true;
+        }
+
+        // Continue with the oldest vertex that would still be in the cache after its remaining triangles are emitted
+        GLint best = -1;
+        int bestPriority = -1;
+        for (GLuint v : candidates) {
+            if (live[v] == 0)
+                continue;
+
+            int priority = 0;
+            if (cache.age(v) + 2 * live[v] <= VERTEX_CACHE_SIZE)
+                priority = cache.age(v);
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+
+        // At a dead end, go back to a recently used vertex, or else to the next vertex with triangles left
+        if (best < 0) {
+            while (!deadEnd.empty() && best < 0) {
+                GLuint v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0)
+                    best = v;
+            }
+
+            if (best < 0) {
+                while (cursor < vertexCount && live[cursor] == 0)
+                    cursor++;
+                if (cursor < vertexCount)
+                    best = GLint(cursor);
+            }
+
+            if (best >= 0)
+                clusters.push_back(m_result.size() / 3);
+        }
+
+        fan = best;
+    }
+
+    m_indices.swap(m_result);
+}
+
+void MeshOptimizer::optimizeOverdraw(const std::vector<glm::vec4>& vertices, std::vector<size_t>& clusters) {
+    size_t triangleCount = m_indices.size() / 3;
+    VertexCache cache(vertices.size());
+
+    // Cut each cluster where the triangles so far have reached nearly the ACMR of the whole cluster,
+    // the smaller clusters lose little cache locality when they are drawn in another order
+    std::vector<size_t> split;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t start = clusters[c];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        cache.clear();
+        unsigned int misses = 0;
+        for (size_t t = start; t < end; t++)
+            misses += cache.triangle(&m_indices[t * 3]);
+        float threshold = OVERDRAW_THRESHOLD * misses / (end - start);
+
+        cache.clear();
+        misses = 0;
+        split.push_back(start);
+        for (size_t t = start; t < end; t++) {
+            misses += cache.triangle(&m_indices[t * 3]);
+            if (t + 1 < end && float(misses) / (t + 1 - split.back()) <= threshold) {
+                split.push_back(t + 1);
+                cache.clear();
+                misses = 0;
+            }
+        }
+    }
+    clusters.swap(split);
+
+    // Area weighted centroid and normal of every cluster, and the centroid of the mesh
+    std::vector<std::pair<float, size_t>> order(clusters.size());
+    std::vector<glm::vec3> centroids(clusters.size());
+    std::vector<glm::vec3> normals(clusters.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = clusters[c]; t < end; t++) {
+            glm::vec3 a = glm::vec3(vertices[m_indices[t * 3]]);
+            glm::vec3 b = glm::vec3(vertices[m_indices[t * 3 + 1]]);
+            glm::vec3 d = glm::vec3(vertices[m_indices[t * 3 + 2]]);
+            glm::vec3 n = glm::cross(b - a, d - a);
+            float triangleArea = glm::length(n);
+            centroid += (a + b + d) / 3.0f * triangleArea;
+            normal += n;
+            area += triangleArea;
+        }
+
+        centroids[c] = area > 0.0f ? centroid / area : centroid;
+        normals[c] = glm::length(normal) > 0.0f ? glm::normalize(normal) : normal;
+        meshCentroid += centroid;
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Clusters facing away from the center of the mesh are drawn first
+    for (size_t c = 0; c < clusters.size(); c++)
+        order[c] = std::make_pair(-glm::dot(centroids[c] - meshCentroid, normals[c]), c);
+    std::stable_sort(order.begin(), order.end(), [](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b) {
+        return a.first < b.first;
+    });
+
+    m_result.clear();
+    for (auto& entry : order) {
+        size_t c = entry.second;
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+        m_result.insert(m_result.end(), m_indices.begin() + clusters[c] * 3, m_indices.begin() + end * 3);
+    }
+    m_indices.swap(m_result);
+}
@@ -0,0 +1,61 @@
+#include <vr/Frustum.h>
+#include <vr/Scene/MeshletCuller.h>
+
+using namespace vr;
+
+MeshletCuller::MeshletCuller() : m_viewProjection(1.0f), m_eye(0.0f), m_cullBackfaces(false) {
+    resetStatistics();
+}
+
+void MeshletCuller::resetStatistics() {
+    m_stats = MeshletStats();
+}
+
+void MeshletCuller::begin(const glm::mat4& viewProjection, const glm::vec3& eye, bool cullBackfaces) {
+    m_viewProjection = viewProjection;
+    m_eye = eye;
+    m_cullBackfaces = cullBackfaces;
+}
+
+bool MeshletCuller::cull(const std::vector<Meshlet>& meshlets, const glm::mat4& world, size_t indexSize, bool backFacesCulled) {
+    // Planes extracted from the full matrix are in the local space of the geometry
+    const Frustum frustum(m_viewProjection * world);
+    glm::vec3 eye = glm::vec3(glm::inverse(world) * glm::vec4(m_eye, 1.0f));
+
+    m_counts.clear();
+    m_offsets.clear();
+    GLuint rangeEnd = 0;
+    bool cullBackfaces = m_cullBackfaces && backFacesCulled;
+
+    for (auto& meshlet : meshlets) {
+        GLuint triangles = meshlet.indexCount / 3;
+        m_stats.meshlets++;
+        m_stats.triangles += triangles;
+
+        bool culled = frustum.intersect(meshlet.center, meshlet.radius) == Frustum::OUTSIDE;
+
+        // Every triangle faces away if the direction to the apex is within the complement of the normal cone
+        if (!culled && cullBackfaces) {
+            glm::vec3 toApex = meshlet.coneApex - eye;
+            culled = glm::dot(toApex, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toApex);
+        }
+
+        if (culled) {
+            m_stats.meshletsCulled++;
+            m_stats.trianglesCulled += triangles;
+            continue;
+        }
+
+        // Meshlets follow each other in the index buffer, neighbours that are both visible share a range
+        if (!m_counts.empty() && rangeEnd == meshlet.firstIndex) {
+            m_counts.back() += meshlet.indexCount;
+        } else {
+            m_counts.push_back(meshlet.indexCount);
+            m_offsets.push_back((const void*)(meshlet.firstIndex * indexSize));
+        }
+        rangeEnd = meshlet.firstIndex + meshlet.indexCount;
+    }
+
+    m_stats.ranges += m_counts.size();
+    return !m_counts.empty();
+}
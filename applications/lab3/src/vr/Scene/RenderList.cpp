@@ -0,0 +1,187 @@
+#include <vr/Nodes/Geometry.h>
+#include <vr/Nodes/LodNode.h>
+#include <vr/Nodes/Transform.h>
+#include <vr/Scene/BVH.h>
+#include <vr/Scene/RenderList.h>
+
+using namespace vr;
+
+RenderList::RenderList() : m_graphVersion(0), m_invalidated(true) {
+    m_cullStats = CullStats();
+}
+
+void RenderList::clear() {
+    m_items.clear();
+    m_lodLevels.clear();
+    m_changedItems.clear();
+    m_changedBounds.clear();
+    m_lights.clear();
+    m_cameras.clear();
+}
+
+bool RenderList::isDirty() const {
+    return m_invalidated || m_graphVersion != Node::graphVersion();
+}
+
+void RenderList::invalidate() {
+    m_invalidated = true;
+}
+
+void RenderList::setCompiled() {
+    m_graphVersion = Node::graphVersion();
+    m_invalidated = false;
+}
+
+int RenderList::addLodLevel(LodNode* lodNode, Group* level, int parent, int first) {
+    RenderLodLevel entry;
+    entry.node = lodNode;
+    entry.level = level;
+    entry.parent = parent;
+    entry.first = first < 0 ? int(m_lodLevels.size()) : first;
+    entry.active = false;
+    entry.switched = false;
+    m_lodLevels.push_back(entry);
+    return m_lodLevels.size() - 1;
+}
+
+void RenderList::addItem(Geometry* geometry, std::shared_ptr<State> state, Transform* transform, int lodLevel) {
+    RenderItem item;
+    item.geometry = geometry;
+    item.state = state;
+    item.transform = transform;
+    item.lodLevel = lodLevel;
+    item.visible = true;
+
+    // Items without a transform never move, so their matrices are computed once
+    if (transform) {
+        item.worldVersion = transform->getWorldVersion();
+        item.world = transform->getWorldMatrix() * geometry->getObjectMatrix();
+        item.normalMatrix = transform->getNormalMatrix() * geometry->getNormalMatrix();
+    } else {
+        item.worldVersion = 0;
+        item.world = geometry->getObjectMatrix();
+        item.normalMatrix = geometry->getNormalMatrix();
+    }
+    item.bounds = geometry->getLocalBounds() * item.world;
+    expandLodBounds(item);
+    m_items.push_back(item);
+}
+
+void RenderList::expandLodBounds(const RenderItem& item) {
+    for (int level = item.lodLevel; level >= 0; level = m_lodLevels[level].parent)
+        m_lodLevels[level].bounds.expand(item.bounds);
+}
+
+void RenderList::updateLodBounds() {
+    for (auto& level : m_lodLevels)
+        level.bounds = BoundingBox();
+
+    for (auto& item : m_items)
+        expandLodBounds(item);
+}
+
+void RenderList::addLight(std::shared_ptr<Light> light, Transform* transform) {
+    m_lights.push_back(std::make_pair(light, transform));
+}
+
+void RenderList::addCamera(std::shared_ptr<Camera> camera, Transform* transform) {
+    m_cameras.push_back(std::make_pair(camera, transform));
+}
+
+void RenderList::update(const glm::vec3& cameraPosition) {
+    m_changedItems.clear();
+    m_changedBounds.clear();
+    bool lodMoved = false;
+    for (size_t i = 0; i < m_items.size(); i++) {
+        RenderItem& item = m_items[i];
+        if (!item.transform || item.transform->getWorldVersion() == item.worldVersion)
+            continue;
+
+        m_changedItems.push_back(i);
+        m_changedBounds.push_back(item.bounds);
+
+        // The inverse transpose of a product is the product of the inverse transposes
+        item.worldVersion = item.transform->getWorldVersion();
+        item.world = item.transform->getWorldMatrix() * item.geometry->getObjectMatrix();
+        item.normalMatrix = item.transform->getNormalMatrix() * item.geometry->getNormalMatrix();
+        item.bounds = item.geometry->getLocalBounds() * item.world;
+        m_changedBounds.push_back(item.bounds);
+        lodMoved = lodMoved || item.lodLevel >= 0;
+    }
+
+    if (lodMoved)
+        updateLodBounds();
+
+    // Parents come before their children, so a switched parent is known when its children are visited
+    bool lodSwitched = false;
+    for (auto& level : m_lodLevels) {
+        bool parentActive = level.parent < 0 || m_lodLevels[level.parent].active;
+        // The level is selected by the distance to the highest level of this reference, not of the shared node
+        const BoundingBox& bounds = m_lodLevels[level.first].bounds;
+        bool active = parentActive;
+        if (active && bounds.isValid())
+            active = level.node->getChild(glm::distance(cameraPosition, bounds.getCenter())) == level.level;
+        else if (active)
+            active = level.node->getChild(cameraPosition) == level.level;
+        level.switched = active != level.active || (level.parent >= 0 && m_lodLevels[level.parent].switched);
+        level.active = active;
+        lodSwitched = lodSwitched || level.switched;
+    }
+
+    if (lodSwitched) {
+        for (auto& item : m_items) {
+            if (item.lodLevel >= 0 && m_lodLevels[item.lodLevel].switched)
+                m_changedBounds.push_back(item.bounds);
+        }
+    }
+
+    for (auto& light : m_lights) {
+        light.first->setTransform(light.second ? light.second->getWorldMatrix() : glm::mat4(1.0f));
+    }
+
+    for (auto& camera : m_cameras) {
+        camera.first->setTransform(camera.second ? camera.second->getWorldMatrix() : glm::mat4(1.0f));
+    }
+}
+
+const std::vector<int>& RenderList::getChangedItems() const {
+    return m_changedItems;
+}
+
+const std::vector<BoundingBox>& RenderList::getChangedBounds() const {
+    return m_changedBounds;
+}
+
+void RenderList::cull(const Frustum& frustum, BVH& bvh) {
+    for (auto& item : m_items)
+        item.visible = false;
+
+    bvh.resetStatistics();
+    m_visibleItems.clear();
+    bvh.query(frustum, m_visibleItems);
+
+    m_cullStats.visited = bvh.getStatistics().visited;
+    m_cullStats.culled = bvh.getStatistics().culled;
+    m_cullStats.drawn = 0;
+
+    for (int index : m_visibleItems) {
+        RenderItem& item = m_items[index];
+        if (!isActive(item))
+            continue;
+
+        item.visible = true;
+        m_cullStats.drawn++;
+    }
+}
+
+const CullStats& RenderList::getCullStats() const {
+    return m_cullStats;
+}
+
+bool RenderList::isActive(const RenderItem& item) const {
+    return item.lodLevel < 0 || m_lodLevels[item.lodLevel].active;
+}
+
+const std::vector<RenderItem>& RenderList::getItems() const {
+    return m_items;
+}
@@ -0,0 +1,150 @@
+#include <vr/Scene/RenderQueue.h>
+
+#include <algorithm>
+
+using namespace vr;
+
+namespace {
+const std::string MATERIAL_INDEX_UNIFORM = "materialIndex";
+}  // namespace
+
+RenderQueue::RenderQueue() : m_cameraUniforms(0), m_materialUniforms(0), m_textureUniforms(0) {
+    m_stats = RenderQueueStats();
+}
+
+void RenderQueue::begin() {
+    m_commands.clear();
+}
+
+uint64_t RenderQueue::idOf(std::unordered_map<const void*, uint64_t>& ids, const void* pointer, int bits) {
+    if (pointer == nullptr)
+        return 0;
+
+    auto it = ids.find(pointer);
+    if (it != ids.end())
+        return it->second;
+
+    // Ids wrap around when a field overflows, which only makes the sorting less effective
+    uint64_t id = (ids.size() + 1) & ((uint64_t(1) << bits) - 1);
+    ids[pointer] = id;
+    return id;
+}
+
+void RenderQueue::add(const InstanceBatch& batch, float depth, float farPlane, Pass pass) {
+    State* state = batch.state;
+
+    uint64_t shader = idOf(m_shaderIds, state->getShader().get(), SORT_KEY_SHADER_BITS);
+    uint64_t material = idOf(m_materialIds, state->getMaterial().get(), SORT_KEY_MATERIAL_BITS);
+    uint64_t textures = idOf(m_textureIds, state->hasTextures() ? state : nullptr, SORT_KEY_TEXTURES_BITS);
+
+    const uint64_t maxDepth = (uint64_t(1) << SORT_KEY_DEPTH_BITS) - 1;
+    uint64_t quantizedDepth = uint64_t(glm::clamp(depth / farPlane, 0.0f, 1.0f) * maxDepth);
+
+    RenderCommand command;
+    command.key = uint64_t(pass);
+    command.key = (command.key << SORT_KEY_SHADER_BITS) | shader;
+    command.key = (command.key << SORT_KEY_MATERIAL_BITS) | material;
+    command.key = (command.key << SORT_KEY_TEXTURES_BITS) | textures;
+    command.key = (command.key << SORT_KEY_DEPTH_BITS) | quantizedDepth;
+    command.batch = &batch;
+    m_commands.push_back(command);
+}
+
+void RenderQueue::draw(InstanceBatcher& batcher, Camera& camera, const MaterialTable& materials) {
+    std::sort(m_commands.begin(), m_commands.end(), [](const RenderCommand& a, const RenderCommand& b) { return a.key < b.key; });
+
+    m_stats = RenderQueueStats();
+    m_stats.commands = m_commands.size();
+    unsigned int uniformsBefore = Shader::uniformUploads();
+
+    // Changes are detected on the actual pointers, ids in the key may wrap around
+    Shader* currentShader = nullptr;
+    Material* currentMaterial = nullptr;
+    State* currentTextures = nullptr;
+    int currentCullFace = -1;
+    GLint materialIndex = DEFAULT_MATERIAL_INDEX;
+
+    for (auto& command : m_commands) {
+        State* state = command.batch->state;
+        const std::shared_ptr<Shader>& shader = state->getShader();
+        Material* material = state->getMaterial().get();
+        State* textures = state->hasTextures() ? state : nullptr;
+
+        // Uniforms belong to the program, so everything has to be uploaded again after a shader change.
+        // Shaders reading the CameraBlock get the camera from the uniform buffer instead.
+        bool shaderChanged = shader.get() != currentShader;
+        if (shaderChanged) {
+            batcher.flush();
+            unsigned int before = Shader::uniformUploads();
+            shader->use();
+            if (!shader->usesCameraBlock())
+                camera.apply(shader);
+            if (shader->usesMaterialTable())
+                materials.apply(shader);
+            m_cameraUniforms = Shader::uniformUploads() - before;
+
+            currentShader = shader.get();
+            m_stats.programChanges++;
+        } else {
+            m_stats.uniformUploadsSaved += m_cameraUniforms;
+        }
+
+        if (shaderChanged || material != currentMaterial) {
+            unsigned int before = Shader::uniformUploads();
+            // The properties are already in the material table, only its index and textures change. Indirect
+            // draws read the index from their draw data, so only binding other textures ends the draws collected so far.
+            // States without a material, or with one missing from the table, get the default material.
+            if (shader->usesMaterialTable()) {
+                materialIndex = DEFAULT_MATERIAL_INDEX;
+                if (material != nullptr) {
+                    if (material->hasTextures())
+                        batcher.flush();
+                    material->bindTextures();
+                    materialIndex = std::max(materials.indexOf(material), DEFAULT_MATERIAL_INDEX);
+                }
+                shader->setInt(MATERIAL_INDEX_UNIFORM, materialIndex);
+            } else {
+                batcher.flush();
+                state->applyMaterial();
+            }
+            m_materialUniforms = Shader::uniformUploads() - before;
+
+            currentMaterial = material;
+            m_stats.materialChanges++;
+        } else {
+            m_stats.uniformUploadsSaved += m_materialUniforms;
+        }
+
+        // A state without textures still uploads that no texture layers are active
+        if (shaderChanged || textures != currentTextures) {
+            batcher.flush();
+            unsigned int before = Shader::uniformUploads();
+            state->applyTextures();
+            m_textureUniforms = Shader::uniformUploads() - before;
+
+            currentTextures = textures;
+            m_stats.textureChanges++;
+        } else {
+            m_stats.uniformUploadsSaved += m_textureUniforms;
+        }
+
+        int cullFace = state->CullFaceEnabled();
+        if (cullFace != currentCullFace) {
+            batcher.flush();
+            state->applyCullFace();
+            currentCullFace = cullFace;
+            m_stats.cullFaceChanges++;
+        }
+
+        batcher.draw(*command.batch, shader, false, 1, materialIndex);
+    }
+    batcher.flush();
+
+    m_stats.uniformUploads = Shader::uniformUploads() - uniformsBefore;
+}
+
+void RenderQueue::clearIds() {
+    m_shaderIds.clear();
+    m_materialIds.clear();
+    m_textureIds.clear();
+}
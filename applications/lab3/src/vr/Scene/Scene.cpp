@@ -1,5 +1,7 @@
+#include <vr/Nodes/Geometry.h>
 #include <vr/Nodes/Group.h>
 #include <vr/Scene/Scene.h>
+#include <vr/State/GeometryArena.h>
 #include <vr/glErrorUtil.h>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -31,7 +33,8 @@ void Scene::initScene(unsigned int width, unsigned int height) {
     m_lights.clear();
     m_cameras.clear();
 
-    m_pointShadowMap = std::make_shared<Texture>();
+    m_shadowAtlas = std::make_shared<ShadowAtlas>();
+    m_shadowPrefilter = std::make_shared<ShadowPrefilter>();
     m_directionalShadowMap = std::make_shared<Texture>();
 
     m_camera = std::make_shared<Camera>();
@@ -40,13 +43,22 @@ void Scene::initScene(unsigned int width, unsigned int height) {
 
     m_gbuffer = std::make_shared<Gbuffer>(width, height);
 
-    m_renderVisitor = std::make_shared<RenderVisitor>();
+    m_compileVisitor = std::make_shared<CompileVisitor>();
     m_updateVisitor = std::make_shared<UpdateVisitor>();
-    m_depthVisitor = std::make_shared<DepthVisitor>();
+    m_depthRenderer = std::make_shared<DepthRenderer>();
+    m_shadowCache = std::make_shared<ShadowCache>();
+    m_renderList = std::make_shared<RenderList>();
+    m_bvh = std::make_shared<BVH>();
+    m_instanceBatcher = std::make_shared<InstanceBatcher>();
+    m_meshletCuller = std::make_shared<MeshletCuller>();
+    m_instanceBatcher->setMeshletCuller(m_meshletCuller.get());
+    m_renderQueue = std::make_shared<RenderQueue>();
+    m_lightBuffer = std::make_shared<LightBuffer>();
+    m_lightClusters = std::make_shared<LightClusters>();
+    m_cameraBuffer = std::make_shared<Buffer>(GL_UNIFORM_BUFFER);
+    m_materialTable = std::make_shared<MaterialTable>();
 
-    m_renderVisitor->setActiveCamera(m_camera);
     m_updateVisitor->setActiveCamera(m_camera);
-    m_depthVisitor->setActiveCamera(m_camera);
 
     m_root = std::shared_ptr<Group>(new Group("root"));
 
@@ -61,27 +73,56 @@ void Scene::initScene(unsigned int width, unsigned int height) {
 void Scene::initDepthMaps() {
     int pointLightCount = 0;
     int directionalLightCount = 0;
+    bool exponentialShadowMaps = false;
     for (auto& light : m_lights) {
         if (light->getPosition().w == 0)
             directionalLightCount++;
         else
             pointLightCount++;
+        exponentialShadowMaps = exponentialShadowMaps || light->getShadowFilter() == Light::SHADOW_FILTER_ESM;
     }
-    if (pointLightCount > 0) m_pointShadowMap->createDepthMapArray(DEPTH_MAP_RESOLUTION, DEPTH_MAP_RESOLUTION, pointLightCount, false);
+    m_shadowAtlas->init(pointLightCount);
+    // Indexed like the directional shadow map array, only allocated if a light uses it
+    m_shadowPrefilter->init(exponentialShadowMaps ? SHADOW_CASCADES * directionalLightCount : 0);
     if (directionalLightCount > 0) m_directionalShadowMap->createDepthMapArray(DEPTH_MAP_RESOLUTION, DEPTH_MAP_RESOLUTION, directionalLightCount, true);
 }
 
-std::shared_ptr<Texture> Scene::getPointShadowMap() {
-    return m_pointShadowMap;
+std::shared_ptr<ShadowAtlas> Scene::getShadowAtlas() {
+    return m_shadowAtlas;
+}
+
+std::shared_ptr<ShadowPrefilter> Scene::getShadowPrefilter() {
+    return m_shadowPrefilter;
+}
+
+void Scene::setShadowMemoryBudget(size_t bytes) {
+    m_shadowAtlas->setBudget(bytes);
+}
+
+void Scene::setMaxShadowedLights(unsigned int count) {
+    m_shadowAtlas->setMaxLights(count);
+}
+
+unsigned int Scene::getMaxShadowedLights() const {
+    return m_shadowAtlas->getMaxLights();
 }
 
 std::shared_ptr<Texture> Scene::getDirectionalShadowMap() {
     return m_directionalShadowMap;
 }
 
+std::shared_ptr<LightBuffer> Scene::getLightBuffer() {
+    return m_lightBuffer;
+}
+
+std::shared_ptr<LightClusters> Scene::getLightClusters() {
+    return m_lightClusters;
+}
+
 void Scene::add(std::shared_ptr<Light> light) {
     m_lights.push_back(light);
     m_root->getState()->addLight(light);
+    m_renderList->invalidate();
 }
 
 const LightVector Scene::getLights() {
@@ -91,6 +132,7 @@ const LightVector Scene::getLights() {
 void Scene::setLights(LightVector lights) {
     m_lights = lights;
     m_root->getState()->setLights(m_lights);
+    m_renderList->invalidate();
 }
 
 std::shared_ptr<Camera> Scene::getCamera() {
@@ -111,11 +153,41 @@ void Scene::cleanup() {
     if (m_root)
         m_root = nullptr;
 
-    if (m_depthVisitor)
-        m_depthVisitor = nullptr;
+    if (m_depthRenderer)
+        m_depthRenderer = nullptr;
+
+    if (m_compileVisitor)
+        m_compileVisitor = nullptr;
+
+    if (m_renderList)
+        m_renderList = nullptr;
 
-    if (m_renderVisitor)
-        m_renderVisitor = nullptr;
+    if (m_bvh)
+        m_bvh = nullptr;
+
+    if (m_instanceBatcher)
+        m_instanceBatcher = nullptr;
+
+    if (m_meshletCuller)
+        m_meshletCuller = nullptr;
+
+    if (m_renderQueue)
+        m_renderQueue = nullptr;
+
+    if (m_lightBuffer)
+        m_lightBuffer = nullptr;
+
+    if (m_lightClusters)
+        m_lightClusters = nullptr;
+
+    if (m_shadowCache)
+        m_shadowCache = nullptr;
+
+    if (m_cameraBuffer)
+        m_cameraBuffer = nullptr;
+
+    if (m_materialTable)
+        m_materialTable = nullptr;
 
     if (m_lights.size() > 0)
         m_lights.clear();
@@ -126,8 +198,11 @@ void Scene::cleanup() {
     if (m_gbuffer)
         m_gbuffer = nullptr;
 
-    if (m_pointShadowMap)
-        m_pointShadowMap = nullptr;
+    if (m_shadowAtlas)
+        m_shadowAtlas = nullptr;
+
+    if (m_shadowPrefilter)
+        m_shadowPrefilter = nullptr;
 
     if (m_directionalShadowMap)
         m_directionalShadowMap = nullptr;
@@ -180,9 +255,7 @@ void Scene::setActiveCamera(int next) {
 
     selectedCamera = next_index;
     m_camera = m_cameras[selectedCamera];
-    m_renderVisitor->setActiveCamera(m_camera);
     m_updateVisitor->setActiveCamera(m_camera);
-    m_depthVisitor->setActiveCamera(m_camera);
 }
 
 CameraVector Scene::getCameras() {
@@ -221,17 +294,20 @@ BoundingBox
 Scene::calculateSceneBoundingBox(bool excludeGround) {
     BoundingBox box;
 
-    if (m_groundPlane != nullptr)
-        m_groundPlane->setExclude(excludeGround);
+    // The cached bounds are refit by the update traversal. Only when the graph has
+    // changed since then, e.g. while the scene is loaded, a full traversal is needed.
+    if (m_boundsGraphVersion != Node::graphVersion()) {
+        m_root->calculateBoundingBox(glm::mat4(1.0f));
+        m_boundsGraphVersion = Node::graphVersion();
+    }
 
-    box.expand(m_root->calculateBoundingBox(glm::mat4(1.0f)));
+    // The ground plane is excluded from the bounds of its parent by default
+    box.expand(m_root->getCachedBounds());
 
-    if (!excludeGround && m_groundPlane != nullptr)
+    if (!excludeGround && m_groundPlane != nullptr) {
+        box.expand(m_groundPlane->getCachedBounds());
         m_groundRadius = box.getRadius();
-
-    // Should be excluded by default
-    if (m_groundPlane != nullptr)
-        m_groundPlane->setExclude(true);
+    }
 
     return box;
 }
@@ -239,40 +315,210 @@ Scene::calculateSceneBoundingBox(bool excludeGround) {
 void Scene::render() {
     m_updateVisitor->visit(m_root.get());
 
+    if (m_renderList->isDirty()) {
+        m_compileVisitor->compile(m_root.get(), *m_renderList);
+        m_bvh->build(*m_renderList);
+        m_renderQueue->clearIds();
+        m_shadowCache->invalidate();
+
+        // Every material of the scene is written to the table once, not only the visible ones
+        m_materialTable->clear();
+        for (auto& item : m_renderList->getItems())
+            m_materialTable->add(item.state->getMaterial().get());
+    } else if (m_compileVisitor->statesChanged()) {
+        m_compileVisitor->updateStates();
+    }
+
+    m_renderList->update(m_camera->getPosition());
+    m_bvh->refit(*m_renderList);
+
+    m_camera->updateMatrices();
+
+    // Written once per frame, every program declaring the CameraBlock reads it from this buffer
+    CameraData cameraData;
+    m_camera->pack(cameraData);
+    m_cameraBuffer->upload(&cameraData, sizeof(CameraData));
+    m_cameraBuffer->bindBase(CAMERA_BLOCK_BINDING);
+
+    m_renderList->cull(m_camera->getFrustum(), *m_bvh);
+
+    m_depthRenderer->beginFrame();
+    m_shadowPrefilter->resetStatistics();
+
     // IF ground plane is rendered, it covers the depth map texture. WHy?
+    // The maps are not kept up to date while shadows are off
     if (m_shadowsEnabled)
         renderDepthMaps(m_updateVisitor->sceneChanged());
+    else
+        m_shadowCache->invalidate();
 
     m_updateVisitor->setSceneChanged(false);
 
+    // After the shadow parameters are updated, so the light space matrices are current
+    m_lightBuffer->update(m_lights, *m_shadowAtlas);
+    m_lightClusters->build(m_lights, *m_camera);
+
     m_gbuffer->bindFBO();
     glViewport(0, 0, m_camera->getScreenSize().x, m_camera->getScreenSize().y);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    m_renderVisitor->visit(m_root.get());
+    // Items sharing geometry and resolved state are drawn with a single instanced draw
+    m_instanceBatcher->begin();
+    for (auto& item : m_renderList->getItems()) {
+        if (item.visible)
+            m_instanceBatcher->add(&item, item.state.get());
+    }
+    m_instanceBatcher->end();
+
+    // Batches are sorted by state and drawn front to back, applying only the state that changed
+    m_renderQueue->begin();
+    for (auto& batch : m_instanceBatcher->getBatches()) {
+        float depth = m_camera->getFar();
+        for (int i = batch.first; i < batch.first + batch.count; i++) {
+            const BoundingBox& bounds = m_instanceBatcher->getItem(i)->bounds;
+            depth = glm::min(depth, glm::distance(m_camera->getPosition(), bounds.getCenter()));
+        }
+        m_renderQueue->add(batch, depth, m_camera->getFar());
+
+        // States updated in place may refer to materials that were not in the table yet
+        m_materialTable->add(batch.state->getMaterial().get());
+    }
+    m_materialTable->update();
+
+    m_meshletCuller->resetStatistics();
+    m_meshletCuller->begin(m_camera->getProjection() * m_camera->getView(), m_camera->getPosition(), true);
+    m_renderQueue->draw(*m_instanceBatcher, *m_camera, *m_materialTable);
 
     m_gbuffer->unbindFBO();
 }
 
+std::vector<std::string> Scene::getStatistics() {
+    std::vector<std::string> statistics;
+    const CullStats& cullStats = m_renderList->getCullStats();
+
+    std::ostringstream str;
+    str << "BVH nodes: " << m_bvh->size() << " visited: " << cullStats.visited << " culled: " << cullStats.culled << " drawn: " << cullStats.drawn;
+    statistics.push_back(str.str());
+
+    str.str("");
+    str << "Draw calls: " << m_instanceBatcher->drawCalls() << " instances: " << m_instanceBatcher->instances()
+        << " indirect commands: " << m_instanceBatcher->indirectCommands() << " shadow draw calls: " << m_depthRenderer->drawCalls()
+        << " indirect commands: " << m_depthRenderer->indirectCommands() << " arena blocks: " << GeometryArena::instance().blocks();
+    statistics.push_back(str.str());
+
+    const RenderQueueStats& queueStats = m_renderQueue->getStatistics();
+    str.str("");
+    str << "State changes saved: programs " << queueStats.commands - queueStats.programChanges
+        << " materials " << queueStats.commands - queueStats.materialChanges
+        << " textures " << queueStats.commands - queueStats.textureChanges
+        << " uniforms " << queueStats.uniformUploadsSaved << " (" << queueStats.uniformUploads << " uploaded)";
+    statistics.push_back(str.str());
+
+    const MeshletStats& meshletStats = m_meshletCuller->getStatistics();
+    const MeshletStats& shadowMeshletStats = m_depthRenderer->meshletStatistics();
+    str.str("");
+    str << "Meshlets culled: " << meshletStats.meshletsCulled << "/" << meshletStats.meshlets << " triangles "
+        << int(meshletStats.culledFraction() * 100.0f) << "% ranges " << meshletStats.ranges << " shadows: "
+        << shadowMeshletStats.meshletsCulled << "/" << shadowMeshletStats.meshlets << " triangles "
+        << int(shadowMeshletStats.culledFraction() * 100.0f) << "%";
+    statistics.push_back(str.str());
+
+    str.str("");
+    str << "Shadow casters drawn: " << m_depthRenderer->castersDrawn() << " culled: " << m_depthRenderer->castersCulled()
+        << " caster faces: " << m_depthRenderer->facesDrawn();
+    statistics.push_back(str.str());
+
+    str.str("");
+    str << "Point shadow path: " << DepthRenderer::modeName(m_depthRenderer->pointShadowMode())
+        << (m_depthRenderer->benchmarking() ? " (benchmarking)" : "") << " ns per caster face:";
+    for (int i = 0; i < DepthRenderer::POINT_SHADOW_MODES; i++) {
+        double result = m_depthRenderer->benchmarkResult(DepthRenderer::PointShadowMode(i));
+        str << " " << DepthRenderer::modeName(DepthRenderer::PointShadowMode(i)) << " ";
+        if (result < 0)
+            str << "-";
+        else
+            str << int(result);
+    }
+    statistics.push_back(str.str());
+
+    const ShadowAtlasStats& atlasStats = m_shadowAtlas->getStatistics();
+    str.str("");
+    str << "Shadow atlas:";
+    for (int tier = 0; tier < SHADOW_TIER_COUNT; tier++)
+        str << " " << m_shadowAtlas->resolution(tier) << ": " << atlasStats.lights[tier] << "/" << atlasStats.capacity[tier];
+    str << " limit: " << atlasStats.maxLights << " none: " << atlasStats.unshadowed << " moved: " << atlasStats.reallocated << " memory: "
+        << atlasStats.bytesAllocated / (1024 * 1024) << "/" << atlasStats.budget / (1024 * 1024) << " MB";
+    statistics.push_back(str.str());
+
+    const ShadowCacheStats& shadowStats = m_shadowCache->getStatistics();
+    str.str("");
+    str << "Shadow maps rendered: " << shadowStats.lightsRendered << " cached: " << shadowStats.lightsCached
+        << " faces deferred: " << shadowStats.facesDeferred << " prefiltered: " << m_shadowPrefilter->layersFiltered();
+    statistics.push_back(str.str());
+
+    str.str("");
+    str << "Lights: " << m_lightBuffer->count() << " uploaded: " << m_lightBuffer->lightsUploaded()
+        << " materials: " << m_materialTable->count() << " uploaded: " << m_materialTable->materialsUploaded();
+    statistics.push_back(str.str());
+
+    const ClusterStats& clusterStats = m_lightClusters->getStatistics();
+    str.str("");
+    str << "Clustered point lights: " << clusterStats.lights << " assignments: " << clusterStats.assignments
+        << " max per cluster: " << clusterStats.maxPerCluster;
+    statistics.push_back(str.str());
+
+    return statistics;
+}
+
 void Scene::renderDepthMaps(bool sceneChanged) {
-    BoundingBox sbox;
-    if (sceneChanged)
-        sbox = calculateSceneBoundingBox(true);
+    // The shadow parameters are updated first, a light whose volume changed has to be rendered again
+    if (sceneChanged) {
+        BoundingBox sbox = calculateSceneBoundingBox(true);
+        for (auto& light : m_lights)
+            light->setShadowParams(sbox.getRadius(), sbox.getCenter(), m_groundRadius);
+    }
+
+    // Cascades follow the camera, only the ones that were refitted are rendered again
+    for (auto& light : m_lights)
+        light->updateCascades(*m_camera);
+
+    // A light moved to another slot of the atlas has nothing cached there
+    m_shadowAtlas->update(m_lights, *m_camera);
+    for (size_t i = 0; i < m_lights.size(); i++) {
+        if (m_shadowAtlas->reallocated(i))
+            m_shadowCache->invalidate(i);
+    }
+
+    m_shadowCache->update(m_lights, *m_renderList, *m_camera);
 
-    int pointLightIndex = 0;
     int directionalLightIndex = 0;
-    for (auto& light : m_lights) {
-        if (sceneChanged)
-            light->setShadowParams(sbox.getRadius(), sbox.getCenter(), m_groundRadius);
+    for (size_t i = 0; i < m_lights.size(); i++) {
+        const std::shared_ptr<Light>& light = m_lights[i];
+        int faces = m_shadowCache->facesToRender(i);
 
         if (light->getPosition().w == 0) {
-            m_depthVisitor->setupRenderState(light, directionalLightIndex, m_directionalShadowMap->id());
-            directionalLightIndex++;
+            int depthMapIndex = directionalLightIndex++;
+            if (faces == 0)
+                continue;
+
+            m_depthRenderer->setupRenderState(light, depthMapIndex, m_directionalShadowMap->id(), faces);
+            m_depthRenderer->render(*m_renderList, *m_bvh);
+
+            // Exponential shadow maps are blurred once here instead of filtered for every pixel
+            if (light->getShadowFilter() == Light::SHADOW_FILTER_ESM) {
+                for (int c = 0; c < SHADOW_CASCADES; c++) {
+                    if (faces & (1 << c))
+                        m_shadowPrefilter->filter(*m_directionalShadowMap, depthMapIndex * SHADOW_CASCADES + c);
+                }
+            }
         } else {
-            m_depthVisitor->setupRenderState(light, pointLightIndex, m_pointShadowMap->id());
-            pointLightIndex++;
-        }
+            ShadowAllocation allocation = m_shadowAtlas->getAllocation(i);
+            if (faces == 0 || allocation.tier < 0)
+                continue;
 
-        m_depthVisitor->visit(m_root.get());
+            m_depthRenderer->setupRenderState(light, allocation.slot, m_shadowAtlas->getTexture(allocation.tier)->id(), faces,
+                                              m_shadowAtlas->resolution(allocation.tier));
+            m_depthRenderer->render(*m_renderList, *m_bvh);
+        }
     }
 }
@@ -0,0 +1,192 @@
+#include <vr/Frustum.h>
+#include <vr/Scene/ShadowAtlas.h>
+
+#include <algorithm>
+#include <iostream>
+
+using namespace vr;
+
+ShadowAtlas::ShadowAtlas() : m_budget(SHADOW_MEMORY_BUDGET), m_maxLights(SHADOW_MAX_LIGHTS), m_pointLights(-1) {
+    m_stats = ShadowAtlasStats();
+    m_stats.budget = m_budget;
+}
+
+size_t ShadowAtlas::slotBytes(int tier) const {
+    size_t size = resolution(tier);
+    return size * size * 6 * sizeof(float);
+}
+
+void ShadowAtlas::setMaxLights(unsigned int count) {
+    if (count == m_maxLights)
+        return;
+
+    m_maxLights = count;
+    if (m_pointLights >= 0)
+        init(m_pointLights);
+}
+
+void ShadowAtlas::init(int pointLights) {
+    m_stats = ShadowAtlasStats();
+    m_stats.budget = m_budget;
+    m_pointLights = pointLights;
+
+    size_t budget = m_budget;
+    size_t lowest = slotBytes(SHADOW_TIER_COUNT - 1);
+    // Update never grants more than m_maxLights shadow maps, slots for the other lights would stay unused
+    int remaining = int(std::min<unsigned int>(pointLights, m_maxLights));
+
+    for (int tier = 0; tier < SHADOW_TIER_COUNT; tier++) {
+        size_t cost = slotBytes(tier);
+        size_t capacity = 0;
+        if (tier == SHADOW_TIER_COUNT - 1) {
+            capacity = std::min<size_t>(remaining, budget / cost);
+        } else {
+            // As many lights as possible in this tier, while the remaining lights still fit in the lowest tier
+            size_t reserve = remaining * lowest;
+            if (budget > reserve)
+                capacity = std::min<size_t>(remaining, (budget - reserve) / (cost - lowest));
+        }
+
+        m_slots[tier].assign(capacity, -1);
+        if (capacity > 0) {
+            m_textures[tier] = std::make_shared<Texture>();
+            m_textures[tier]->createDepthMapArray(resolution(tier), resolution(tier), capacity, false, tier);
+        } else {
+            m_textures[tier] = nullptr;
+        }
+
+        budget -= capacity * cost;
+        remaining -= capacity;
+        m_stats.capacity[tier] = capacity;
+        m_stats.bytesAllocated += capacity * cost;
+    }
+
+    if (remaining > 0)
+        std::cerr << "The shadow memory budget of " << m_budget / (1024 * 1024) << " MB leaves " << remaining
+                  << " point lights without shadows" << std::endl;
+
+    m_allocations.clear();
+    m_reallocated.clear();
+}
+
+void ShadowAtlas::update(const LightVector& lights, const Camera& camera) {
+    if (m_allocations.size() != lights.size()) {
+        ShadowAllocation none = {-1, -1};
+        m_allocations.assign(lights.size(), none);
+        for (int tier = 0; tier < SHADOW_TIER_COUNT; tier++)
+            std::fill(m_slots[tier].begin(), m_slots[tier].end(), -1);
+    }
+    m_reallocated.assign(lights.size(), false);
+    m_desiredTiers.assign(lights.size(), -1);
+
+    const Frustum frustum = camera.getFrustum();
+    const float tanHalfFov = glm::tan(glm::radians(camera.getFOV()) * 0.5f);
+
+    m_ranking.clear();
+    for (size_t i = 0; i < lights.size(); i++) {
+        const Light& light = *lights[i];
+        if (light.getPosition().w == 0 || !light.isEnabled() || light.getShadowPriority() == 0.0f)
+            continue;
+
+        glm::vec3 position = glm::vec3(light.getTransform() * light.getPosition());
+        // Shadows end at the far plane, however far the light reaches
+        float range = glm::min(light.getAttenuationRange(), POINT_SHADOW_FAR_PLANE);
+        float distance = glm::distance(position, camera.getPosition());
+
+        // A light around the camera ranks above any light seen from the outside, the closest first.
+        // Otherwise the importance is the radius of the lit sphere relative to half the screen height.
+        float importance = 0.0f;
+        if (distance < range)
+            importance = 2.0f - distance / range;
+        else if (frustum.intersect(position, range) != Frustum::OUTSIDE)
+            importance = glm::min(range / (distance * tanHalfFov), 1.0f);
+
+        // Of two lights covering the same part of the screen, the brighter one casts the more visible shadow
+        importance *= light.getIntensity() * light.getShadowPriority();
+
+        if (m_allocations[i].tier >= 0)
+            importance *= 1.0f + SHADOW_TIER_HYSTERESIS * (SHADOW_TIER_COUNT - m_allocations[i].tier);
+
+        m_ranking.push_back(std::make_pair(importance, int(i)));
+    }
+
+    std::sort(m_ranking.begin(), m_ranking.end(), [](const std::pair<float, int>& a, const std::pair<float, int>& b) {
+        if (a.first != b.first)
+            return a.first > b.first;
+        return a.second < b.second;
+    });
+
+    // The most important lights fill the highest tiers, lights past the limit are left without a shadow map
+    int tier = 0;
+    size_t used = 0;
+    unsigned int granted = 0;
+    for (auto& ranked : m_ranking) {
+        if (granted == m_maxLights)
+            break;
+
+        while (tier < SHADOW_TIER_COUNT && used == m_slots[tier].size()) {
+            tier++;
+            used = 0;
+        }
+        if (tier == SHADOW_TIER_COUNT)
+            break;
+
+        m_desiredTiers[ranked.second] = tier;
+        used++;
+        granted++;
+    }
+
+    // Slots are released before they are handed out again, lights staying in their tier keep their slot
+    for (size_t i = 0; i < lights.size(); i++) {
+        ShadowAllocation& allocation = m_allocations[i];
+        if (allocation.tier >= 0 && allocation.tier != m_desiredTiers[i]) {
+            m_slots[allocation.tier][allocation.slot] = -1;
+            allocation.tier = -1;
+            allocation.slot = -1;
+            m_reallocated[i] = true;
+        }
+    }
+
+    for (size_t i = 0; i < lights.size(); i++) {
+        ShadowAllocation& allocation = m_allocations[i];
+        int desired = m_desiredTiers[i];
+        if (desired < 0 || allocation.tier == desired)
+            continue;
+
+        std::vector<int>& slots = m_slots[desired];
+        allocation.tier = desired;
+        allocation.slot = std::find(slots.begin(), slots.end(), -1) - slots.begin();
+        slots[allocation.slot] = i;
+        m_reallocated[i] = true;
+    }
+
+    for (int t = 0; t < SHADOW_TIER_COUNT; t++)
+        m_stats.lights[t] = 0;
+    m_stats.unshadowed = 0;
+    m_stats.reallocated = 0;
+    m_stats.maxLights = m_maxLights;
+    for (size_t i = 0; i < lights.size(); i++) {
+        if (m_allocations[i].tier >= 0)
+            m_stats.lights[m_allocations[i].tier]++;
+        else if (lights[i]->getPosition().w != 0 && lights[i]->isEnabled())
+            m_stats.unshadowed++;
+        m_stats.reallocated += m_reallocated[i];
+    }
+}
+
+ShadowAllocation ShadowAtlas::getAllocation(size_t index) const {
+    if (index >= m_allocations.size()) {
+        ShadowAllocation none = {-1, -1};
+        return none;
+    }
+    return m_allocations[index];
+}
+
+void ShadowAtlas::apply(std::shared_ptr<Shader> shader) const {
+    // Every sampler gets its own slot even if the tier is empty, samplers of different types may not share a unit
+    for (int tier = 0; tier < SHADOW_TIER_COUNT; tier++) {
+        if (m_textures[tier])
+            m_textures[tier]->bind();
+        shader->setInt("pointShadowMaps[" + std::to_string(tier) + "]", DEPTH_MAP_POINT_ARRAY_SLOT + tier);
+    }
+}
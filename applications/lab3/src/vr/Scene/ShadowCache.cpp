@@ -0,0 +1,126 @@
+#include <vr/Frustum.h>
+#include <vr/Scene/ShadowCache.h>
+
+using namespace vr;
+
+ShadowCache::ShadowCache() : m_invalidated(true) {
+    m_stats = ShadowCacheStats();
+}
+
+void ShadowCache::invalidate() {
+    m_invalidated = true;
+}
+
+void ShadowCache::invalidate(size_t index) {
+    // The next update sees a different light and renders all faces
+    if (index < m_entries.size())
+        m_entries[index].light = nullptr;
+}
+
+int ShadowCache::overlappedFaces(const Light& light, const BoundingBox& box) const {
+    if (light.getPosition().w == 0) {
+        int mask = 0;
+        for (int i = 0; i < SHADOW_CASCADES; i++) {
+            if (Frustum(light.getCascadeMatrix(i)).intersect(box) != Frustum::OUTSIDE)
+                mask |= 1 << i;
+        }
+        return mask;
+    }
+
+    // Distance from the light to the closest point of the box
+    glm::vec3 position = glm::vec3(light.getTransform() * light.getPosition());
+    glm::vec3 closest = glm::clamp(position, box.min(), box.max());
+    if (glm::distance(position, closest) > glm::min(light.getAttenuationRange(), POINT_SHADOW_FAR_PLANE))
+        return 0;
+
+    int mask = 0;
+    for (int i = 0; i < 6; i++) {
+        if (Frustum(light.getShadowMatrix(i)).intersect(box) != Frustum::OUTSIDE)
+            mask |= 1 << i;
+    }
+    return mask;
+}
+
+void ShadowCache::update(const LightVector& lights, const RenderList& renderList, const Camera& camera) {
+    m_stats = ShadowCacheStats();
+
+    if (m_entries.size() != lights.size()) {
+        m_entries.resize(lights.size());
+        m_invalidated = true;
+    }
+
+    const std::vector<BoundingBox>& changedBounds = renderList.getChangedBounds();
+    const Frustum viewFrustum = camera.getFrustum();
+
+    for (size_t i = 0; i < lights.size(); i++) {
+        const Light& light = *lights[i];
+        Entry& entry = m_entries[i];
+        bool point = light.getPosition().w != 0;
+        int allFaces = point ? ALL_CUBE_FACES : ALL_CASCADES;
+
+        // A changed light is rendered completely, even if it is far away
+        bool lightChanged = m_invalidated || entry.light != &light || entry.version != light.version();
+        if (lightChanged) {
+            entry.light = &light;
+            entry.version = light.version();
+            entry.pending = allFaces;
+            entry.nextFace = 0;
+            entry.cascadeVersion = light.cascadeVersion();
+            for (int c = 0; c < SHADOW_CASCADES; c++)
+                entry.cascades[c] = light.getCascadeMatrix(c);
+        }
+
+        // Only the cascades that were refitted to the camera are rendered again
+        if (!point && entry.cascadeVersion != light.cascadeVersion()) {
+            entry.cascadeVersion = light.cascadeVersion();
+            for (int c = 0; c < SHADOW_CASCADES; c++) {
+                if (entry.cascades[c] != light.getCascadeMatrix(c)) {
+                    entry.cascades[c] = light.getCascadeMatrix(c);
+                    entry.pending |= 1 << c;
+                }
+            }
+        }
+
+        for (auto& box : changedBounds) {
+            if (entry.pending == allFaces)
+                break;
+            entry.pending |= overlappedFaces(light, box);
+        }
+
+        // Disabled lights keep their outdated faces until they are switched on again
+        entry.render = 0;
+        if (!light.isEnabled() || entry.pending == 0) {
+            if (light.isEnabled())
+                m_stats.lightsCached++;
+            continue;
+        }
+
+        glm::vec3 position = glm::vec3(light.getTransform() * light.getPosition());
+        float range = glm::min(light.getAttenuationRange(), POINT_SHADOW_FAR_PLANE);
+        bool distant = point && !lightChanged &&
+                       (viewFrustum.intersect(position, range) == Frustum::OUTSIDE ||
+                        glm::distance(position, camera.getPosition()) > SHADOW_DISTANT_RANGES * range);
+
+        if (distant) {
+            int start = entry.nextFace;
+            int rendered = 0;
+            for (int n = 0; n < 6 && rendered < SHADOW_FACES_PER_FRAME; n++) {
+                int face = (start + n) % 6;
+                if (entry.pending & (1 << face)) {
+                    entry.render |= 1 << face;
+                    entry.nextFace = (face + 1) % 6;
+                    rendered++;
+                }
+            }
+        } else {
+            entry.render = entry.pending;
+        }
+
+        entry.pending &= ~entry.render;
+        m_stats.lightsRendered++;
+        for (int f = 0; f < 6; f++)
+            m_stats.facesDeferred += (entry.pending >> f) & 1;
+    }
+
+    m_invalidated = false;
+}
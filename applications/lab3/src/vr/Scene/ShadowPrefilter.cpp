@@ -0,0 +1,83 @@
+#include <vr/Scene/ShadowPrefilter.h>
+
+using namespace vr;
+
+ShadowPrefilter::ShadowPrefilter() : m_layersFiltered(0) {
+    m_shader = std::make_shared<Shader>("shaders/shadow-prefilter.vs", "shaders/shadow-prefilter.fs");
+    m_sourceUniform = m_shader->uniform("source");
+    m_layerUniform = m_shader->uniform("layer");
+    m_verticalUniform = m_shader->uniform("vertical");
+    m_exponentUniform = m_shader->uniform("exponent");
+
+    glGenFramebuffers(1, &m_fbo);
+    // The full screen triangle has no vertex attributes, but drawing still needs a vertex array
+    glGenVertexArrays(1, &m_vao);
+
+    glGenSamplers(1, &m_sampler);
+    glSamplerParameteri(m_sampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glSamplerParameteri(m_sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glSamplerParameteri(m_sampler, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+}
+
+ShadowPrefilter::~ShadowPrefilter() {
+    glDeleteSamplers(1, &m_sampler);
+    glDeleteVertexArrays(1, &m_vao);
+    glDeleteFramebuffers(1, &m_fbo);
+}
+
+void ShadowPrefilter::init(int layers) {
+    if (layers == 0) {
+        m_texture = nullptr;
+        m_intermediate = nullptr;
+        return;
+    }
+
+    m_texture = std::make_shared<Texture>();
+    m_texture->createFilteredShadowMapArray(DEPTH_MAP_EXPONENTIAL_ARRAY_SLOT, DEPTH_MAP_RESOLUTION, DEPTH_MAP_RESOLUTION, layers);
+    m_intermediate = std::make_shared<Texture>();
+    m_intermediate->createFilteredShadowMapArray(SHADOW_FILTER_SLOT, DEPTH_MAP_RESOLUTION, DEPTH_MAP_RESOLUTION, 1);
+}
+
+void ShadowPrefilter::filter(const Texture& depthMaps, int layer) {
+    if (!m_texture)
+        return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, DEPTH_MAP_RESOLUTION, DEPTH_MAP_RESOLUTION);
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(m_vao);
+
+    m_shader->use();
+    m_exponentUniform.setFloat(ESM_EXPONENT);
+
+    // Horizontal pass, from the depth map into the intermediate layer
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_intermediate->id(), 0, 0);
+    glActiveTexture(GL_TEXTURE0 + depthMaps.slot());
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthMaps.id());
+    glBindSampler(depthMaps.slot(), m_sampler);
+    m_sourceUniform.setInt(depthMaps.slot());
+    m_layerUniform.setInt(layer);
+    m_verticalUniform.setBool(false);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindSampler(depthMaps.slot(), 0);
+
+    // Vertical pass, from the intermediate layer into the exponential shadow map
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_texture->id(), 0, layer);
+    m_intermediate->bind();
+    m_sourceUniform.setInt(m_intermediate->slot());
+    m_layerUniform.setInt(0);
+    m_verticalUniform.setBool(true);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+    m_layersFiltered++;
+}
+
+void ShadowPrefilter::apply(std::shared_ptr<Shader> shader) const {
+    // Set even when no light uses exponential shadow maps, so the sampler never stays on unit 0
+    if (m_texture)
+        m_texture->bind();
+    shader->setInt("directionalExponentialMaps", DEPTH_MAP_EXPONENTIAL_ARRAY_SLOT);
+    shader->setFloat("esmExponent", ESM_EXPONENT);
+}
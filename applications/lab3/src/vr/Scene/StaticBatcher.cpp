@@ -0,0 +1,174 @@
+#include <vr/Nodes/CameraNode.h>
+#include <vr/Nodes/LodNode.h>
+#include <vr/Nodes/Transform.h>
+#include <vr/Scene/StaticBatcher.h>
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+using namespace vr;
+
+StaticBatcher::StaticBatcher() {
+    m_stats = StaticBatchStats();
+}
+
+void StaticBatcher::batch(const std::shared_ptr<Group>& group, const std::shared_ptr<Shader>& shader) {
+    m_stats = StaticBatchStats();
+    m_batches.clear();
+    m_openBatches.clear();
+
+    // The state of the group itself stays on the group, above the merged geometries
+    NodeVector children = collect(group.get(), glm::mat4(1.0f), nullptr);
+
+    for (size_t i = 0; i < m_batches.size(); i++) {
+        Batch& batch = m_batches[i];
+        std::shared_ptr<Geometry> geometry = std::make_shared<Geometry>(batch.vertices, batch.normals, batch.texCoords, batch.tangents,
+                                                                        batch.bitangents, batch.indices,
+                                                                        group->getName() + " batch " + std::to_string(i));
+        geometry->setSubMeshes(batch.subMeshes);
+        geometry->initShader(shader);
+        geometry->upload();
+        if (batch.meshlets)
+            geometry->setMeshlets(true);
+        if (batch.state)
+            geometry->setState(batch.state);
+        children.push_back(geometry);
+    }
+
+    m_stats.batches = m_batches.size();
+    m_batches.clear();
+    m_openBatches.clear();
+
+    group->setChildren(children);
+}
+
+NodeVector StaticBatcher::collect(Group* group, const glm::mat4& transform, const std::shared_ptr<State>& state) {
+    NodeVector kept;
+
+    for (auto& child : group->getChildren()) {
+        // Subtrees that may change at runtime are kept whole, lights and cameras stay where they are
+        if (child->hasCallbacks() || std::dynamic_pointer_cast<LodNode>(child) || std::dynamic_pointer_cast<CameraNode>(child)) {
+            kept.push_back(child);
+            continue;
+        }
+
+        std::shared_ptr<State> childState = state;
+        if (child->hasState())
+            childState = state ? *state + *child->getState() : child->getState();
+
+        std::shared_ptr<Geometry> geometry = std::dynamic_pointer_cast<Geometry>(child);
+        if (geometry) {
+            // Geometries without normals are drawn as bounding boxes, and those have to follow the geometry
+            if (geometry->getNormals().empty() || geometry->getVertices().empty())
+                kept.push_back(child);
+            else
+                add(geometry.get(), transform * geometry->getObjectMatrix(), childState);
+            continue;
+        }
+
+        std::shared_ptr<Group> childGroup = std::dynamic_pointer_cast<Group>(child);
+        if (!childGroup) {
+            kept.push_back(child);
+            continue;
+        }
+
+        // A copy of the group keeps the children that were not merged, the group may be shared with other references
+        std::shared_ptr<Transform> childTransform = std::dynamic_pointer_cast<Transform>(child);
+        std::shared_ptr<Group> copy;
+        NodeVector children;
+        if (childTransform) {
+            children = collect(childGroup.get(), transform * childTransform->getMatrix(), childState);
+            std::shared_ptr<Transform> transformCopy = std::make_shared<Transform>(child->getName());
+            transformCopy->setMatrix(childTransform->getMatrix());
+            copy = transformCopy;
+        } else {
+            children = collect(childGroup.get(), transform, childState);
+            copy = std::make_shared<Group>(child->getName(), childGroup->isExcluded());
+        }
+
+        if (children.empty())
+            continue;
+
+        copy->setChildren(children);
+        if (child->hasState())
+            copy->setState(child->getState());
+        kept.push_back(copy);
+    }
+
+    return kept;
+}
+
+void StaticBatcher::add(Geometry* geometry, const glm::mat4& transform, const std::shared_ptr<State>& state) {
+    const std::vector<glm::vec4>& vertices = geometry->getVertices();
+    const std::vector<glm::vec3>& normals = geometry->getNormals();
+    const std::vector<glm::vec2>& texCoords = geometry->getTexCoords();
+    const std::vector<glm::vec3>& tangents = geometry->getTangents();
+    const std::vector<glm::vec3>& bitangents = geometry->getBitangents();
+
+    // Geometries drawn without indices get the indices of their triangle list
+    std::vector<GLuint> indices = geometry->getIndices();
+    if (indices.empty()) {
+        for (GLuint i = 0; i < vertices.size(); i++)
+            indices.push_back(i);
+    }
+
+    // Batches are closed when they are full, a state can have several
+    StateKey key = keyOf(state);
+    auto it = m_openBatches.find(key);
+    if (it == m_openBatches.end() || m_batches[it->second].vertices.size() + vertices.size() > STATIC_BATCH_MAX_VERTICES) {
+        Batch batch;
+        batch.state = state;
+        batch.meshlets = false;
+        m_openBatches[key] = m_batches.size();
+        m_batches.push_back(batch);
+    }
+    Batch& batch = m_batches[m_openBatches[key]];
+
+    // Normals follow the inverse transpose, tangents and bitangents lie in the surface and follow the matrix itself
+    glm::mat3 normalMatrix = glm::inverseTranspose(glm::mat3(transform));
+    glm::mat3 tangentMatrix = glm::mat3(transform);
+    GLuint base = GLuint(batch.vertices.size());
+
+    SubMesh subMesh;
+    subMesh.name = geometry->getName();
+    subMesh.firstIndex = GLuint(batch.indices.size());
+    subMesh.indexCount = GLuint(indices.size());
+
+    // Arrays a geometry does not have are filled with zeros, so the arrays of the batch stay aligned
+    for (size_t i = 0; i < vertices.size(); i++) {
+        batch.vertices.push_back(transform * vertices[i]);
+        batch.normals.push_back(normalMatrix * normals[i]);
+        batch.texCoords.push_back(i < texCoords.size() ? texCoords[i] : glm::vec2(0.0f));
+        batch.tangents.push_back(i < tangents.size() ? tangentMatrix * tangents[i] : glm::vec3(0.0f));
+        batch.bitangents.push_back(i < bitangents.size() ? tangentMatrix * bitangents[i] : glm::vec3(0.0f));
+        subMesh.bounds.expand(glm::vec3(batch.vertices.back()));
+    }
+
+    // A mirroring transform turns the triangles inside out, swapping two corners turns them back
+    bool mirrored = glm::determinant(tangentMatrix) < 0.0f && indices.size() % 3 == 0;
+    for (size_t i = 0; i < indices.size(); i++) {
+        size_t corner = i;
+        if (mirrored && i % 3 != 0)
+            corner = i % 3 == 1 ? i + 1 : i - 1;
+        batch.indices.push_back(base + indices[corner]);
+    }
+
+    batch.subMeshes.push_back(subMesh);
+    batch.meshlets = batch.meshlets || !geometry->getMeshlets().empty();
+    m_stats.geometries++;
+}
+
+StaticBatcher::StateKey StaticBatcher::keyOf(const std::shared_ptr<State>& state) {
+    if (!state)
+        return StateKey(nullptr, nullptr, std::vector<const Texture*>(), std::vector<const Light*>(), false, false, false);
+
+    std::vector<const Texture*> textures;
+    for (auto& texture : state->getTextures())
+        textures.push_back(texture.get());
+
+    std::vector<const Light*> lights;
+    for (auto& light : state->getLights())
+        lights.push_back(light.get());
+
+    return StateKey(state->getShader().get(), state->getMaterial().get(), textures, lights, state->CullFaceEnabled(),
+                    state->LightingEnabled(), state->ShadowEnabled());
+}
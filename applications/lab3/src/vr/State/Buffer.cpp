@@ -0,0 +1,57 @@
+#include <vr/State/Buffer.h>
+#include <vr/glErrorUtil.h>
+
+#include <iostream>
+
+using namespace vr;
+
+Buffer::Buffer(GLenum target, GLenum usage) : m_id(0), m_target(target), m_usage(usage), m_size(0), m_capacity(0) {
+    glGenBuffers(1, &m_id);
+}
+
+Buffer::~Buffer() {
+    if (m_id != 0) {
+        glDeleteBuffers(1, &m_id);
+        m_id = 0;
+    }
+}
+
+void Buffer::upload(const void* data, size_t size) {
+    glBindBuffer(m_target, m_id);
+
+    if (size > m_capacity) {
+        // Grow geometrically so a slowly increasing size does not reallocate every frame
+        m_capacity = m_capacity * 2 > size ? m_capacity * 2 : size;
+    }
+
+    glBufferData(m_target, m_capacity, nullptr, m_usage);
+    if (size > 0)
+        glBufferSubData(m_target, 0, size, data);
+    m_size = size;
+
+    CHECK_GL_ERROR_LINE_FILE();
+}
+
+void Buffer::update(size_t offset, const void* data, size_t size) {
+    if (offset + size > m_size) {
+        std::cerr << "Buffer update of " << size << " bytes at offset " << offset << " exceeds the buffer size " << m_size << std::endl;
+        return;
+    }
+
+    glBindBuffer(m_target, m_id);
+    glBufferSubData(m_target, offset, size, data);
+
+    CHECK_GL_ERROR_LINE_FILE();
+}
+
+void Buffer::bind() const {
+    glBindBuffer(m_target, m_id);
+}
+
+void Buffer::unbind() const {
+    glBindBuffer(m_target, 0);
+}
+
+void Buffer::bindBase(GLuint index) const {
+    glBindBufferBase(m_target, index, m_id);
+}
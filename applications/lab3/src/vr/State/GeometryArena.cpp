@@ -0,0 +1,184 @@
+#include <vr/State/GeometryArena.h>
+#include <vr/glErrorUtil.h>
+
+using namespace vr;
+
+GeometryArena& GeometryArena::instance() {
+    // Never deleted, the buffers would outlive the context when destroyed at exit
+    static GeometryArena* arena = new GeometryArena();
+    return *arena;
+}
+
+GeometryArena::GeometryArena() : m_drawIndices(GL_ARRAY_BUFFER, GL_STATIC_DRAW), m_drawIndexCount(0) {
+    reserveDrawIndices(1024);
+}
+
+void GeometryArena::addBlock(GLenum indexType) {
+    Block block;
+    block.indexType = indexType;
+    size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    glGenVertexArrays(1, &block.vao);
+    glBindVertexArray(block.vao);
+
+    glGenBuffers(1, &block.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, block.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(ARENA_BLOCK_VERTICES) * sizeof(PackedVertex), nullptr, GL_STATIC_DRAW);
+    setPackedVertexAttributes();
+
+    glGenBuffers(1, &block.indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, GLsizeiptr(ARENA_BLOCK_INDICES) * indexSize, nullptr, GL_STATIC_DRAW);
+
+    // The divisor is set by each indirect submission, one draw index per instance by default
+    m_drawIndices.bind();
+    glEnableVertexAttribArray(DRAW_INDEX_LOCATION);
+    glVertexAttribIPointer(DRAW_INDEX_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), nullptr);
+    glVertexAttribDivisor(DRAW_INDEX_LOCATION, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    CHECK_GL_ERROR_LINE_FILE();
+
+    Span vertices = {0, ARENA_BLOCK_VERTICES};
+    Span indices = {0, ARENA_BLOCK_INDICES};
+    block.freeVertices.push_back(vertices);
+    block.freeIndices.push_back(indices);
+    m_blocks.push_back(block);
+}
+
+bool GeometryArena::allocate(const std::vector<PackedVertex>& vertices, const std::vector<GLuint>& indices, ArenaRange& range) {
+    if (vertices.size() > ARENA_BLOCK_VERTICES || indices.size() > ARENA_BLOCK_INDICES)
+        return false;
+
+    GLuint vertexCount = GLuint(vertices.size());
+    GLuint indexCount = GLuint(indices.size());
+
+    GLenum indexType = GL_UNSIGNED_INT;
+    size_t indexSize = sizeof(GLuint);
+    const void* indexData = indices.data();
+    std::vector<GLushort> shortIndices;
+    if (vertices.size() <= ARENA_SHORT_INDEX_VERTICES) {
+        shortIndices.assign(indices.begin(), indices.end());
+        indexType = GL_UNSIGNED_SHORT;
+        indexSize = sizeof(GLushort);
+        indexData = shortIndices.data();
+    }
+
+    // First fit over the blocks of the index type, a new block is only added when none has room left
+    for (size_t i = 0; i <= m_blocks.size(); i++) {
+        if (i == m_blocks.size())
+            addBlock(indexType);
+
+        Block& block = m_blocks[i];
+        if (block.indexType != indexType)
+            continue;
+        GLuint firstVertex, firstIndex;
+        if (!take(block.freeVertices, vertexCount, firstVertex))
+            continue;
+        if (!take(block.freeIndices, indexCount, firstIndex)) {
+            give(block.freeVertices, firstVertex, vertexCount);
+            continue;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, block.vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, GLintptr(firstVertex) * sizeof(PackedVertex), vertices.size() * sizeof(PackedVertex),
+                        vertices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // Bound through GL_COPY_WRITE_BUFFER, binding GL_ELEMENT_ARRAY_BUFFER would change the bound vertex array object
+        glBindBuffer(GL_COPY_WRITE_BUFFER, block.indexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(firstIndex) * indexSize, indices.size() * indexSize, indexData);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        CHECK_GL_ERROR_LINE_FILE();
+
+        range.block = int(i);
+        range.firstVertex = firstVertex;
+        range.vertexCount = vertexCount;
+        range.firstIndex = firstIndex;
+        range.indexCount = indexCount;
+        return true;
+    }
+
+    return false;
+}
+
+void GeometryArena::free(ArenaRange& range) {
+    if (range.block < 0 || range.block >= int(m_blocks.size()))
+        return;
+
+    Block& block = m_blocks[range.block];
+    give(block.freeVertices, range.firstVertex, range.vertexCount);
+    give(block.freeIndices, range.firstIndex, range.indexCount);
+    range = ArenaRange();
+}
+
+void GeometryArena::bind(int block) const {
+    glBindVertexArray(m_blocks[block].vao);
+}
+
+void GeometryArena::drawRanges(const ArenaRange& range, const std::vector<GLsizei>& counts, const std::vector<const void*>& offsets) {
+    const Block& block = m_blocks[range.block];
+    size_t first = size_t(range.firstIndex) * (block.indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
+
+    m_rangeOffsets.resize(offsets.size());
+    m_rangeBaseVertices.assign(offsets.size(), GLint(range.firstVertex));
+    for (size_t i = 0; i < offsets.size(); i++)
+        m_rangeOffsets[i] = (const char*)offsets[i] + first;
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), block.indexType, m_rangeOffsets.data(), GLsizei(offsets.size()),
+                                  m_rangeBaseVertices.data());
+}
+
+void GeometryArena::reserveDrawIndices(size_t count) {
+    if (count <= m_drawIndexCount)
+        return;
+
+    // The buffer keeps its name when it grows, so the vertex array objects still read it
+    size_t size = m_drawIndexCount == 0 ? count : m_drawIndexCount;
+    while (size < count)
+        size *= 2;
+
+    std::vector<GLuint> drawIndices(size);
+    for (size_t i = 0; i < size; i++)
+        drawIndices[i] = GLuint(i);
+    m_drawIndices.upload(drawIndices.data(), drawIndices.size() * sizeof(GLuint));
+    m_drawIndices.unbind();
+    m_drawIndexCount = size;
+}
+
+bool GeometryArena::take(std::vector<Span>& spans, GLuint count, GLuint& first) {
+    for (size_t i = 0; i < spans.size(); i++) {
+        if (spans[i].count < count)
+            continue;
+
+        first = spans[i].first;
+        spans[i].first += count;
+        spans[i].count -= count;
+        if (spans[i].count == 0)
+            spans.erase(spans.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+void GeometryArena::give(std::vector<Span>& spans, GLuint first, GLuint count) {
+    if (count == 0)
+        return;
+
+    size_t i = 0;
+    while (i < spans.size() && spans[i].first < first)
+        i++;
+
+    Span span = {first, count};
+    spans.insert(spans.begin() + i, span);
+
+    // Merge with the following run, then with the preceding one
+    if (i + 1 < spans.size() && spans[i].first + spans[i].count == spans[i + 1].first) {
+        spans[i].count += spans[i + 1].count;
+        spans.erase(spans.begin() + i + 1);
+    }
+    if (i > 0 && spans[i - 1].first + spans[i - 1].count == spans[i].first) {
+        spans[i - 1].count += spans[i].count;
+        spans.erase(spans.begin() + i);
+    }
+}
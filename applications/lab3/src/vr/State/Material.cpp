@@ -14,8 +14,19 @@
 
 using namespace vr;
 
+// Names of the material uniforms
+namespace {
+const std::string AMBIENT_UNIFORM = "material.ambient";
+const std::string SPECULAR_UNIFORM = "material.specular";
+const std::string DIFFUSE_UNIFORM = "material.diffuse";
+const std::string EMISSION_UNIFORM = "material.emission";
+const std::string SHININESS_UNIFORM = "material.shininess";
+const std::string TEXTURES_UNIFORM = "material.textures";
+const std::string ACTIVE_TEXTURES_UNIFORM = "material.activeTextures";
+}  // namespace
+
 /// Simple class for storing material properties
-Material::Material() : m_shininess(32) {
+Material::Material() : m_shininess(32), m_version(0) {
     m_ambient = glm::vec4(0.0, 0.0, 0.0, 1.0);
     m_diffuse = glm::vec4(0.8, 0.8, 0.8, 1.0);
     m_specular = glm::vec4(1.0, 1.0, 1.0, 1.0);
@@ -28,46 +39,86 @@ glm::vec4 Material::getAmbient() const { return m_ambient; }
 glm::vec4 Material::getSpecular() const { return m_specular; }
 glm::vec4 Material::getDiffuse() const { return m_diffuse; }
 
-void Material::setAmbient(const glm::vec4& color) { m_ambient = color; }
-void Material::setSpecular(const glm::vec4& color) { m_specular = color; }
-void Material::setDiffuse(const glm::vec4& color) { m_diffuse = color; }
-void Material::setShininess(float s) { m_shininess = s; }
-void Material::setEmission(const glm::vec4& color) { m_emission = color; }
+void Material::setAmbient(const glm::vec4& color) {
+    m_ambient = color;
+    m_version++;
+}
+
+void Material::setSpecular(const glm::vec4& color) {
+    m_specular = color;
+    m_version++;
+}
+
+void Material::setDiffuse(const glm::vec4& color) {
+    m_diffuse = color;
+    m_version++;
+}
+
+void Material::setShininess(float s) {
+    m_shininess = s;
+    m_version++;
+}
+
+void Material::setEmission(const glm::vec4& color) {
+    m_emission = color;
+    m_version++;
+}
 
 void Material::apply(std::shared_ptr<vr::Shader> shader) {
     GLint loc = 0;
     int i = 0;
 
-    shader->setVec4("material.ambient", m_ambient);
-    shader->setVec4("material.specular", m_specular);
-    shader->setVec4("material.diffuse", m_diffuse);
-    shader->setVec4("material.emission", m_emission);
-    shader->setFloat("material.shininess", m_shininess);
-
-    std::vector<int> slotActive;
-    std::vector<int> slots;
-    if (m_textures.size() != 0) {
-        slotActive.resize(m_textures.size());
-        slots.resize(m_textures.size());
-        for (int i = 0; i < m_textures.size(); i++) {
-            slots[i] = MATERIAL_TEXTURES_BASE_SLOT + i;
-            slotActive[i] = m_textures[i] != nullptr;
-            if (m_textures[i])
-                m_textures[i]->bind();
-        }
-
-    } else {
-        std::vector<int> slotActive;
-        slotActive.resize(m_textures.size());
-        for (int i = 0; i < m_textures.size(); i++) {
-            slotActive[i] = 0;
-        }
+    shader->setVec4(AMBIENT_UNIFORM, m_ambient);
+    shader->setVec4(SPECULAR_UNIFORM, m_specular);
+    shader->setVec4(DIFFUSE_UNIFORM, m_diffuse);
+    shader->setVec4(EMISSION_UNIFORM, m_emission);
+    shader->setFloat(SHININESS_UNIFORM, m_shininess);
+
+    // The material always has MAX_MATERIAL_TEXTURES texture units, some of which may be empty
+    int slotActive[MAX_MATERIAL_TEXTURES];
+    int slots[MAX_MATERIAL_TEXTURES];
+    for (int i = 0; i < MAX_MATERIAL_TEXTURES; i++) {
+        slots[i] = MATERIAL_TEXTURES_BASE_SLOT + i;
+        slotActive[i] = m_textures[i] != nullptr;
+        if (m_textures[i])
+            m_textures[i]->bind();
+    }
+
+    shader->setIntArray(TEXTURES_UNIFORM, slots, MAX_MATERIAL_TEXTURES);
+    shader->setIntArray(ACTIVE_TEXTURES_UNIFORM, slotActive, MAX_MATERIAL_TEXTURES);
+}
+
+void Material::bindTextures() {
+    for (auto& texture : m_textures) {
+        if (texture)
+            texture->bind();
     }
+}
 
-    shader->setIntVector("material.textures", slots);
-    shader->setIntVector("material.activeTextures", slotActive);
+bool Material::hasTextures() const {
+    for (auto& texture : m_textures) {
+        if (texture)
+            return true;
+    }
+    return false;
+}
+
+void Material::pack(MaterialData& data) const {
+    data.ambient = m_ambient;
+    data.diffuse = m_diffuse;
+    data.specular = m_specular;
+    data.emission = m_emission;
+    data.shininess = m_shininess;
+    data.activeTextures = 0;
+    for (int i = 0; i < MAX_MATERIAL_TEXTURES; i++) {
+        if (m_textures[i])
+            data.activeTextures |= 1 << i;
+    }
+    data.padding[0] = 0;
+    data.padding[1] = 0;
 }
 
 void Material::setTexture(std::shared_ptr<vr::Texture> texture, unsigned int unit) {
     m_textures[unit] = texture;
+    m_version++;
 }
@@ -39,7 +39,7 @@ int Shader::createShader(const GLchar* source, GLenum shader_type, const char* d
     return vertex;
 }
 
-Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath) : m_valid(true) {
+Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::string& geometryPath) : m_valid(true), m_instanced(false), m_cameraBlock(false), m_materialTable(false), m_packedVertices(false), m_indirect(false) {
     // 1. retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
@@ -85,6 +85,27 @@ Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, c
         glAttachShader(m_programID, geometry);
     glLinkProgram(m_programID);
     checkCompileErrors(m_programID, "PROGRAM");
+    reflectUniforms();
+
+    // Shaders written before instancing, e.g. custom shaders from scene files, are drawn one geometry at a time
+    m_instanced = glGetAttribLocation(m_programID, "instance_m") == INSTANCE_MATRIX_LOCATION &&
+                  m_locations.find("instanced") != m_locations.end();
+
+    // GLSL 4.10 can not declare the binding of a block, so it is assigned here
+    GLuint cameraBlock = glGetUniformBlockIndex(m_programID, "CameraBlock");
+    if (cameraBlock != GL_INVALID_INDEX) {
+        glUniformBlockBinding(m_programID, cameraBlock, CAMERA_BLOCK_BINDING);
+        m_cameraBlock = true;
+    }
+
+    m_packedVertices = m_locations.find("positionScale") != m_locations.end();
+
+    m_materialTable = glGetProgramResourceIndex(m_programID, GL_SHADER_STORAGE_BLOCK, "MaterialBuffer") != GL_INVALID_INDEX &&
+                      m_locations.find("materialIndex") != m_locations.end();
+
+    m_indirect = glGetAttribLocation(m_programID, "draw_index") == DRAW_INDEX_LOCATION &&
+                 glGetProgramResourceIndex(m_programID, GL_SHADER_STORAGE_BLOCK, "DrawBuffer") != GL_INVALID_INDEX &&
+                 m_locations.find("indirect") != m_locations.end();
 
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
@@ -93,73 +114,178 @@ Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, c
         glDeleteShader(geometry);
 }
 
-void Shader::use() {
-    GLint prog = 0;
-    glGetIntegerv(GL_CURRENT_PROGRAM, &prog);
+GLuint Shader::s_currentProgram = 0;
+unsigned int Shader::s_programBinds = 0;
+unsigned int Shader::s_uniformUploads = 0;
 
-    if (prog != m_programID)
+void Shader::use() {
+    // All programs are bound through this function, so the last bound one is still current
+    if (s_currentProgram != m_programID) {
         glUseProgram(m_programID);
+        s_currentProgram = m_programID;
+        s_programBinds++;
+    }
 }
 
-GLint getLocation(GLuint program, const char* name) {
-    auto loc = glGetUniformLocation(program, name);
-    if (loc == -1) {
-        std::cerr << "Could not bind uniform " << name << std::endl;
+void Shader::resetStatistics() {
+    s_programBinds = 0;
+    s_uniformUploads = 0;
+}
+
+void Shader::reflectUniforms() {
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(m_programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<GLchar> buffer(maxLength + 1);
+    for (GLint i = 0; i < count; i++) {
+        GLint size = 0;
+        GLenum type = 0;
+        GLsizei length = 0;
+        glGetActiveUniform(m_programID, i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+
+        // Members of uniform blocks have no location
+        GLint location = glGetUniformLocation(m_programID, name.c_str());
+        if (location == -1)
+            continue;
+        m_locations[name] = location;
+
+        // Arrays of basic types are reported once as "name[0]", the other elements are looked up here
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            std::string base = name.substr(0, name.size() - 3);
+            m_locations[base] = location;
+            for (GLint element = 1; element < size; element++) {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                m_locations[elementName] = glGetUniformLocation(m_programID, elementName.c_str());
+            }
+        }
     }
-    return loc;
+}
+
+GLint Shader::findLocation(const std::string& name) const {
+    auto it = m_locations.find(name);
+    if (it != m_locations.end())
+        return it->second;
+
+    std::cerr << "Could not bind uniform " << name << std::endl;
+    m_locations[name] = -1;
+    return -1;
+}
+
+GLint Shader::getLocation(const std::string& name) const {
+    s_uniformUploads++;
+    return findLocation(name);
+}
+
+Uniform Shader::uniform(const std::string& name) const {
+    return Uniform(*this, name);
+}
+
+Uniform::Uniform(const Shader& shader, const std::string& name) : m_location(shader.findLocation(name)) {
+}
+
+void Uniform::setBool(bool value) const {
+    Shader::s_uniformUploads++;
+    glUniform1i(m_location, (int)value);
+}
+
+void Uniform::setInt(int value) const {
+    Shader::s_uniformUploads++;
+    glUniform1i(m_location, value);
+}
+
+void Uniform::setFloat(float value) const {
+    Shader::s_uniformUploads++;
+    glUniform1f(m_location, value);
+}
+
+void Uniform::setVec2(const glm::vec2& value) const {
+    Shader::s_uniformUploads++;
+    glUniform2fv(m_location, 1, &value[0]);
+}
+
+void Uniform::setVec3(const glm::vec3& value) const {
+    Shader::s_uniformUploads++;
+    glUniform3fv(m_location, 1, &value[0]);
+}
+
+void Uniform::setVec4(const glm::vec4& value) const {
+    Shader::s_uniformUploads++;
+    glUniform4fv(m_location, 1, &value[0]);
+}
+
+void Uniform::setMat3(const glm::mat3& mat) const {
+    Shader::s_uniformUploads++;
+    glUniformMatrix3fv(m_location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Uniform::setMat4(const glm::mat4& mat) const {
+    Shader::s_uniformUploads++;
+    glUniformMatrix4fv(m_location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Uniform::setIntArray(const int* values, int count) const {
+    Shader::s_uniformUploads++;
+    glUniform1iv(m_location, (GLsizei)count, values);
 }
 
 void Shader::setBool(const std::string& name, bool value) const {
-    glUniform1i(getLocation(m_programID, name.c_str()), (int)value);
+    glUniform1i(getLocation(name), (int)value);
 }
 
 void Shader::setInt(const std::string& name, int value) const {
-    glUniform1i(getLocation(m_programID, name.c_str()), value);
+    glUniform1i(getLocation(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const {
-    glUniform1f(getLocation(m_programID, name.c_str()), value);
+    glUniform1f(getLocation(name), value);
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const {
-    glUniform2fv(getLocation(m_programID, name.c_str()), 1, &value[0]);
+    glUniform2fv(getLocation(name), 1, &value[0]);
 }
 
 void Shader::setVec2(const std::string& name, float x, float y) const {
-    glUniform2f(getLocation(m_programID, name.c_str()), x, y);
+    glUniform2f(getLocation(name), x, y);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
-    glUniform3fv(getLocation(m_programID, name.c_str()), 1, &value[0]);
+    glUniform3fv(getLocation(name), 1, &value[0]);
 }
 
 void Shader::setVec3(const std::string& name, float x, float y, float z) const {
-    glUniform3f(getLocation(m_programID, name.c_str()), x, y, z);
+    glUniform3f(getLocation(name), x, y, z);
 }
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const {
-    glUniform4fv(getLocation(m_programID, name.c_str()), 1, &value[0]);
+    glUniform4fv(getLocation(name), 1, &value[0]);
 }
 
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w) {
-    glUniform4f(getLocation(m_programID, name.c_str()), x, y, z, w);
+    glUniform4f(getLocation(name), x, y, z, w);
 }
 
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const {
-    glUniformMatrix2fv(getLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const {
-    glUniformMatrix3fv(getLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
-    glUniformMatrix4fv(getLocation(m_programID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(getLocation(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setIntVector(const std::string& name, const std::vector<int>& vector) {
-    auto loc = getLocation(m_programID, name.c_str());
-    glUniform1iv(loc, (GLsizei)vector.size(), vector.data());
+    setIntArray(name, vector.data(), (int)vector.size());
+}
+
+void Shader::setIntArray(const std::string& name, const int* values, int count) {
+    auto loc = getLocation(name);
+    glUniform1iv(loc, (GLsizei)count, values);
 }
 
 bool Shader::valid() const {
@@ -5,91 +5,55 @@
 // clang-format off
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <iostream>
 
 using namespace vr;
 
+// Names of the texture layer uniforms, so applying the textures does not build strings
+namespace {
+const std::string PROCEDURAL_UNIFORM = "textureLayers.procedural";
+const std::string ANIMATED_UNIFORM = "textureLayers.animated";
+const std::string TIME_UNIFORM = "textureLayers.time";
+const std::string PROCEDURAL_TYPE_UNIFORM = "textureLayers.proceduralType";
+const std::string TEXTURES_UNIFORM = "textureLayers.textures";
+const std::string ACTIVE_TEXTURES_UNIFORM = "textureLayers.activeTextures";
+}  // namespace
+
+unsigned int State::s_changeCount = 0;
+
 // Parent state + child state = new state
 std::shared_ptr<State> State::operator+(const State& childState) const {
     std::shared_ptr<State> newState = std::make_shared<State>();
-    // Child state has precedence. If child state has a value, use it. Otherwise, use parent state's value.
-    if (childState.shadowEnabled != -1) {
-        newState->shadowEnabled = childState.shadowEnabled;
-    } else {
-        newState->shadowEnabled = shadowEnabled;
-    }
-
-    if (childState.lightingEnabled != -1) {
-        newState->lightingEnabled = childState.lightingEnabled;
-    } else {
-        newState->lightingEnabled = lightingEnabled;
-    }
-
-    if (childState.cullFaceEnabled != -1) {
-        newState->cullFaceEnabled = childState.cullFaceEnabled;
-    } else {
-        newState->cullFaceEnabled = cullFaceEnabled;
-    }
-
-    if (childState.m_shader != nullptr) {
-        newState->setShader(childState.m_shader);
-    } else {
-        newState->setShader(m_shader);
-    }
-
-    if (!childState.m_lights.empty()) {
-        newState->m_lights = childState.m_lights;
-    } else {
-        newState->m_lights = m_lights;
-    }
-
-    if (childState.m_material != nullptr) {
-        newState->m_material = childState.m_material;
-    } else {
-        newState->m_material = m_material;
-    }
-
-    if (!childState.m_textures.empty()) {
-        newState->m_textures = childState.m_textures;
-    } else {
-        newState->m_textures = m_textures;
-    }
-
+    newState->combine(*this, childState);
     return newState;
 }
 
 State& State::operator+=(const State& other) {
-    if (other.lightingEnabled != -1) {
-        lightingEnabled = other.lightingEnabled;
-    }
-
-    if (other.cullFaceEnabled != -1) {
-        cullFaceEnabled = other.cullFaceEnabled;
-    }
-
-    if (other.m_shader != nullptr) {
-        m_shader = other.m_shader;
-    } else {
-        m_shader = m_shader;
-    }
+    combine(*this, other);
+    return *this;
+}
 
-    if (!other.m_lights.empty()) {
-        m_lights = other.m_lights;
-    }
+void State::combine(const State& parent, const State& child) {
+    // Child state has precedence. If child state has a value, use it. Otherwise, use parent state's value.
+    // Parent may be this state, so every member is only assigned once.
+    shadowEnabled = child.shadowEnabled != -1 ? child.shadowEnabled : parent.shadowEnabled;
+    lightingEnabled = child.lightingEnabled != -1 ? child.lightingEnabled : parent.lightingEnabled;
+    cullFaceEnabled = child.cullFaceEnabled != -1 ? child.cullFaceEnabled : parent.cullFaceEnabled;
 
-    if (other.m_material != nullptr) {
-        m_material = other.m_material;
-    }
+    m_shader = child.m_shader != nullptr ? child.m_shader : parent.m_shader;
+    m_material = child.m_material != nullptr ? child.m_material : parent.m_material;
 
-    if (other.m_textures.empty()) {
-        m_textures = other.m_textures;
-    }
+    // Assigning vectors reuses their capacity
+    m_lights = !child.m_lights.empty() ? child.m_lights : parent.m_lights;
+    m_textures = !child.m_textures.empty() ? child.m_textures : parent.m_textures;
 
-    return *this;
+    m_version++;
 }
 
 void State::setLightingEnabled(bool enabled) {
     lightingEnabled = enabled;
+    changed();
 }
 
 bool State::LightingEnabled() {
@@ -98,6 +62,7 @@ bool State::LightingEnabled() {
 
 void State::setCullFaceEnabled(bool enabled) {
     cullFaceEnabled = enabled;
+    changed();
 }
 
 bool State::CullFaceEnabled() {
@@ -106,6 +71,7 @@ bool State::CullFaceEnabled() {
 
 void State::addLight(std::shared_ptr<Light> light) {
     m_lights.push_back(light);
+    changed();
 }
 
 void State::setLightEnabled(size_t idx, bool enabled) {
@@ -118,10 +84,12 @@ LightVector const State::getLights() {
 
 void State::setLights(LightVector lights) {
     m_lights = lights;
+    changed();
 }
 
 void State::setMaterial(std::shared_ptr<Material> material) {
     m_material = material;
+    changed();
 }
 
 TextureVector const State::getTextures() {
@@ -130,6 +98,7 @@ TextureVector const State::getTextures() {
 
 void State::addTexture(std::shared_ptr<Texture> texture) {
     m_textures.push_back(texture);
+    changed();
 }
 
 std::shared_ptr<Material> const State::getMaterial() {
@@ -138,6 +107,7 @@ std::shared_ptr<Material> const State::getMaterial() {
 
 void State::setShader(std::shared_ptr<Shader> shader) {
     m_shader = shader;
+    changed();
 }
 
 std::shared_ptr<Shader> const& State::getShader() {
@@ -146,6 +116,7 @@ std::shared_ptr<Shader> const& State::getShader() {
 
 void State::setShadowEnabled(bool enabled) {
     shadowEnabled = enabled;
+    changed();
 }
 
 bool State::ShadowEnabled() {
@@ -157,28 +128,41 @@ void State::apply() {
         return;
 
     m_shader->use();
+    applyMaterial();
+    applyCullFace();
+    applyTextures();
+}
 
-    if (m_material != nullptr)
-        m_material->apply(m_shader);
-
+void State::applyCullFace() {
     if (cullFaceEnabled) {
         glEnable(GL_CULL_FACE);
     } else {
         glDisable(GL_CULL_FACE);
     }
+}
+
+void State::applyMaterial() {
+    if (m_material != nullptr)
+        m_material->apply(m_shader);
+}
+
+void State::applyTextures() {
+    // Fixed size arrays, the state is applied every time it changes during a frame
+    int slotActive[MAX_TEXTURES] = {0};
+    int slots[MAX_TEXTURES] = {0};
+
+    if (m_textures.size() > MAX_TEXTURES)
+        std::cerr << "State has " << m_textures.size() << " textures, only " << MAX_TEXTURES << " are used" << std::endl;
 
-    std::vector<int> slotActive;
-    std::vector<int> slots;
-    slotActive.resize(m_textures.size());
-    slots.resize(m_textures.size());
-    if (m_textures.size() != 0) {
-        for (int i = 0; i < m_textures.size(); i++) {
-            m_shader->setBool("textureLayers.procedural", m_textures[i]->isProcedural());
+    int count = std::min<int>(m_textures.size(), MAX_TEXTURES);
+    if (count != 0) {
+        for (int i = 0; i < count; i++) {
+            m_shader->setBool(PROCEDURAL_UNIFORM, m_textures[i]->isProcedural());
             if (m_textures[i]->isProcedural()) {
-                m_shader->setBool("textureLayers.animated", m_textures[i]->isAnimated());
-                m_shader->setFloat("textureLayers.time", glfwGetTime());
+                m_shader->setBool(ANIMATED_UNIFORM, m_textures[i]->isAnimated());
+                m_shader->setFloat(TIME_UNIFORM, glfwGetTime());
             
-                m_shader->setInt("textureLayers.proceduralType", m_textures[i]->proceduralType());
+                m_shader->setInt(PROCEDURAL_TYPE_UNIFORM, m_textures[i]->proceduralType());
                 
                 slotActive[i] = 1;
             } else {
@@ -189,15 +173,9 @@ void State::apply() {
             }
         }
 
-        m_shader->setIntVector("textureLayers.textures", slots);
-        m_shader->setIntVector("textureLayers.activeTextures", slotActive);
+        m_shader->setIntArray(TEXTURES_UNIFORM, slots, count);
+        m_shader->setIntArray(ACTIVE_TEXTURES_UNIFORM, slotActive, count);
     } else {
-        std::vector<int> slotActive;
-        slotActive.resize(MAX_TEXTURES);
-
-        for (int i = 0; i < MAX_TEXTURES; i++) {
-            slotActive[i] = 0;
-        }
-        m_shader->setIntVector("textureLayers.activeTextures", slotActive);
+        m_shader->setIntArray(ACTIVE_TEXTURES_UNIFORM, slotActive, MAX_TEXTURES);
     }
-}
\ No newline at end of file
+}
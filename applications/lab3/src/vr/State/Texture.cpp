@@ -155,7 +155,7 @@ bool Texture::createFramebufferTexture(unsigned int slot, unsigned int width, un
     return true;
 }
 
-void Texture::createDepthMapArray(unsigned int width, unsigned int height, int numberOfLights, bool isDirectional) {
+void Texture::createDepthMapArray(unsigned int width, unsigned int height, int numberOfLights, bool isDirectional, int tier) {
     if (m_valid)
         cleanup();
 
@@ -163,23 +163,27 @@ void Texture::createDepthMapArray(unsigned int width, unsigned int height, int n
 
     glGenTextures(1, &m_id);
 
-    m_textureSlot = isDirectional ? DEPTH_MAP_DIRECTIONAL_ARRAY_SLOT : DEPTH_MAP_POINT_ARRAY_SLOT;
+    m_textureSlot = isDirectional ? DEPTH_MAP_DIRECTIONAL_ARRAY_SLOT : DEPTH_MAP_POINT_ARRAY_SLOT + tier;
 
     glActiveTexture(GL_TEXTURE0 + m_textureSlot);
     glBindTexture(m_type, m_id);
 
-    m_texFormat = GL_DEPTH_COMPONENT;
+    // Sized, so the memory used by the shadow maps is known
+    m_texFormat = GL_DEPTH_COMPONENT32F;
     m_pixelType = GL_FLOAT;
 
     if (isDirectional)
-        glTexImage3D(m_type, 0, m_texFormat, width, height, numberOfLights, 0, GL_DEPTH_COMPONENT, m_pixelType, NULL);
+        glTexImage3D(m_type, 0, m_texFormat, width, height, SHADOW_CASCADES * numberOfLights, 0, GL_DEPTH_COMPONENT, m_pixelType, NULL);
     else
         glTexImage3D(m_type, 0, m_texFormat, width, height, 6 * numberOfLights, 0, GL_DEPTH_COMPONENT, m_pixelType, NULL);
 
     CHECK_GL_ERROR_LINE_FILE();
 
-    glTexParameteri(m_type, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(m_type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // Sampled with shadow samplers, every fetch compares four texels in hardware and filters the results
+    glTexParameteri(m_type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(m_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(m_type, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(m_type, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 
     if (isDirectional) {
         glTexParameteri(m_type, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -199,6 +203,35 @@ void Texture::createDepthMapArray(unsigned int width, unsigned int height, int n
     m_valid = true;
 }
 
+void Texture::createFilteredShadowMapArray(unsigned int slot, unsigned int width, unsigned int height, int layers) {
+    if (m_valid)
+        cleanup();
+
+    m_type = GL_TEXTURE_2D_ARRAY;
+    m_textureSlot = slot;
+
+    glGenTextures(1, &m_id);
+
+    glActiveTexture(GL_TEXTURE0 + m_textureSlot);
+    glBindTexture(m_type, m_id);
+
+    m_texFormat = GL_R32F;
+    m_pixelType = GL_FLOAT;
+    glTexImage3D(m_type, 0, m_texFormat, width, height, layers, 0, GL_RED, m_pixelType, NULL);
+
+    CHECK_GL_ERROR_LINE_FILE();
+
+    glTexParameteri(m_type, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(m_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(m_type, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(m_type, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    CHECK_GL_ERROR_LINE_FILE();
+
+    glBindTexture(m_type, 0);
+    m_valid = true;
+}
+
 void Texture::createNoiseTexture(unsigned int width, unsigned int height, std::vector<glm::vec3> noise) {
     if (m_valid)
         cleanup();
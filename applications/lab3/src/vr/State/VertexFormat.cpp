@@ -0,0 +1,63 @@
+#include <vr/State/VertexFormat.h>
+
+// glm copies its vector types with memcpy in packing.inl, which GCC 8 and later warn about
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wclass-memaccess"
+#endif
+#include <glm/gtc/packing.hpp>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+using namespace vr;
+
+void vr::setPackedVertexAttributes() {
+    for (size_t i = 0; i < PACKED_VERTEX_ATTRIBUTES; i++) {
+        const VertexAttribute& attribute = PACKED_VERTEX_LAYOUT[i];
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, sizeof(PackedVertex),
+                              (const void*)attribute.offset);
+    }
+}
+
+glm::vec2 vr::octahedralEncode(const glm::vec3& n) {
+    // Project onto the octahedron |x| + |y| + |z| = 1, and fold the lower half over the diagonals
+    glm::vec2 p = glm::vec2(n) / (glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z));
+    if (n.z < 0.0f) {
+        glm::vec2 folded = 1.0f - glm::abs(glm::vec2(p.y, p.x));
+        p = glm::vec2(p.x >= 0.0f ? folded.x : -folded.x, p.y >= 0.0f ? folded.y : -folded.y);
+    }
+    return p;
+}
+
+PackedVertex vr::packVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texCoord, const glm::vec3& tangent,
+                            const glm::vec3& bitangent, const BoundingBox& bounds) {
+    PackedVertex vertex;
+
+    // Flat geometries have no extent along one axis, their positions along it are all the minimum
+    glm::vec3 extent = bounds.max() - bounds.min();
+    glm::vec3 relative = position - bounds.min();
+    for (int i = 0; i < 3; i++)
+        vertex.position[i] = glm::packUnorm1x16(extent[i] > 0.0f ? relative[i] / extent[i] : 0.0f);
+
+    glm::vec3 n = glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0, 0, 1);
+
+    // Meshes without texture coordinates have no tangents, any direction in the surface will do
+    glm::vec3 t = tangent - n * glm::dot(n, tangent);
+    if (glm::length(t) < 1e-6f)
+        t = glm::cross(n, glm::abs(n.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0));
+    t = glm::normalize(t);
+
+    vertex.position[3] = glm::dot(glm::cross(n, t), bitangent) < 0.0f ? 0 : 65535;
+
+    glm::vec2 encodedNormal = octahedralEncode(n);
+    glm::vec2 encodedTangent = octahedralEncode(t);
+    for (int i = 0; i < 2; i++) {
+        vertex.normal[i] = GLshort(glm::packSnorm1x16(encodedNormal[i]));
+        vertex.tangent[i] = GLshort(glm::packSnorm1x16(encodedTangent[i]));
+        vertex.texCoord[i] = glm::packHalf1x16(texCoord[i]);
+    }
+
+    return vertex;
+}
@@ -0,0 +1,164 @@
+#include <vr/Callbacks/UpdateCallback.h>
+#include <vr/Nodes/CameraNode.h>
+#include <vr/Nodes/Geometry.h>
+#include <vr/Nodes/Group.h>
+#include <vr/Nodes/LightNode.h>
+#include <vr/Nodes/LodNode.h>
+#include <vr/Nodes/Transform.h>
+#include <vr/Visitors/CompileVisitor.h>
+
+#include <iostream>
+
+using namespace vr;
+
+CompileVisitor::CompileVisitor() : m_renderList(nullptr), m_graphVersion(0), m_stateChangeCount(0) {
+    m_transformStack.push(nullptr);
+    m_lodStack.push(-1);
+}
+
+void CompileVisitor::compile(Group* root, RenderList& renderList) {
+    m_renderList = &renderList;
+    m_renderList->clear();
+
+    // Pairs cached for the previous graph may no longer be used, so they are only kept while the structure is unchanged
+    if (m_graphVersion != Node::graphVersion()) {
+        m_combinedStates.clear();
+        m_combinedIndices.clear();
+        m_graphVersion = Node::graphVersion();
+    }
+
+    root->accept(*this);
+
+    m_stateChangeCount = State::changeCount();
+    m_renderList->setCompiled();
+    m_renderList = nullptr;
+}
+
+bool CompileVisitor::statesChanged() const {
+    return m_stateChangeCount != State::changeCount();
+}
+
+void CompileVisitor::updateStates() {
+    for (auto& combined : m_combinedStates) {
+        if (combined.parent->version() == combined.parentVersion && combined.child->version() == combined.childVersion)
+            continue;
+
+        combined.state->combine(*combined.parent, *combined.child);
+        combined.parentVersion = combined.parent->version();
+        combined.childVersion = combined.child->version();
+    }
+
+    m_stateChangeCount = State::changeCount();
+}
+
+std::shared_ptr<State> CompileVisitor::combine(const std::shared_ptr<State>& parent, const std::shared_ptr<State>& child) {
+    // Geometries shared through the GeometryMap resolve the same pair of states once per reference.
+    // Reusing the combined state lets the draws be batched by state pointer.
+    // The states are kept between compilations and only recombined if one of the two was modified.
+    StatePair key(parent.get(), child.get());
+    auto it = m_combinedIndices.find(key);
+    if (it != m_combinedIndices.end()) {
+        CombinedState& combined = m_combinedStates[it->second];
+        if (parent->version() != combined.parentVersion || child->version() != combined.childVersion) {
+            combined.state->combine(*parent, *child);
+            combined.parentVersion = parent->version();
+            combined.childVersion = child->version();
+        }
+        return combined.state;
+    }
+
+    CombinedState combined;
+    combined.parent = parent;
+    combined.child = child;
+    combined.state = *parent + *child;
+    combined.parentVersion = parent->version();
+    combined.childVersion = child->version();
+
+    m_combinedIndices[key] = m_combinedStates.size();
+    m_combinedStates.push_back(combined);
+    return combined.state;
+}
+
+void CompileVisitor::pushState(Node* node) {
+    if (!node->hasState())
+        return;
+
+    if (m_stateStack.empty()) {
+        m_stateStack.push(node->getState());
+    } else {
+        m_stateStack.push(combine(m_stateStack.top(), node->getState()));
+    }
+}
+
+void CompileVisitor::popState(Node* node) {
+    if (node->hasState()) {
+        m_stateStack.pop();
+    }
+}
+
+void CompileVisitor::visit(Geometry* geometry) {
+    std::shared_ptr<State> state = nullptr;
+
+    // Geometry always has a state
+    if (m_stateStack.empty()) {
+        state = geometry->getState();
+    } else if (geometry->hasState()) {
+        state = combine(m_stateStack.top(), geometry->getState());
+    } else {
+        state = m_stateStack.top();
+    }
+
+    if (state == nullptr || state->getShader() == nullptr) {
+        std::cerr << "Geometry " << geometry->getName() << " has no shader and will not be rendered" << std::endl;
+        return;
+    }
+
+    m_renderList->addItem(geometry, state, m_transformStack.top(), m_lodStack.top());
+}
+
+void CompileVisitor::visit(Transform* transform) {
+    m_transformStack.push(transform);
+    pushState(transform);
+
+    for (auto& child : transform->getChildren()) {
+        child->accept(*this);
+    }
+
+    popState(transform);
+    m_transformStack.pop();
+}
+
+void CompileVisitor::visit(Group* group) {
+    pushState(group);
+
+    for (auto& child : group->getChildren()) {
+        child->accept(*this);
+    }
+
+    popState(group);
+}
+
+void CompileVisitor::visit(LodNode* lodNode) {
+    pushState(lodNode);
+
+    // All levels are compiled, the active one is selected every frame by the render list
+    int first = -1;
+    for (auto& child : lodNode->getChildren()) {
+        int level = m_renderList->addLodLevel(lodNode, child.second.get(), m_lodStack.top(), first);
+        if (first < 0)
+            first = level;
+        m_lodStack.push(level);
+        child.second->accept(*this);
+        m_lodStack.pop();
+    }
+
+    popState(lodNode);
+}
+
+void CompileVisitor::visit(LightNode* lightNode) {
+    m_renderList->addLight(lightNode->getLight(), m_transformStack.top());
+}
+
+void CompileVisitor::visit(CameraNode* cameraNode) {
+    m_renderList->addCamera(cameraNode->getCamera(), m_transformStack.top());
+}
@@ -8,30 +8,64 @@
 
 using namespace vr;
 
+UpdateVisitor::UpdateVisitor() : m_sceneChanged(false), m_boundsChanged(false) {
+    m_transformStack.push(nullptr);
+    m_worldChangedStack.push(false);
+}
+
+glm::mat4 UpdateVisitor::currentWorld() const {
+    Transform* transform = m_transformStack.top();
+    return transform ? transform->getWorldMatrix() : glm::mat4(1.0f);
+}
+
+bool UpdateVisitor::visitChildren(NodeVector& children) {
+    bool changed = false;
+    for (auto& child : children) {
+        m_boundsChanged = false;
+        child->accept(*this);
+        changed = changed || m_boundsChanged;
+    }
+    return changed;
+}
+
 void UpdateVisitor::visit(Geometry* geometry) {
     if (geometry->hasCallbacks()) {
         for (auto& callback : geometry->getUpdateCallbacks()) {
             callback->execute(*geometry);
         }
     }
+
+    // The bounds of a geometry only change with its transform, which is handled by the parent
+    m_boundsChanged = false;
 }
 
 void UpdateVisitor::visit(Transform* transform) {
-    // Mark the scene as changed if the transform is dirty
-    // First set the dirty flag to false
-    transform->setDirty(false);
-
     if (transform->hasCallbacks()) {
         for (auto& callback : transform->getUpdateCallbacks()) {
             callback->execute(*transform);
         }
     }
 
+    // Mark the scene as changed if the transform is dirty. The world matrix is
+    // only recomputed if this transform or one of its parents changed.
+    bool worldChanged = transform->updateWorldMatrix(m_transformStack.top());
+
     m_sceneChanged = m_sceneChanged || transform->Dirty();
+    transform->setDirty(false);
 
-    for (auto& child : transform->getChildren()) {
-        child->accept(*this);
-    }
+    m_transformStack.push(transform);
+    m_worldChangedStack.push(worldChanged);
+
+    bool changed = visitChildren(transform->getChildren()) || worldChanged || transform->boundsDirty();
+
+    // Bounds are only refit along paths where something moved or the children changed
+    if (changed)
+        transform->refitBounds(transform->getWorldMatrix());
+
+    m_transformStack.pop();
+    m_worldChangedStack.pop();
+
+    m_boundsChanged = changed;
 }
 
 void UpdateVisitor::visit(Group* group) {
@@ -41,9 +75,12 @@ void UpdateVisitor::visit(Group* group) {
         }
     }
 
-    for (auto& child : group->getChildren()) {
-        child->accept(*this);
-    }
+    bool changed = visitChildren(group->getChildren()) || m_worldChangedStack.top() || group->boundsDirty();
+
+    if (changed)
+        group->refitBounds(currentWorld());
+
+    m_boundsChanged = changed;
 }
 
 void UpdateVisitor::visit(LodNode* lodNode) {
@@ -53,10 +90,24 @@ void UpdateVisitor::visit(LodNode* lodNode) {
         }
     }
 
+    // The bounds are needed to select the level of detail, so they are refit first
+    bool changed = m_worldChangedStack.top() || lodNode->boundsDirty();
+    if (changed)
+        lodNode->calculateBoundingBox(currentWorld());
+
     Node* node = lodNode->getChild(m_activeCamera->getPosition());
     if (node) {
+        m_boundsChanged = false;
         node->accept(*this);
+
+        // Something inside the level moved, so the parents have to refit as well
+        if (m_boundsChanged && !changed) {
+            lodNode->calculateBoundingBox(currentWorld());
+            changed = true;
+        }
     }
+
+    m_boundsChanged = changed;
 }
 
 void UpdateVisitor::visit(LightNode* lightNode) {
@@ -65,6 +116,8 @@ void UpdateVisitor::visit(LightNode* lightNode) {
             callback->execute(*lightNode);
         }
     }
+
+    m_boundsChanged = false;
 }
 
 void UpdateVisitor::visit(CameraNode* cameraNode) {
@@ -73,4 +126,6 @@ void UpdateVisitor::visit(CameraNode* cameraNode) {
             callback->execute(*cameraNode);
         }
     }
+
+    m_boundsChanged = false;
 }
@@ -1,11 +1,44 @@
-#version 410 core
+#version 430 core
 
 layout(location = 0) in vec4 vertex_position;
+// Per-instance world matrix, used instead of m when instanced is set
+layout(location = 5) in mat4 instance_m;
+// Index into the DrawBuffer, used instead of m and the instance matrix when indirect is set
+layout(location = 12) in uint draw_index;
 
 uniform mat4 m, lsm;
+uniform bool instanced;
+// Quantized positions are decoded with the bounds of the mesh, w holds the bitangent sign
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+// Per-draw data of indirect draws, layout matches DrawData on the CPU side, std430
+struct DrawParameters {
+    mat4 world;
+    vec4 normalMatrix[3];
+    vec3 positionOffset;
+    int materialIndex;
+    vec3 positionScale;
+    int padding;
+};
+
+// Draws of the current indirect submission (DRAW_BUFFER_BINDING)
+layout (std430, binding = 4) readonly buffer DrawBuffer
+{
+    DrawParameters draws[];
+};
+uniform bool indirect;
 
 void main() {   
-    gl_Position = lsm * m * vertex_position;
+    mat4 model = instanced ? instance_m : m;
+    vec3 offset = positionOffset;
+    vec3 scale = positionScale;
+    if (indirect) {
+        model = draws[draw_index].world;
+        offset = draws[draw_index].positionOffset;
+        scale = draws[draw_index].positionScale;
+    }
+    gl_Position = lsm * model * vec4(offset + vertex_position.xyz * scale, 1.0);
 }
 
 
@@ -1,4 +1,4 @@
-#version 410 core
+#version 430 core
 layout (location = 0) out vec4 gPositionAmbient; // xyz = position, w = ambient r value
 layout (location = 1) out vec4 gNormalAmbient; // xyz = normal, w = ambient g value
 layout (location = 2) out vec4 gAlbedoAmbient; // rgb = albedo, a = ambient b value
@@ -8,11 +8,12 @@ in vec4 position;
 in vec3 normal;
 in vec2 texCoord;
 in mat3 TBN;
+flat in int drawMaterialIndex;  // material of the draw, used instead of materialIndex when indirect is set
 
 const int MAX_MATERIAL_TEXTURES=8;
 const int MAX_TEXTURES=2;
 
-// declaration of a Material structure
+// Material properties, layout matches MaterialData on the CPU side, std430
 struct Material
 {
     vec4 ambient;
@@ -21,8 +22,7 @@ struct Material
     vec4 emission;
 
     float shininess;
-    bool activeTextures[MAX_MATERIAL_TEXTURES];
-    sampler2D textures[MAX_MATERIAL_TEXTURES];
+    int activeTextures; // One bit per texture unit
 };
 
 struct Textures
@@ -35,8 +35,15 @@ struct Textures
   sampler2D textures[MAX_TEXTURES];
 };
 
-// The front surface material
-uniform Material material;
+// Table of all materials in the scene (MATERIAL_BUFFER_BINDING), indexed per draw
+layout (std430, binding = 1) readonly buffer MaterialBuffer
+{
+    Material materials[];
+};
+uniform int materialIndex;
+uniform bool indirect;
+uniform sampler2D materialTextures[MAX_MATERIAL_TEXTURES];
+
 uniform Textures textureLayers;
 
 
@@ -159,21 +166,29 @@ vec3 calculateProceduralTexture(vec2 texCoord, int proceduralType, bool isAnimat
     return color;
 }
 
+bool hasTexture(Material material, int unit)
+{
+    return (material.activeTextures & (1 << unit)) != 0;
+}
+
 void main()
 {
+    // The front surface material
+    Material material = materials[indirect ? drawMaterialIndex : materialIndex];
+
     gPositionAmbient.xyz = position.xyz;
 
     gNormalAmbient.xyz = normalize(normal);
-    if (material.activeTextures[3]) // Normal map
+    if (hasTexture(material, 3)) // Normal map
     {
-        vec3 norm = texture(material.textures[3], texCoord).rgb;
+        vec3 norm = texture(materialTextures[3], texCoord).rgb;
         norm = norm * 2.0 - 1.0;
         gNormalAmbient.xyz = normalize(TBN * norm);
     }
 
     vec3 ambient = material.ambient.rgb;
-    if (material.activeTextures[5]) { // Emissive map
-        ambient = texture(material.textures[5], texCoord).rgb * 10;
+    if (hasTexture(material, 5)) { // Emissive map
+        ambient = texture(materialTextures[5], texCoord).rgb * 10;
     } else if (material.emission.r > 0.0 || material.emission.g > 0.0 || material.emission.b > 0.0) {
         ambient = material.emission.rgb * 10;
     }
@@ -183,9 +198,9 @@ void main()
     gAlbedoAmbient.w = ambient.b; // ambient factor
 
     gAlbedoAmbient.rgb = material.diffuse.rgb;
-    if (material.activeTextures[0]) // Diffuse map
+    if (hasTexture(material, 0)) // Diffuse map
     {
-        gAlbedoAmbient.rgb = texture(material.textures[0], texCoord).rgb;
+        gAlbedoAmbient.rgb = texture(materialTextures[0], texCoord).rgb;
     }
 
     vec4 blendedColor;
@@ -218,25 +233,25 @@ void main()
     }
 
     gAoMetallicRoughness.y = material.specular.r; // No metallic or specular map, use specular color
-    if (material.activeTextures[6]) // Metallic 
+    if (hasTexture(material, 6)) // Metallic 
     {
-        gAoMetallicRoughness.y = texture(material.textures[6], texCoord).r;
-    } else if (material.activeTextures[1]) // Specular map
+        gAoMetallicRoughness.y = texture(materialTextures[6], texCoord).r;
+    } else if (hasTexture(material, 1)) // Specular map
     {
-        //vec3 specularColor = texture(material.textures[1], texCoord).rgb;
+        //vec3 specularColor = texture(materialTextures[1], texCoord).rgb;
         //float specularGray = dot(specularColor, vec3(0.299, 0.587, 0.114)); // Convert to grayscale
-        gAoMetallicRoughness.y = texture(material.textures[1], texCoord).r; // Use grayscale value as metallic factor
+        gAoMetallicRoughness.y = texture(materialTextures[1], texCoord).r; // Use grayscale value as metallic factor
     }
         
     gAoMetallicRoughness.z = material.shininess;
-    if (material.activeTextures[7]) // Roughness
+    if (hasTexture(material, 7)) // Roughness
     {
-        gAoMetallicRoughness.z = texture(material.textures[7], texCoord).r;
+        gAoMetallicRoughness.z = texture(materialTextures[7], texCoord).r;
     } 
 
-    if (material.activeTextures[4]) // Ambient occlusion
+    if (hasTexture(material, 4)) // Ambient occlusion
     {
-        gAoMetallicRoughness.x = texture(material.textures[4], texCoord).r;
+        gAoMetallicRoughness.x = texture(materialTextures[4], texCoord).r;
     } else {
         gAoMetallicRoughness.x = 1.0;
     }
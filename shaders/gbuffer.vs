@@ -1,32 +1,96 @@
-#version 410 core
+#version 430 core
 
+// Packed vertex, see VertexFormat.h. The position is relative to the bounds of the mesh and
+// its w is 1 if the bitangent is cross(normal, tangent), the normal and tangent are octahedral.
 layout(location = 0) in vec4 vertex_position;
-layout(location = 1) in vec3 vertex_normal;
+layout(location = 1) in vec2 vertex_normal;
 layout(location = 2) in vec2 vertex_texCoord;
-layout(location = 3) in vec3 vertex_tangent;
-layout(location = 4) in vec3 vertex_bitangent;
+layout(location = 3) in vec2 vertex_tangent;
+// Per-instance matrices, used instead of the uniforms when instanced is set
+layout(location = 5) in mat4 instance_m;
+layout(location = 9) in mat3 instance_m_3x3_inv_transp;
+// Index into the DrawBuffer, used instead of the uniforms and instance matrices when indirect is set
+layout(location = 12) in uint draw_index;
 
 out vec4 position;  // position of the vertex (and fragment) in world space
 out vec3 normal;  // surface normal vector in world space
 out vec2 texCoord;  // texture coordinates
 out mat3 TBN;  // TBN matrix 
+flat out int drawMaterialIndex;  // material of an indirect draw
 
-uniform mat4 m, v, p;  // model, view, and projection matrices
+// Camera of the current view, written once per frame (CAMERA_BLOCK_BINDING)
+layout (std140) uniform CameraBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec2 nearFar;
+    vec2 screenSize;
+};
+
+uniform mat4 m;  // model matrix
 uniform mat3 m_3x3_inv_transp; // Inverse transpose of model matrix for transforming normals
+uniform bool instanced;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+// Per-draw data of indirect draws, layout matches DrawData on the CPU side, std430
+struct DrawParameters {
+    mat4 world;
+    vec4 normalMatrix[3];
+    vec3 positionOffset;
+    int materialIndex;
+    vec3 positionScale;
+    int padding;
+};
+
+// Draws of the current indirect submission (DRAW_BUFFER_BINDING)
+layout (std430, binding = 4) readonly buffer DrawBuffer
+{
+    DrawParameters draws[];
+};
+uniform bool indirect;
+
+// Unit vector from its octahedral encoding
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
 
 void main()
 {
-    vec4 world_position = m * vertex_position;
+    mat4 model = instanced ? instance_m : m;
+    mat3 normalMatrix = instanced ? instance_m_3x3_inv_transp : m_3x3_inv_transp;
+    vec3 offset = positionOffset;
+    vec3 scale = positionScale;
+    drawMaterialIndex = 0;
+    if (indirect) {
+        DrawParameters draw = draws[draw_index];
+        model = draw.world;
+        normalMatrix = mat3(draw.normalMatrix[0].xyz, draw.normalMatrix[1].xyz, draw.normalMatrix[2].xyz);
+        offset = draw.positionOffset;
+        scale = draw.positionScale;
+        drawMaterialIndex = draw.materialIndex;
+    }
+
+    vec3 localNormal = octahedralDecode(vertex_normal);
+    vec3 localTangent = octahedralDecode(vertex_tangent);
+    vec3 localBitangent = cross(localNormal, localTangent) * (vertex_position.w * 2.0 - 1.0);
+
+    vec4 world_position = model * vec4(offset + vertex_position.xyz * scale, 1.0);
     position = world_position;
     texCoord = vertex_texCoord;
 
-    normal = m_3x3_inv_transp * vertex_normal;
+    normal = normalMatrix * localNormal;
 
-    vec3 T = normalize(vec3(m * vec4(vertex_tangent, 0.0)));
-    vec3 B = normalize(vec3(m * vec4(vertex_bitangent, 0.0)));
-    vec3 N = normalize(vec3(m * vec4(vertex_normal, 0.0)));
+    vec3 T = normalize(vec3(model * vec4(localTangent, 0.0)));
+    vec3 B = normalize(vec3(model * vec4(localBitangent, 0.0)));
+    vec3 N = normalize(vec3(model * vec4(localNormal, 0.0)));
 
     TBN = mat3(T, B, N);
 
-    gl_Position = p * v * position;
+    gl_Position = viewProjection * position;
 }
\ No newline at end of file
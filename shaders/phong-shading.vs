@@ -1,10 +1,10 @@
 #version 410 core
 
+// Packed vertex: quantized position with the bitangent sign in w, octahedral normal and tangent
 layout(location = 0) in vec4 vertex_position;
-layout(location = 1) in vec3 vertex_normal;
+layout(location = 1) in vec2 vertex_normal;
 layout(location = 2) in vec2 vertex_texCoord;
-layout(location = 3) in vec3 vertex_tangent;
-layout(location = 4) in vec3 vertex_bitangent;
+layout(location = 3) in vec2 vertex_tangent;
 
 const int MaxNumberOfLights = 10;
 
@@ -23,24 +23,41 @@ uniform mat4 lightSpaceMatrix[MaxNumberOfLights];
 // Inverse transpose of model matrix for transforming normals
 uniform mat3 m_3x3_inv_transp;
 
+// Bounds the positions are quantized to
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 octahedralDecode(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0)
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  return normalize(n);
+}
+
 void main()
 {
   mat4 mv = v * m;
   texCoord = vertex_texCoord;
 
-  position = mv * vertex_position;
-  normal = normalize(m_3x3_inv_transp * vertex_normal);
+  vec4 localPosition = vec4(positionOffset + vertex_position.xyz * positionScale, 1.0);
+  vec3 localNormal = octahedralDecode(vertex_normal);
+  vec3 localTangent = octahedralDecode(vertex_tangent);
+  vec3 localBitangent = cross(localNormal, localTangent) * (vertex_position.w * 2.0 - 1.0);
+
+  position = mv * localPosition;
+  normal = normalize(m_3x3_inv_transp * localNormal);
   for (int i = 0; i < MaxNumberOfLights; i++)
   {
     if (activeLights[i])
     {
-      positionLightSpace[i] = lightSpaceMatrix[i] * m * vertex_position;
+      positionLightSpace[i] = lightSpaceMatrix[i] * m * localPosition;
     }
   }
 
-  vec3 T = normalize(vec3(m * vec4(vertex_tangent, 0.0)));
-  vec3 B = normalize(vec3(m * vec4(vertex_bitangent, 0.0)));
-  vec3 N = normalize(vec3(m * vec4(vertex_normal, 0.0)));
+  vec3 T = normalize(vec3(m * vec4(localTangent, 0.0)));
+  vec3 B = normalize(vec3(m * vec4(localBitangent, 0.0)));
+  vec3 N = normalize(vec3(m * vec4(localNormal, 0.0)));
 
   TBN = mat3(T, B, N);
 
@@ -0,0 +1,55 @@
+#version 430 core
+// Either extension allows the vertex shader to write gl_Layer
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+layout (location = 0) in vec4 vertex_position;
+// Per-instance world matrix, shared by the faceCount consecutive instances of a mesh
+layout (location = 5) in mat4 instance_m;
+// Index into the DrawBuffer, used instead of m and the instance matrix when indirect is set
+layout (location = 12) in uint draw_index;
+
+uniform mat4 m;
+uniform bool instanced;
+uniform mat4 shadowMatrices[6];
+uniform int depthMapIndex;
+// The cube faces the mesh is drawn to, one instance per face
+uniform int faces[6];
+uniform int faceCount;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+// Per-draw data of indirect draws, layout matches DrawData on the CPU side, std430
+struct DrawParameters {
+    mat4 world;
+    vec4 normalMatrix[3];
+    vec3 positionOffset;
+    int materialIndex;
+    vec3 positionScale;
+    int padding;
+};
+
+// Draws of the current indirect submission (DRAW_BUFFER_BINDING)
+layout (std430, binding = 4) readonly buffer DrawBuffer
+{
+    DrawParameters draws[];
+};
+uniform bool indirect;
+
+out vec4 position;
+
+void main()
+{
+    mat4 model = instanced ? instance_m : m;
+    vec3 offset = positionOffset;
+    vec3 scale = positionScale;
+    if (indirect) {
+        model = draws[draw_index].world;
+        offset = draws[draw_index].positionOffset;
+        scale = draws[draw_index].positionScale;
+    }
+    int face = faces[gl_InstanceID % faceCount];
+
+    gl_Layer = depthMapIndex * 6 + face;
+    position = model * vec4(offset + vertex_position.xyz * scale, 1.0);
+    gl_Position = shadowMatrices[face] * position;
+}
@@ -4,6 +4,8 @@ layout (triangle_strip, max_vertices = 18) out;
 
 uniform mat4 shadowMatrices[6];
 uniform int depthMapIndex;
+// One bit per cube face, only faces the mesh overlaps are rendered to
+uniform int faceMask;
 
 out vec4 position;
 
@@ -11,6 +13,9 @@ void main()
 {
     for(int face = 0; face < 6; ++face)
     {
+        if ((faceMask & (1 << face)) == 0)
+            continue;
+
         gl_Layer = depthMapIndex * 6 + face;
         for(int i = 0; i < 3; ++i)
         {
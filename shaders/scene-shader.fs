@@ -1,41 +1,76 @@
-#version 410 core
+#version 430 core
 
 layout (location = 0) out vec4 color;
 layout (location = 1) out vec4 brightColor;
 
 in vec2 texCoord;
 
-const int MaxNumberOfLights = 50; // 22x22
-
-vec3 sampleOffsetDirections[20] = vec3[]
+// Poisson disk, rotated per pixel so the few shadow samples turn banding into fine noise
+const int POISSON_SAMPLES = 8;
+const vec2 poissonDisk[POISSON_SAMPLES] = vec2[]
 (
-   vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
-   vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
-   vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
-   vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
-   vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
-); 
+   vec2(-0.613392,  0.617481), vec2( 0.170019, -0.040254), vec2(-0.299417,  0.791925), vec2( 0.645680,  0.493210),
+   vec2(-0.651784,  0.717887), vec2( 0.421003,  0.027070), vec2(-0.817194, -0.271096), vec2(-0.705374, -0.668203)
+);
+
+// Interleaved gradient noise, a rotation of the Poisson disk that differs between neighbouring pixels
+mat2 poissonRotation() {
+    float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    float s = sin(angle);
+    float c = cos(angle);
+    return mat2(c, s, -s, c);
+}
 
+// Layout matches LightData on the CPU side, std430
 struct LightSource
 {
-  bool enabled;
   vec4 position;
   vec4 ambient;
   vec4 diffuse;
   vec4 specular;
+  mat4 cascadeMatrices[4]; // Light space matrix of each shadow cascade (SHADOW_CASCADES)
+  vec4 cascadeSplits; // View depth at which each cascade ends
 
   float constant;
   float linear;
   float quadratic;
   float farPlane;
-  int shadowMapIndex; // Index of the shadow map in the array. If it is a point light, it will be the index of the first face of the cubemap.
-  mat4 lightSpaceMatrix; // Used for shadow mapping
+  int enabled;
+  int shadowMapIndex; // Index of the light in its shadow map array. Directional lights use one layer per cascade, starting at shadowMapIndex * 4.
+  int shadowTier; // Shadow atlas tier holding the cube map of a point light, -1 if it has no shadow map
+  int shadowFilter; // 0 for PCF with comparison samplers, 1 for exponential shadow maps (directional lights only)
+};
+
+// Binding LIGHT_BUFFER_BINDING, only the lights that change are written every frame
+layout (std430, binding = 0) readonly buffer LightBuffer
+{
+  LightSource lights[];
+};
+
+// Light lists of the froxel clusters (CLUSTER_BUFFER_BINDING), offset and count into clusterLights
+layout (std430, binding = 2) readonly buffer ClusterBuffer
+{
+  uvec2 clusters[];
 };
 
+// Indices into lights (CLUSTER_LIGHT_BUFFER_BINDING), starting with the directional lights
+layout (std430, binding = 3) readonly buffer ClusterLightBuffer
+{
+  uint clusterLights[];
+};
+uniform int numDirectionalLights;
+uniform vec3 clusterGrid;
 
 // Uniforms for final image
-uniform LightSource lights[MaxNumberOfLights];
-uniform vec3 viewPos;
+// Camera of the current view, written once per frame (CAMERA_BLOCK_BINDING)
+layout (std140) uniform CameraBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec2 nearFar;
+    vec2 screenSize;
+};
 uniform bool shadowsEnabled;
 uniform sampler2D gPositionAmbient; // xyz = position, w = ambient r value
 uniform sampler2D gNormalAmbient; // xyz = normal, w = ambient g value
@@ -43,33 +78,46 @@ uniform sampler2D gAlbedoAmbient; // rgb = albedo, a = ambient b value
 uniform sampler2D gAoMetallicRoughness; // x = ambient occlusion, yz metallic and roughness factors
                                         // If there is no metallic and roughness textures, y will contain specular factor and z will contain shininess factor
 
-uniform sampler2DArray directionalShadowMaps;
-uniform samplerCubeArray pointShadowMaps;
+// The depth maps are compared in hardware, every fetch returns the filtered result of four comparisons
+uniform sampler2DArrayShadow directionalShadowMaps;
+uniform sampler2DArray directionalExponentialMaps;
+uniform float esmExponent; // The exponent the exponential maps were prefiltered with
+// One array per resolution tier of the shadow atlas (SHADOW_TIER_COUNT)
+uniform samplerCubeArrayShadow pointShadowMaps[3];
+
+// Samplers may only be indexed with dynamically uniform values, but the tier differs between pixels
+float samplePointShadowMap(int tier, vec4 texCoords, float depth) {
+    if (tier == 0)
+        return texture(pointShadowMaps[0], texCoords, depth);
+    if (tier == 1)
+        return texture(pointShadowMaps[1], texCoords, depth);
+    return texture(pointShadowMaps[2], texCoords, depth);
+}
 
-float calculatePointShadow(vec3 fragPos, vec3 lightPos, vec3 viewDir, float farPlane,int index) {
+float calculatePointShadow(vec3 fragPos, vec3 lightPos, vec3 viewDir, float farPlane, int index, int tier) {
     vec3 fragToLight = fragPos - lightPos;
     float currentDepth = length(fragToLight);
 
-    // PCF
-    float shadow = 0.0;
     float bias = 0.20;
-    int samples = 10;
-    float viewDistance = length(fragPos - viewPos);
+    float viewDistance = length(fragPos - cameraPosition.xyz);
     float diskRadius = (1.0 + (viewDistance / farPlane)) / 25.0;
 
-    for (int i = 0; i < samples; ++i)
+    // The disk is spread over the plane perpendicular to the direction to the light
+    vec3 direction = normalize(fragToLight);
+    vec3 tangent = normalize(cross(direction, abs(direction.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0)));
+    vec3 bitangent = cross(direction, tangent);
+    mat2 rotation = poissonRotation();
+
+    // The lit fraction of every sample, compared against the depth mapped to [0;1]
+    float lit = 0.0;
+    for (int i = 0; i < POISSON_SAMPLES; ++i)
     {
-        vec3 direction = normalize(fragToLight + sampleOffsetDirections[i] * diskRadius);
-        vec4 texCoords = vec4(direction, float(index));
-        float closestDepth = texture(pointShadowMaps, texCoords).r;
-        closestDepth *= farPlane;  // Undo mapping [0;1]
-        if (currentDepth - bias > closestDepth) {
-            shadow += 1.0;
-        }
-            
+        vec2 offset = rotation * poissonDisk[i] * diskRadius;
+        vec3 sampleDirection = fragToLight + tangent * offset.x + bitangent * offset.y;
+        lit += samplePointShadowMap(tier, vec4(sampleDirection, float(index)), (currentDepth - bias) / farPlane);
     }
 
-  return shadow / float(samples);
+    return 1.0 - lit / float(POISSON_SAMPLES);
 }
 
 vec3 calculatePointLight(LightSource light, vec3 fragPos, vec3 normal, vec3 albedo, vec3 viewDir, float ambientOcclusion, float metallic, float shininess) {
@@ -93,8 +141,8 @@ vec3 calculatePointLight(LightSource light, vec3 fragPos, vec3 normal, vec3 albe
     }
 
     float shadow = 0.0;
-    if (shadowsEnabled) 
-        shadow = calculatePointShadow(fragPos, light.position.xyz, viewDir, light.farPlane, light.shadowMapIndex);
+    if (shadowsEnabled && light.shadowTier >= 0) 
+        shadow = calculatePointShadow(fragPos, light.position.xyz, viewDir, light.farPlane, light.shadowMapIndex, light.shadowTier);
 
     // Combine results
     vec3 result = (1.0 - shadow) * ((diffuseColor * 2 + specularColor) * attenuation);
@@ -102,8 +150,15 @@ vec3 calculatePointLight(LightSource light, vec3 fragPos, vec3 normal, vec3 albe
     return result;
 }
 
-float calculateDirectionalShadow(vec4 fragPosLightSpace, vec3 lightDirection, vec3 nNormal, int index)
+float calculateDirectionalShadow(LightSource light, vec3 fragPos, vec3 lightDirection, vec3 nNormal)
 {
+  // The closest cascade containing the fragment has the highest resolution
+  float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+  int cascade = 0;
+  while (cascade < 3 && viewDepth > light.cascadeSplits[cascade])
+    cascade++;
+
+  vec4 fragPosLightSpace = light.cascadeMatrices[cascade] * vec4(fragPos, 1.0);
   vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
   projCoords = projCoords * 0.5 + 0.5;
  
@@ -111,23 +166,29 @@ float calculateDirectionalShadow(vec4 fragPosLightSpace, vec3 lightDirection, ve
     return 0.0;
   }
 
-  float shadow = 0.0;
   float currentDepth = projCoords.z;
   float bias = max(0.002 * (1.0 - dot(nNormal, lightDirection)), 0.001);
+  float layer = float(light.shadowMapIndex * 4 + cascade);
+
+  // The prefiltered exponential map needs a single bilinear fetch
+  if (light.shadowFilter == 1) {
+    float occluder = texture(directionalExponentialMaps, vec3(projCoords.xy, layer)).r;
+    float lit = clamp(occluder * exp(-esmExponent * (currentDepth - bias)), 0.0, 1.0);
+    return 0.95 * (1.0 - lit);
+  }
 
   vec2 texelSize = 1.0 / textureSize(directionalShadowMaps, 0).xy;
+  mat2 rotation = poissonRotation();
 
-  int kernelSize = 10;
-  for(int x = -kernelSize; x <= kernelSize; ++x)
+  // Every comparison fetch already filters four texels, the disk only has to cover a few texels
+  float lit = 0.0;
+  for (int i = 0; i < POISSON_SAMPLES; ++i)
   {
-    for(int y = -kernelSize; y <= kernelSize; ++y)
-    {
-      float pcfDepth = texture(directionalShadowMaps, vec3(projCoords.xy + vec2(x, y) * texelSize, index)).r; 
-      shadow += currentDepth - bias > pcfDepth  ? 0.95 : 0.0;        
-    }
+    vec2 offset = rotation * poissonDisk[i] * 1.5 * texelSize;
+    lit += texture(directionalShadowMaps, vec4(projCoords.xy + offset, layer, currentDepth - bias));
   }
   
-  return shadow / ((2 * kernelSize + 1) * (2 * kernelSize + 1));
+  return 0.95 * (1.0 - lit / float(POISSON_SAMPLES));
 }
 
 vec3 calculateDirectionalLight(LightSource light, vec3 fragPos, vec3 normal, vec3 albedo, vec3 viewDir, float ambientOcclusion, float metallic, float shininess) {
@@ -144,10 +205,9 @@ vec3 calculateDirectionalLight(LightSource light, vec3 fragPos, vec3 normal, vec
                 * pow(max(0.0, dot(reflect(-lightDir, normal), viewDir)), 32); // TODO: Use roughness and metallic
     }
 
-    vec4 fragPosLightSpace = light.lightSpaceMatrix * vec4(fragPos, 1.0);
     float shadow = 0.0;
     if (shadowsEnabled) 
-        shadow = calculateDirectionalShadow(fragPosLightSpace, lightDir, normal, light.shadowMapIndex);
+        shadow = calculateDirectionalShadow(light, fragPos, lightDir, normal);
     
     
     // Combine results
@@ -171,16 +231,23 @@ vec4 renderFinal() {
     // Calculate lighting
     vec3 lighting = vec3(0.0);
     vec3 ambient = vec3(0.0);
-    vec3 viewDir = normalize(viewPos - fragPos);
-    for (int i = 0; i < MaxNumberOfLights; i++) {
-        if (lights[i].enabled) {
-            if (lights[i].position.w == 0.0) {
-                lighting += calculateDirectionalLight(lights[i], fragPos, normal, albedo, viewDir, ambientOcclusion, metallic, shininess);
-                ambient = lights[i].ambient.rgb;
-            } else {
-                lighting += calculatePointLight(lights[i], fragPos, normal, albedo, viewDir, ambientOcclusion, metallic, shininess);
-            }
-        }
+    vec3 viewDir = normalize(cameraPosition.xyz - fragPos);
+    for (int i = 0; i < numDirectionalLights; i++) {
+        LightSource light = lights[clusterLights[i]];
+        lighting += calculateDirectionalLight(light, fragPos, normal, albedo, viewDir, ambientOcclusion, metallic, shininess);
+        ambient = light.ambient.rgb;
+    }
+
+    // Only the point lights whose range reaches the cluster of the pixel are evaluated
+    float depth = clamp(-(view * vec4(fragPos, 1.0)).z, nearFar.x, nearFar.y);
+    ivec3 grid = ivec3(clusterGrid);
+    ivec3 cluster = ivec3(gl_FragCoord.xy / screenSize * clusterGrid.xy,
+                          log(depth / nearFar.x) / log(nearFar.y / nearFar.x) * clusterGrid.z);
+    cluster = clamp(cluster, ivec3(0), grid - 1);
+
+    uvec2 lightList = clusters[cluster.x + grid.x * (cluster.y + grid.y * cluster.z)];
+    for (uint i = lightList.x; i < lightList.x + lightList.y; i++) {
+        lighting += calculatePointLight(lights[clusterLights[i]], fragPos, normal, albedo, viewDir, ambientOcclusion, metallic, shininess);
     }
     
     lighting += ambient * ambientColor;
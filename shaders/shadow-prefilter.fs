@@ -0,0 +1,33 @@
+#version 430 core
+// Prefilters a layer of a directional shadow map into an exponential shadow map. The first pass
+// converts the depth to exp(exponent * depth) and blurs it horizontally, the second pass blurs the
+// result vertically. Filtering the exponentials is what lets the lighting pass use a single bilinear fetch.
+layout (location = 0) out float moment;
+
+uniform sampler2DArray source;
+uniform int layer;
+uniform bool vertical;
+uniform float exponent; // ESM_EXPONENT
+
+uniform float weight[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216); // gaussian weights
+
+float fetch(ivec2 texel)
+{
+    ivec2 size = textureSize(source, 0).xy;
+    float value = texelFetch(source, ivec3(clamp(texel, ivec2(0), size - 1), layer), 0).r;
+    return vertical ? value : exp(exponent * value);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 direction = vertical ? ivec2(0, 1) : ivec2(1, 0);
+
+    float result = fetch(texel) * weight[0];
+    for (int i = 1; i < 5; i++)
+    {
+        result += fetch(texel + direction * i) * weight[i];
+        result += fetch(texel - direction * i) * weight[i];
+    }
+    moment = result;
+}
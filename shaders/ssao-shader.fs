@@ -9,19 +9,24 @@ uniform sampler2D gNormal;
 uniform sampler2D noiseTexture;
 
 uniform vec3 samples[64];
-uniform mat4 p;
-uniform mat4 v;
 uniform int kernelSize;
-
-uniform float screenX;
-uniform float screenY;
 uniform float farPlane;
 
+// Camera of the current view, written once per frame (CAMERA_BLOCK_BINDING)
+layout (std140) uniform CameraBlock {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec2 nearFar;
+    vec2 screenSize;
+};
+
 float radius = 0.5;
 float bias = 0.025;
 
 void main() {
-    vec2 noiseScale = vec2(screenX / 4.0, screenY / 4.0);
+    vec2 noiseScale = screenSize / 4.0;
 
     vec3 fragPos = texture(gPosition, texCoord).xyz;
     vec3 normal = texture(gNormal, texCoord).xyz;
@@ -36,7 +41,7 @@ void main() {
         vec3 samplePos = TBN * samples[i];
         samplePos = fragPos + samplePos * radius;
 
-        vec4 offset = p * v * vec4(samplePos, 1.0);
+        vec4 offset = viewProjection * vec4(samplePos, 1.0);
         offset.xyz /= offset.w; // perspective division
         offset.xyz = offset.xyz * 0.5 + 0.5; // transform to range 0.0 - 1.0
 